@@ -0,0 +1,213 @@
+#include "GPXParser.h"
+#include "LinkedListAPI.h"
+#include "GPXParserHelpers.h"
+
+// Description: Correctness test for the polynomial distance kernels. Sums every route and track of the given files
+// under chord_poly and haversine_polyf and compares each total with haversine in double through libm, then does the
+// same on synthetic 1 Hz tracks at the equator, mid latitudes and near the pole.
+// Build against the parser library: gcc -I/usr/include/libxml2 GPXKernelTest.c parser/sharedLib.so -lxml2 -lm -lpthread
+// Usage: ./a.out file.gpx [file.gpx ...]; exits 1 when a kernel is more than 1e-5 of a total off
+
+#define KERNEL_TOLERANCE 1e-5
+
+/* Haversine on the 6371 km sphere in double through libm, the reference every kernel is held to */
+double referenceDistance ( double lat1, double lon1, double lat2, double lon2 ) {
+
+	double radians = 3.14159265358979323846 / 180;
+	double h = pow ( sin ( ( lat1 - lat2 ) * radians / 2 ), 2 ) + cos ( lat1 * radians ) * cos ( lat2 * radians ) * pow ( sin ( ( lon1 - lon2 ) * radians / 2 ), 2 );
+
+	return 2 * asin ( sqrt ( h ) ) * 6371;
+
+}
+
+typedef struct {
+	const char *name;
+	DistanceKernel kernel;
+	double worst_relative;
+	double worst_hop;
+	double worst_total;
+	int failures;
+} KernelResult;
+
+/* Adds the hops of one waypoint list to the running totals, and tracks the largest single hop error in metres */
+void sumWaypoints_function ( List *waypoints, KernelResult *result, double *total, double *reference ) {
+
+	ListIterator point_iter = createIterator ( waypoints );
+	Waypoint *prev = nextElement ( &point_iter );
+	Waypoint *my_waypoint = prev == NULL ? NULL : nextElement ( &point_iter );
+
+	while ( my_waypoint != NULL ) {
+
+		double hop = result->kernel ( prev->latitude, prev->longitude, my_waypoint->latitude, my_waypoint->longitude );
+		double exact = referenceDistance ( prev->latitude, prev->longitude, my_waypoint->latitude, my_waypoint->longitude );
+
+		if ( fabs ( hop - exact ) * 1000 > result->worst_hop ) {
+			result->worst_hop = fabs ( hop - exact ) * 1000;
+		}
+
+		*total = *total + hop;
+		*reference = *reference + exact;
+
+		prev = my_waypoint;
+		my_waypoint = nextElement ( &point_iter );
+
+	}
+
+}
+
+void checkTotal_function ( const char *label, KernelResult *result, double total, double reference ) {
+
+	if ( reference <= 0 ) {
+		return;
+	}
+
+	double relative = fabs ( total - reference ) / reference;
+
+	if ( relative > result->worst_relative ) {
+		result->worst_relative = relative;
+	}
+
+	if ( fabs ( total - reference ) * 1000 > result->worst_total ) {
+		result->worst_total = fabs ( total - reference ) * 1000;
+	}
+
+	if ( !( relative <= KERNEL_TOLERANCE ) ) {
+		fprintf ( stderr, "%s: %s total %.6f km, libm %.6f km (%g off)\n", label, result->name, total, reference, relative );
+		result->failures = result->failures + 1;
+	}
+
+}
+
+void checkDocument_function ( const char *fileName, GPXdoc *doc, KernelResult *result ) {
+
+	char label[512];
+
+	ListIterator route_iter = createIterator ( doc->routes );
+	Route *my_route = nextElement ( &route_iter );
+
+	for ( int i = 1; my_route != NULL; i++ ) {
+
+		double total = 0;
+		double reference = 0;
+
+		sumWaypoints_function ( my_route->waypoints, result, &total, &reference );
+
+		snprintf ( label, sizeof ( label ), "%s Route %d", fileName, i );
+		checkTotal_function ( label, result, total, reference );
+
+		my_route = nextElement ( &route_iter );
+
+	}
+
+	ListIterator track_iter = createIterator ( doc->tracks );
+	Track *my_track = nextElement ( &track_iter );
+
+	for ( int i = 1; my_track != NULL; i++ ) {
+
+		double total = 0;
+		double reference = 0;
+
+		ListIterator segment_iter = createIterator ( my_track->segments );
+		TrackSegment *my_segment = nextElement ( &segment_iter );
+
+		while ( my_segment != NULL ) {
+			sumWaypoints_function ( my_segment->waypoints, result, &total, &reference );
+			my_segment = nextElement ( &segment_iter );
+		}
+
+		snprintf ( label, sizeof ( label ), "%s Track %d", fileName, i );
+		checkTotal_function ( label, result, total, reference );
+
+		my_track = nextElement ( &track_iter );
+
+	}
+
+}
+
+/* An hour of 1 Hz hops of hop metres from latitude, gently weaving so both coordinates change */
+void checkSynthetic_function ( double latitude, double hop, KernelResult *result ) {
+
+	double radians = 3.14159265358979323846 / 180;
+	double lat = latitude;
+	double lon = -80;
+	double heading = 0;
+	double total = 0;
+	double reference = 0;
+
+	for ( int i = 0; i < 3600; i++ ) {
+
+		heading = heading + 0.01 * ( i % 7 - 3 );
+
+		double next_lat = lat + cos ( heading ) * hop / 111195.0;
+		double next_lon = lon + sin ( heading ) * hop / ( 111195.0 * cos ( lat * radians ) );
+
+		total = total + result->kernel ( lat, lon, next_lat, next_lon );
+		reference = reference + referenceDistance ( lat, lon, next_lat, next_lon );
+
+		lat = next_lat;
+		lon = next_lon;
+
+	}
+
+	char label[64];
+	snprintf ( label, sizeof ( label ), "synthetic %g m hops at %g", hop, latitude );
+	checkTotal_function ( label, result, total, reference );
+
+}
+
+int main ( int argc, char **argv ) {
+
+	if ( argc < 2 ) {
+		fprintf ( stderr, "Usage: %s file.gpx [file.gpx ...]\n", argv[0] );
+		return ( 1 );
+	}
+
+	KernelResult results[] = {
+		{ "chord_poly", distanceKernelNamed ( "chord_poly" ), 0, 0, 0, 0 },
+		{ "haversine_polyf", distanceKernelNamed ( "haversine_polyf" ), 0, 0, 0, 0 },
+	};
+	int num_results = sizeof ( results ) / sizeof ( results[0] );
+
+	for ( int f = 1; f < argc; f++ ) {
+
+		GPXdoc *my_doc = createGPXdoc ( argv[f] );
+
+		if ( my_doc == NULL ) {
+			fprintf ( stderr, "Failed to parse %s\n", argv[f] );
+			return ( 1 );
+		}
+
+		for ( int k = 0; k < num_results; k++ ) {
+			checkDocument_function ( argv[f], my_doc, &results[k] );
+		}
+
+		deleteGPXdoc ( my_doc );
+
+	}
+
+	double latitudes[] = { 0, 43, 80 };
+	double hops[] = { 1, 5 };
+
+	for ( int k = 0; k < num_results; k++ ) {
+		for ( int l = 0; l < 3; l++ ) {
+			for ( int h = 0; h < 2; h++ ) {
+				checkSynthetic_function ( latitudes[l], hops[h], &results[k] );
+			}
+		}
+	}
+
+	int status = 0;
+
+	for ( int k = 0; k < num_results; k++ ) {
+
+		printf ( "%-16s worst total %.2e relative (%.3f m), worst hop %.2e m, %d over tolerance\n", results[k].name, results[k].worst_relative, results[k].worst_total, results[k].worst_hop, results[k].failures );
+
+		if ( results[k].failures > 0 ) {
+			status = 1;
+		}
+
+	}
+
+	return ( status );
+
+}
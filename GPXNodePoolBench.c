@@ -0,0 +1,195 @@
+#include "GPXParser.h"
+#include "LinkedListAPI.h"
+#include "GPXParserHelpers.h"
+#include <malloc.h>
+#include <time.h>
+
+// Description: Benchmark for the pooled list node allocator. Times insertBack + freeList against one malloc per node,
+// then churns many lists of mixed lengths and reports how much heap each approach leaves behind.
+// Build against the parser library: gcc -I/usr/include/libxml2 GPXNodePoolBench.c parser/sharedLib.so -lxml2 -lm -lpthread
+// Usage: ./a.out [nodes per list] [rounds]
+
+/* What initializeNode and freeList did before the pool, kept here as the baseline */
+typedef struct {
+	Node *head;
+	Node *tail;
+	int length;
+} MallocList;
+
+char *benchPrint ( void *data ) {
+
+	return strdup ( "" );
+
+}
+
+void benchDelete ( void *data ) {
+
+}
+
+int benchCompare ( const void *first, const void *second ) {
+
+	return 0;
+
+}
+
+double elapsed_function ( struct timespec start, struct timespec stop ) {
+
+	return ( stop.tv_sec - start.tv_sec ) + ( stop.tv_nsec - start.tv_nsec ) / 1e9;
+
+}
+
+void mallocInsertBack ( MallocList *list, void *data ) {
+
+	Node *my_node = malloc ( sizeof ( Node ) );
+
+	my_node->data = data;
+	my_node->next = NULL;
+	my_node->previous = list->tail;
+
+	if ( list->tail == NULL ) {
+		list->head = my_node;
+	} else {
+		list->tail->next = my_node;
+	}
+
+	list->tail = my_node;
+	list->length = list->length + 1;
+
+}
+
+void mallocFreeList ( MallocList *list ) {
+
+	Node *my_node = list->head;
+
+	while ( my_node != NULL ) {
+		Node *next = my_node->next;
+		free ( my_node );
+		my_node = next;
+	}
+
+	list->head = NULL;
+	list->tail = NULL;
+	list->length = 0;
+
+}
+
+/* Nodes per second through insertBack + freeList, pooled or malloc per node */
+double throughput_function ( int num_nodes, int rounds, bool pooled ) {
+
+	struct timespec start, stop;
+
+	clock_gettime ( CLOCK_MONOTONIC, &start );
+
+	for ( int r = 0; r < rounds; r++ ) {
+
+		if ( pooled ) {
+
+			List *list = initializeList ( &benchPrint, &benchDelete, &benchCompare );
+
+			for ( int i = 0; i < num_nodes; i++ ) {
+				insertBack ( list, &list );
+			}
+
+			freeList ( list );
+
+		} else {
+
+			MallocList list = { NULL, NULL, 0 };
+
+			for ( int i = 0; i < num_nodes; i++ ) {
+				mallocInsertBack ( &list, &list );
+			}
+
+			mallocFreeList ( &list );
+
+		}
+
+	}
+
+	clock_gettime ( CLOCK_MONOTONIC, &stop );
+
+	return ( (double) num_nodes * rounds ) / elapsed_function ( start, stop );
+
+}
+
+/* Builds 1000 lists of mixed lengths, frees every other one and reports the heap left in use and free */
+void fragmentation_function ( int num_nodes, bool pooled ) {
+
+	int num_lists = 1000;
+	List **lists = malloc ( sizeof ( List * ) * num_lists );
+	MallocList *plain = calloc ( num_lists, sizeof ( MallocList ) );
+
+	srand ( 2750 );
+
+	for ( int i = 0; i < num_lists; i++ ) {
+
+		int length = rand ( ) % ( 2 * num_nodes / num_lists + 1 );
+
+		if ( pooled ) {
+			lists[i] = initializeList ( &benchPrint, &benchDelete, &benchCompare );
+			for ( int j = 0; j < length; j++ ) {
+				insertBack ( lists[i], lists );
+			}
+		} else {
+			for ( int j = 0; j < length; j++ ) {
+				mallocInsertBack ( &plain[i], lists );
+			}
+		}
+
+	}
+
+	for ( int i = 0; i < num_lists; i = i + 2 ) {
+		if ( pooled ) {
+			freeList ( lists[i] );
+		} else {
+			mallocFreeList ( &plain[i] );
+		}
+	}
+
+	struct mallinfo2 heap = mallinfo2 ( );
+
+	printf ( "%-8s half freed: %8.1f MB in use, %8.1f MB free in the heap", pooled ? "pool" : "malloc", heap.uordblks / 1048576.0, heap.fordblks / 1048576.0 );
+
+	if ( pooled ) {
+		printf ( ", %d slabs", getNodePoolSlabs ( ) );
+	}
+
+	printf ( "\n" );
+
+	for ( int i = 1; i < num_lists; i = i + 2 ) {
+		if ( pooled ) {
+			freeList ( lists[i] );
+		} else {
+			mallocFreeList ( &plain[i] );
+		}
+	}
+
+	free ( lists );
+	free ( plain );
+
+}
+
+int main ( int argc, char **argv ) {
+
+	int num_nodes = argc > 1 ? atoi ( argv[1] ) : 1000000;
+	int rounds = argc > 2 ? atoi ( argv[2] ) : 10;
+
+	if ( num_nodes < 1 || rounds < 1 ) {
+		fprintf ( stderr, "Usage: %s [nodes per list] [rounds]\n", argv[0] );
+		return ( 1 );
+	}
+
+	/* The malloc baseline runs first so the pool's slabs are not yet in the heap it measures */
+	fragmentation_function ( num_nodes, false );
+	malloc_trim ( 0 );
+	fragmentation_function ( num_nodes, true );
+
+	double plain = throughput_function ( num_nodes, rounds, false );
+	double pooled = throughput_function ( num_nodes, rounds, true );
+
+	printf ( "malloc   insertBack + freeList: %8.1f M nodes/s\n", plain / 1e6 );
+	printf ( "pool     insertBack + freeList: %8.1f M nodes/s (%.2fx)\n", pooled / 1e6, pooled / plain );
+
+	return ( 0 );
+
+}
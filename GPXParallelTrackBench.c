@@ -0,0 +1,111 @@
+#include "GPXParser.h"
+#include "LinkedListAPI.h"
+#include "GPXParserHelpers.h"
+#include <time.h>
+
+// Description: Scaling benchmark for createParallelTrack. Parses one large single-track file with 1 to 16 threads
+// and prints the best of three runs for each thread count next to the serial parser.
+// Build against the parser library: gcc -I/usr/include/libxml2 GPXParallelTrackBench.c parser/sharedLib.so -lxml2 -lm -lpthread
+// Usage: ./a.out file.gpx [runs]
+
+double elapsed_function ( struct timespec start, struct timespec stop ) {
+
+	return ( stop.tv_sec - start.tv_sec ) + ( stop.tv_nsec - start.tv_nsec ) / 1e9;
+
+}
+
+long trackPoints_function ( const Track *tr ) {
+
+	if ( tr == NULL ) {
+		return -1;
+	}
+
+	long num_points = 0;
+
+	ListIterator segment_iter = createIterator ( tr->segments );
+	TrackSegment *my_segment = nextElement ( &segment_iter );
+
+	while ( my_segment != NULL ) {
+		num_points = num_points + getLength ( my_segment->waypoints );
+		my_segment = nextElement ( &segment_iter );
+	}
+
+	return num_points;
+
+}
+
+/* Best time of runs parses, 0 threads meaning the serial parser */
+double timeParse_function ( char *fileName, int numThreads, int runs, long *num_points ) {
+
+	double best = -1;
+
+	for ( int i = 0; i < runs; i++ ) {
+
+		struct timespec start, stop;
+
+		clock_gettime ( CLOCK_MONOTONIC, &start );
+		Track *my_track = numThreads == 0 ? serialTrack_function ( fileName ) : createParallelTrack ( fileName, numThreads );
+		clock_gettime ( CLOCK_MONOTONIC, &stop );
+
+		*num_points = trackPoints_function ( my_track );
+		deleteTrack ( my_track );
+
+		double seconds = elapsed_function ( start, stop );
+
+		if ( best < 0 || seconds < best ) {
+			best = seconds;
+		}
+
+	}
+
+	return best;
+
+}
+
+int main ( int argc, char **argv ) {
+
+	if ( argc < 2 ) {
+		fprintf ( stderr, "Usage: %s file.gpx [runs]\n", argv[0] );
+		return ( 1 );
+	}
+
+	int runs = argc > 2 ? atoi ( argv[2] ) : 3;
+
+	if ( runs < 1 ) {
+		runs = 1;
+	}
+
+	long serial_points = 0;
+	double serial = timeParse_function ( argv[1], 0, runs, &serial_points );
+
+	if ( serial_points < 0 ) {
+		fprintf ( stderr, "Failed to parse a track from %s\n", argv[1] );
+		return ( 1 );
+	}
+
+	printf ( "serial      %10ld points %8.3f s\n", serial_points, serial );
+
+	double single = 0;
+	int status = 0;
+
+	for ( int threads = 1; threads <= 16; threads = threads * 2 ) {
+
+		long num_points = 0;
+		double seconds = timeParse_function ( argv[1], threads, runs, &num_points );
+
+		if ( threads == 1 ) {
+			single = seconds;
+		}
+
+		printf ( "%2d threads  %10ld points %8.3f s %6.2fx\n", threads, num_points, seconds, single / seconds );
+
+		/* Every thread count has to give back the points the serial parser found */
+		if ( num_points != serial_points ) {
+			status = 1;
+		}
+
+	}
+
+	return ( status );
+
+}
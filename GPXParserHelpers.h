@@ -1,3 +1,6 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/stat.h>
 #include "GPXParser.h"
 #include "LinkedListAPI.h"
 
@@ -5,6 +8,502 @@
 // Date: 2021-03-11
 // Description: Headers for helper functions
 
+#define NODE_SLAB_SIZE 4096
+#define NODE_CACHE_LIMIT 65536
+
+/* Great-circle or ellipsoidal distance in km between two lat/lon points in degrees */
+typedef double (*DistanceKernel) ( double lat1, double lon1, double lat2, double lon2 );
+
+/* Shared store of list Nodes, carved out of NODE_SLAB_SIZE node slabs */
+typedef struct {
+	Node **slabs;
+	int num_slabs;
+	int max_slabs;
+	Node *free_nodes;
+	Node *free_tail;
+	int num_free;
+	pthread_mutex_t lock;
+} NodePool;
+
+/* Per thread chain of free nodes so insertBack does not take the pool lock */
+typedef struct {
+	Node *head;
+	Node *tail;
+	int length;
+} NodeCache;
+
+/* One piece of a trkseg body, always starting on a trkpt boundary */
+typedef struct {
+	const char *start;
+	const char *end;
+	int segment;
+	List *waypoints;
+} TrackChunk;
+
+/* Work queue shared by the parallel track parser threads */
+typedef struct {
+	TrackChunk *chunks;
+	int num_chunks;
+	int next_chunk;
+	pthread_mutex_t lock;
+} ParallelTrackJob;
+
+/* Incremental ingest state for a GPX file that is still being written */
+typedef struct {
+	char *fileName;
+	long offset;
+	GPXdoc *doc;
+	Track *track;
+	Waypoint *last_point;
+	float length;
+	int num_points;
+} GPXTail;
+
+/* Process wide table of interned otherData element names */
+typedef struct {
+	char **names;
+	int num_symbols;
+	int max_symbols;
+	int *slots;
+	int num_slots;
+	pthread_mutex_t lock;
+} GPXSymbolTable;
+
+/* otherData entry that stores an interned name id instead of GPXData's inline name */
+typedef struct {
+	int symbol;
+	char value[];
+} GPXSymbolData;
+
+#define FIXED_SCALE 10000000
+#define FIXED_BLOCK 256
+
+/* Track or route points as int32 in 1e-7 degree units, segments stored back to back */
+typedef struct {
+	int num_points;
+	int num_segments;
+	int *segment_starts;
+	int32_t *latitude;
+	int32_t *longitude;
+} FixedTrack;
+
+/* Fixed-point points stored as zigzag deltas in LEB128 varints, decoded front to back */
+typedef struct {
+	int num_points;
+	int num_segments;
+	int *segment_starts;
+	unsigned char *data;
+	size_t size;
+	size_t capacity;
+	int32_t first_lat;
+	int32_t first_lon;
+	int32_t last_lat;
+	int32_t last_lon;
+} CompressedTrack;
+
+/* Flat copy of a route's or track's coordinates in point order */
+typedef struct {
+	int length;
+	int capacity;
+	double *latitude;
+	double *longitude;
+} PointArray;
+
+#define LOD_LEVELS 10
+#define LOD_TOLERANCES { 1, 2, 5, 10, 25, 50, 100, 250, 500, 1000 }
+#define LOD_FLOOR 0.1
+
+/* Douglas-Peucker importance of every point plus the cached index list of each tolerance level (metres) */
+typedef struct {
+	const PointArray *points;
+	float *importance;
+	float tolerance[LOD_LEVELS];
+	int *level[LOD_LEVELS];
+	int level_length[LOD_LEVELS];
+} LevelOfDetail;
+
+/* Levels of detail for every route and track of one document */
+typedef struct {
+	int num_routes;
+	Route **routes;
+	LevelOfDetail **route_lods;
+	int num_tracks;
+	Track **tracks;
+	LevelOfDetail **track_lods;
+} DocumentLOD;
+
+#define FILE_CACHE_SLOTS 8
+
+/* One parsed file and the index built over it; the index may point into doc */
+typedef struct {
+	char *key;
+	char *fileName;
+	GPXdoc *doc;
+	void *index;
+} FileCacheSlot;
+
+/* The last FILE_CACHE_SLOTS files queried through one kind of index, each rebuilt when its file changes */
+typedef struct {
+	FileCacheSlot slots[FILE_CACHE_SLOTS];
+	int next_slot;
+	void *(*build) ( const GPXdoc *doc );
+	void (*destroy) ( void *index );
+	pthread_mutex_t lock;
+} FileCache;
+
+#define BBOX_CHUNK 128
+
+typedef struct {
+	double min_lat;
+	double max_lat;
+	double min_lon;
+	double max_lon;
+} BoundingBox;
+
+/* One route or track segment; its points are start..end-1 of the index and its chunk boxes start at first_chunk */
+typedef struct {
+	BoundingBox box;
+	int start;
+	int end;
+	int first_chunk;
+	int component;
+} SpatialSegment;
+
+/* Flat coordinates of every indexed segment with a box per segment and per BBOX_CHUNK points */
+typedef struct {
+	PointArray *points;
+	SpatialSegment *segments;
+	int num_segments;
+	int segment_capacity;
+	BoundingBox *chunks;
+	int num_chunks;
+	int chunk_capacity;
+	char **components;
+	int num_components;
+	int component_capacity;
+} SpatialIndex;
+
+/* label is "<file>!<Route|Track> <n>" */
+typedef struct {
+	char *label;
+	PointArray *points;
+} PointRun;
+
+typedef struct {
+	double vector[3];
+	const Waypoint *waypoint;
+	int component;
+} KDPoint;
+
+/* Implicit kd-tree over the unit vectors of every waypoint, route point and track point of a document */
+typedef struct {
+	KDPoint *points;
+	int num_points;
+	int capacity;
+	char **components;
+	int num_components;
+} KDTree;
+
+/* distance is in metres, component is "Waypoint", "Route n" or "Track n" */
+typedef struct {
+	const Waypoint *waypoint;
+	const char *component;
+	double distance;
+} Neighbour;
+
+#define GEOHASH_MIN_PRECISION 4
+#define GEOHASH_MAX_PRECISION 6
+#define GEOHASH_QUERY_CELLS 64
+#define BLOOM_BITS_PER_KEY 10
+#define BLOOM_HASHES 7
+
+typedef struct {
+	int num_bits;
+	int num_hashes;
+	unsigned char *bits;
+} BloomFilter;
+
+/* Geohash cells (precision 4 to 6) touched by one file's routes and tracks, valid while mtime (in nanoseconds) matches */
+typedef struct {
+	char *fileName;
+	int64_t mtime;
+	BloomFilter filter;
+} GeoCatalogEntry;
+
+typedef struct {
+	GeoCatalogEntry *entries;
+	int num_entries;
+	int capacity;
+} GeoCatalog;
+
+/* resolution x resolution point counts of one Web Mercator tile; counts is NULL for an empty hash slot */
+typedef struct {
+	int x;
+	int y;
+	uint32_t *counts;
+} HeatTile;
+
+/* Sparse tile grid at one zoom level plus the files already counted into it */
+typedef struct {
+	int zoom;
+	int resolution;
+	HeatTile *tiles;
+	int num_tiles;
+	int capacity;
+	char **fileNames;
+	int num_files;
+} Heatmap;
+
+typedef struct {
+	Heatmap *result;
+	List **lists;
+	int num_lists;
+	int next_list;
+	pthread_mutex_t lock;
+} HeatmapJob;
+
+#define DUP_SHAPE_POINTS 8
+#define DUP_LENGTH_SLACK 0.05
+
+/* label is "<file>!Track <n>"; cells are geohash precision 5 row and column */
+typedef struct {
+	char *label;
+	PointArray *points;
+	double length;
+	int length_bucket;
+	int start_cell[2];
+	int end_cell[2];
+	double shape[DUP_SHAPE_POINTS * 2];
+} TrackFingerprint;
+
+#define ROUTE_SNAP 20.0
+
+/* Travel from the owning node along polyline points first..last (either direction) to node to */
+typedef struct {
+	int to;
+	int polyline;
+	int first;
+	int last;
+	double length;
+} RouteEdge;
+
+typedef struct {
+	double latitude;
+	double longitude;
+	int first_edge;
+	int num_edges;
+} RouteNode;
+
+/* A crossing to add to a polyline after point index, offset (squared degrees) along that edge */
+typedef struct {
+	int polyline;
+	int index;
+	double offset;
+	double latitude;
+	double longitude;
+} RouteSplit;
+
+/* Routes and tracks split at their ends and wherever another one crosses or passes within ROUTE_SNAP metres; lengths are under kernel */
+typedef struct {
+	PointArray **polylines;
+	char **labels;
+	int num_polylines;
+	RouteNode *nodes;
+	int num_nodes;
+	RouteEdge *edges;
+	int num_edges;
+	DistanceKernel kernel;
+} RouteGraph;
+
+typedef struct {
+	char *key;
+	RouteGraph *graph;
+	pthread_mutex_t lock;
+} RouteGraphCache;
+
+/* One route or track as /find_path reports it, with the two ends it is matched on */
+typedef struct {
+	char *summary;
+	double first_lat;
+	double first_lon;
+	double last_lat;
+	double last_lon;
+} PathCandidate;
+
+/* Candidates in file order plus two orderings of their indices by first and last latitude; lengths and end matches are under kernel */
+typedef struct {
+	PathCandidate *candidates;
+	int num_candidates;
+	int capacity;
+	int *by_first;
+	int *by_last;
+	DistanceKernel kernel;
+} PathIndex;
+
+typedef struct {
+	double latitude;
+	int index;
+} LatitudeKey;
+
+typedef struct {
+	char *key;
+	PathIndex *index;
+	pthread_mutex_t lock;
+} PathIndexCache;
+
+typedef struct {
+	float start_lat;
+	float start_lon;
+	float end_lat;
+	float end_lon;
+	float delta;
+	bool valid;
+	char *result;
+} PathQuery;
+
+typedef struct {
+	const PathIndex *index;
+	PathQuery *queries;
+	int num_queries;
+	int next_query;
+	pthread_mutex_t lock;
+} PathQueryJob;
+
+typedef struct {
+	char *key;
+	SpatialIndex *index;
+	pthread_mutex_t lock;
+} SpatialIndexCache;
+
+/* One piece of a corridor polyline as unit vectors, the unit normal of its great circle and its grown box */
+typedef struct {
+	double a[3];
+	double b[3];
+	double normal[3];
+	bool degenerate;
+	BoundingBox box;
+} CorridorEdge;
+
+#define INTERSECT_MAX_CELLS 64
+
+/* Edge e of the intersection grid covers the given cell; cells pack the column in the high 32 bits */
+typedef struct {
+	long long cell;
+	int edge;
+} GridEntry;
+
+/* index_a and index_b are the first point of the crossing edge, counted from the start of its track */
+typedef struct {
+	int component_a;
+	int index_a;
+	int component_b;
+	int index_b;
+	double latitude;
+	double longitude;
+} Intersection;
+
+/* Edge e runs from point edges[e] to edges[e] + 1 of the index in planar x, y */
+typedef struct {
+	const SpatialIndex *index;
+	double *x;
+	double *y;
+	int *edges;
+	int *edge_segment;
+	int *component_start;
+	double cell;
+	Intersection *found;
+	int num_found;
+	int found_capacity;
+} IntersectionEngine;
+
+/* distance[i] is metres from the start to point i; timed[k] is the point carrying times[k], in non-decreasing time order */
+typedef struct {
+	PointArray *points;
+	double *distance;
+	double *times;
+	int *timed;
+	int num_timed;
+} TrackTimeline;
+
+/* A chart series, x ascending */
+typedef struct {
+	int length;
+	double *x;
+	double *y;
+} Series;
+
+/* Unit vectors of the first and last point of a Route or Track */
+typedef struct {
+	const void *component;
+	double first[3];
+	double last[3];
+} EndVectors;
+
+/* Open addressing by component pointer with linear probing; capacity is a power of two */
+typedef struct {
+	EndVectors *slots;
+	int capacity;
+	int count;
+	pthread_mutex_t lock;
+} EndVectorTable;
+
+/* One route or track and its length; number is its 1-based position in the document, label is set only across a corpus */
+typedef struct {
+	float length;
+	int number;
+	const void *component;
+	char *label;
+} LengthEntry;
+
+/* Routes and tracks of one document sorted by length under the kernel they were measured with */
+typedef struct {
+	const GPXdoc *doc;
+	DistanceKernel kernel;
+	LengthEntry *routes;
+	int num_routes;
+	LengthEntry *tracks;
+	int num_tracks;
+} LengthIndex;
+
+typedef struct {
+	LengthIndex **indexes;
+	int num_indexes;
+	int capacity;
+	pthread_mutex_t lock;
+} LengthIndexTable;
+
+typedef struct {
+	char *key;
+	DistanceKernel kernel;
+	LengthEntry *entries;
+	int num_entries;
+	pthread_mutex_t lock;
+} CorpusLengthCache;
+
+/* What one file adds to the corpus totals, so it can be taken out again when the file changes */
+typedef struct {
+	char *fileName;
+	int waypoints;
+	int routes;
+	int tracks;
+	double distance;
+} CorpusStatsEntry;
+
+typedef struct {
+	int files;
+	int64_t waypoints;
+	int64_t routes;
+	int64_t tracks;
+	double distance;
+} CorpusTotals;
+
+typedef struct {
+	CorpusTotals totals;
+	CorpusStatsEntry *entries;
+	int num_entries;
+	int capacity;
+} CorpusStats;
+
 int waypoint_get ( List *my_waypoint_List );
 int route_get ( List *my_route_List );
 Waypoint *waypoint_function ( xmlNode *cur_node );
@@ -12,3 +511,280 @@ Route *route_function ( xmlNode *cur_node );
 Track *track_function ( xmlNode *cur_node );
 bool validator_xml ( xmlDoc *doc , char* gpxSchemaFile);
 xmlDocPtr GPXtoXML ( GPXdoc* doc );
+void spliceList ( List* destination, List* source );
+Node* allocateNode ( void );
+void releaseNodeChain ( Node* head, Node* tail, int length );
+void releaseNode ( Node* node );
+int getNodePoolSlabs ( void );
+void flushNodeCache ( void* data );
+void createNodeCacheKey ( void );
+void registerNodeCache ( void );
+void unpackList ( List* list );
+Waypoint *trackpoint_function ( xmlNode *cur_node );
+const char *findTag ( const char *buffer, const char *end, const char *tag );
+List *trackpointChunk_function ( const char *start, const char *end );
+void *parallelTrack_worker ( void *data );
+bool prefixedTrackTags_function ( const char *buffer, const char *end );
+Track *serialTrack_function ( char* fileName );
+Track *createParallelTrack ( char* fileName, int numThreads );
+double equirectangularDistance ( double p1x, double p1y, double p2x, double p2y );
+double chordDistance ( double lat1, double lon1, double lat2, double lon2 );
+double vincentyDistance ( double p1x, double p1y, double p2x, double p2y );
+void polySinCos_function ( double x, double *s, double *c );
+double polyAsin_function ( double x );
+void polySinCosF_function ( float x, float *s, float *c );
+float polyAsinF_function ( float x );
+double polyChordDistance ( double lat1, double lon1, double lat2, double lon2 );
+double polyHaversineDistanceF ( double lat1, double lon1, double lat2, double lon2 );
+bool setDistanceKernel ( const char *name );
+bool withinDistance ( double p1x, double p1y, double p2x, double p2y, double delta );
+DistanceKernel distanceKernelNamed ( const char *name );
+bool withinDistanceKernel ( double p1x, double p1y, double p2x, double p2y, double delta, DistanceKernel kernel );
+float trackLenKernel ( const Track *tr, DistanceKernel kernel );
+float routeLenKernel ( const Route *rt, DistanceKernel kernel );
+bool isLoopTrackKernel ( const Track *tr, float delta, DistanceKernel kernel );
+bool isLoopRouteKernel ( const Route* route, float delta, DistanceKernel kernel );
+char *pathFindKernel ( char* fileName, char* gpxSchemaFile, float start_lat, float start_lon, float end_lat, float end_lon, float delta, char* kernelName );
+float distance_function ( float p1x, float p1y, float p2x, float p2y );
+float kernelDistance_function ( DistanceKernel kernel, float p1x, float p1y, float p2x, float p2y );
+const char *trackpointEnd ( const char *start, const char *end );
+int tailAppend_function ( GPXTail *tail, const char *start, const char *end );
+const char *tailScan_function ( GPXTail *tail, const char *start, const char *end, int *num_new );
+Track *tailTrack_function ( const char *start, const char *end );
+GPXTail *openGPXTail ( char* fileName );
+int refreshGPXTail ( GPXTail *tail );
+float getTailTrackLen ( const GPXTail *tail );
+void closeGPXTail ( GPXTail *tail );
+int internSymbol ( const char *name );
+const char *getSymbolName ( int symbol );
+GPXSymbolData *symbolData_function ( const char *name, const char *value );
+void deleteSymbolData ( void* data );
+char* symbolDataToString ( void* data );
+int compareSymbolData ( const void *first, const void *second );
+bool isSymbolList ( const List *otherData );
+const char *gpxDataName ( const List *otherData, const void *data );
+const char *gpxDataValue ( const List *otherData, const void *data );
+List *internOtherData ( List *otherData );
+List *expandOtherData ( List *otherData );
+void waypointOtherData_function ( List *waypoints, List *(*convert)( List *otherData ) );
+void convertOtherData_function ( GPXdoc *doc, List *(*convert)( List *otherData ) );
+void internGPXdoc ( GPXdoc *doc );
+void expandGPXdoc ( GPXdoc *doc );
+void deletePackedData ( void* data );
+List *packOtherData ( List *otherData );
+bool isPackedList ( const List *otherData );
+void packGPXdoc ( GPXdoc *doc );
+size_t allocationBytes ( size_t size );
+size_t otherDataBytes ( const List *otherData );
+void waypointBytes_function ( List *waypoints, size_t *bytes, int *num_points );
+float otherDataBytesPerPoint ( const GPXdoc *doc );
+char *otherDataMemoryReport ( char* fileName );
+int32_t toFixedCoordinate ( double degrees );
+double fromFixedCoordinate ( int32_t fixed );
+FixedTrack *fixedTrack_function ( int num_points, int num_segments );
+void fixedAppend_function ( FixedTrack *my_fixed, List *waypoints );
+FixedTrack *trackToFixed ( const Track *tr );
+FixedTrack *routeToFixed ( const Route *rt );
+double getFixedLatitude ( const FixedTrack *ft, int i );
+double getFixedLongitude ( const FixedTrack *ft, int i );
+float getFixedTrackLen ( const FixedTrack *ft );
+bool isLoopFixedTrack ( const FixedTrack *ft, float delta );
+Track *fixedToTrack ( const FixedTrack *ft, char *name );
+void deleteFixedTrack ( FixedTrack *ft );
+void varintWrite_function ( CompressedTrack *ct, int64_t delta );
+int64_t varintRead_function ( const unsigned char **cursor );
+CompressedTrack *fixedToCompressed ( const FixedTrack *ft );
+CompressedTrack *compressTrack ( const Track *tr );
+CompressedTrack *compressRoute ( const Route *rt );
+FixedTrack *compressedToFixed ( const CompressedTrack *ct );
+float getCompressedTrackLen ( const CompressedTrack *ct );
+bool isLoopCompressedTrack ( const CompressedTrack *ct, float delta );
+size_t compressedTrackBytes ( const CompressedTrack *ct );
+void deleteCompressedTrack ( CompressedTrack *ct );
+PointArray *pointArray_function ( int capacity );
+void addPoint ( PointArray *points, double latitude, double longitude );
+void pointArrayAppend_function ( PointArray *points, List *waypoints );
+PointArray *trackToPointArray ( const Track *tr );
+PointArray *routeToPointArray ( const Route *rt );
+void deletePointArray ( PointArray *points );
+char *pointArrayToJSON ( const PointArray *points );
+double segmentDistance_function ( double px, double py, double ax, double ay, double bx, double by );
+LevelOfDetail *buildLevelOfDetail ( const PointArray *points );
+PointArray *getLevelOfDetail ( const LevelOfDetail *lod, float tolerance );
+void deleteLevelOfDetail ( LevelOfDetail *lod );
+DocumentLOD *buildDocumentLOD ( const GPXdoc *doc );
+PointArray *getRouteLOD ( const DocumentLOD *lod, const Route *rt, float tolerance );
+PointArray *getTrackLOD ( const DocumentLOD *lod, const Track *tr, float tolerance );
+void deleteDocumentLOD ( DocumentLOD *lod );
+PointArray *componentPoints_function ( const GPXdoc *doc, const char *componentName );
+void *buildLODIndex_function ( const GPXdoc *doc );
+void deleteLODIndex_function ( void *index );
+void *cachedFileIndex ( FileCache *cache, char *fileName, char *gpxSchemaFile );
+const LevelOfDetail *componentLOD_function ( const DocumentLOD *lod, const char *componentName );
+char *getSimplifiedPoints ( char* fileName, char* gpxSchemaFile, char* componentName, float tolerance );
+PointArray *resamplePoints ( const PointArray *points, float interval );
+PointArray *resampleTrack ( const Track *tr, float interval );
+PointArray *resampleRoute ( const Route *rt, float interval );
+List *resampleWaypoints_function ( List *waypoints, float interval );
+bool writeResampledGPXdoc ( GPXdoc* doc, char* fileName, float interval );
+char *getResampledPoints ( char* fileName, char* gpxSchemaFile, char* componentName, float interval );
+void boxInclude_function ( BoundingBox *box, double latitude, double longitude );
+bool boxOverlap_function ( const BoundingBox *a, const BoundingBox *b );
+bool boxContains_function ( const BoundingBox *box, double latitude, double longitude );
+SpatialIndex *spatialIndex_function ( void );
+int spatialComponent_function ( SpatialIndex *index, const char *fileName, const char *type, int number );
+void spatialSegment_function ( SpatialIndex *index, List *waypoints, int component );
+void addDocumentToSpatialIndex ( SpatialIndex *index, const GPXdoc *doc, const char *fileName );
+void deleteSpatialIndex ( SpatialIndex *index );
+void deletePointRun ( void* data );
+char* pointRunToString ( void* data );
+int comparePointRuns ( const void *first, const void *second );
+PointRun *pointRun_function ( const SpatialIndex *index, int component, int first, int last );
+List *queryBoundingBox ( const SpatialIndex *index, BoundingBox box );
+char *pointRunsToJSON ( List *runs );
+SpatialIndex *buildSpatialIndex ( char* fileNames, char* gpxSchemaFile );
+char *getBoxPoints ( char* fileNames, char* gpxSchemaFile, float minLat, float maxLat, float minLon, float maxLon );
+void unitVector_function ( double latitude, double longitude, double vector[3] );
+void kdAdd_function ( KDTree *tree, const Waypoint *waypoint, int component );
+int kdComponent_function ( KDTree *tree, const char *type, int number );
+void kdSelect_function ( KDPoint *points, int left, int right, int nth, int axis );
+void kdBuild_function ( KDPoint *points, int left, int right, int depth );
+KDTree *buildKDTree ( const GPXdoc *doc );
+void deleteKDTree ( KDTree *tree );
+void knnPush_function ( int *heap, double *heap_dist, int *size, int k, int index, double dist );
+void kdSearch_function ( const KDTree *tree, int left, int right, int depth, const double query[3], int *heap, double *heap_dist, int *size, int k );
+int nearestPoints ( const KDTree *tree, float latitude, float longitude, int k, Neighbour *results );
+void *buildKDIndex_function ( const GPXdoc *doc );
+void deleteKDIndex_function ( void *index );
+char *getNearestPoints ( char* fileName, char* gpxSchemaFile, float latitude, float longitude, int k );
+void geohash_function ( double latitude, double longitude, int precision, char *hash );
+uint64_t bloomHash_function ( const char *key );
+BloomFilter bloomFilter_function ( int expected );
+void bloomAdd ( BloomFilter *filter, const char *key );
+bool bloomContains ( const BloomFilter *filter, const char *key );
+void geoCells_function ( List *waypoints, char **cells, int *num_cells, int *capacity );
+BloomFilter buildGeoFilter ( const GPXdoc *doc );
+bool geoBoxMayContain_function ( const BloomFilter *filter, double min_lat, double max_lat, double min_lon, double max_lon );
+bool geoFilterMayContain ( const BloomFilter *filter, float latitude, float longitude, float radius );
+GeoCatalog *loadGeoCatalog ( const char *catalogFile );
+bool saveGeoCatalog ( const GeoCatalog *catalog, const char *catalogFile );
+int64_t fileStamp_function ( const struct stat *file_stat );
+GeoCatalogEntry *geoCatalogEntry ( GeoCatalog *catalog, char *fileName, char *gpxSchemaFile, bool *changed );
+void deleteGeoCatalog ( GeoCatalog *catalog );
+char *getCandidateFiles ( char* fileNames, char* catalogFile, char* gpxSchemaFile, float start_lat, float start_lon, float end_lat, float end_lon, float delta );
+Heatmap *heatmap_function ( int zoom, int resolution );
+uint32_t heatTileHash_function ( int x, int y );
+HeatTile *heatTile_function ( Heatmap *heatmap, int x, int y );
+const HeatTile *findHeatTile ( const Heatmap *heatmap, int x, int y );
+void heatmapAddPoint ( Heatmap *heatmap, double latitude, double longitude );
+void heatmapAddWaypoints ( Heatmap *heatmap, List *waypoints );
+void heatmapAddDocument ( Heatmap *heatmap, const GPXdoc *doc );
+void mergeHeatmap ( Heatmap *destination, const Heatmap *source );
+void heatmapIncludeFile ( Heatmap *heatmap, const char *fileName );
+bool heatmapHasFile ( const Heatmap *heatmap, const char *fileName );
+void deleteHeatmap ( Heatmap *heatmap );
+void *heatmapWorker_function ( void *arg );
+void runHeatmapJob ( HeatmapJob *job, int numThreads );
+void heatmapAccumulate ( Heatmap *heatmap, const GPXdoc *doc, int numThreads );
+Heatmap *heatmapDocument ( const GPXdoc *doc, int zoom, int resolution, int numThreads );
+Heatmap *heatmapFiles ( char *fileNames, char *gpxSchemaFile, int zoom, int resolution, int numThreads );
+bool saveHeatmap ( const Heatmap *heatmap, const char *heatmapFile );
+Heatmap *loadHeatmap ( const char *heatmapFile );
+char *heatmapTileToJSON ( const Heatmap *heatmap, int x, int y );
+int rebuildHeatmap ( char* heatmapFile, char* fileNames, char* gpxSchemaFile, int zoom, int resolution, int numThreads );
+int addFileToHeatmap ( char* heatmapFile, char* fileName, char* gpxSchemaFile, int zoom, int resolution );
+int addRouteToHeatmap ( char* heatmapFile, char* fileName, char* gpxSchemaFile, int zoom, int resolution );
+char *getHeatmapTile ( char* heatmapFile, int x, int y );
+void geoCell_function ( double latitude, double longitude, int cell[2] );
+double localDistance_function ( double lat1, double lon1, double lat2, double lon2, double scale );
+TrackFingerprint *fingerprintTrack ( const Track *tr, const char *label );
+void deleteTrackFingerprint ( TrackFingerprint *print );
+bool frechetWithin ( const PointArray *a, const PointArray *b, double tolerance );
+bool duplicateCandidate ( const TrackFingerprint *a, const TrackFingerprint *b, double tolerance );
+int compareFingerprintLength ( const void *first, const void *second );
+char *findDuplicateTracks ( TrackFingerprint **prints, int num_prints, double tolerance );
+char *getDuplicateTracks ( char* fileNames, char* gpxSchemaFile, float tolerance );
+int graphFind_function ( int *parent, int vertex );
+uint64_t snapCell_function ( const double vector[3], int dx, int dy, int dz );
+void graphPolyline_function ( RouteGraph *graph, PointArray *points, const char *fileName, const char *type, int number );
+int compareRouteSplits ( const void *first, const void *second );
+void splitRouteCrossings_function ( RouteGraph *graph );
+void buildRouteGraphEdges ( RouteGraph *graph );
+RouteGraph *buildRouteGraph ( char *fileNames, char *gpxSchemaFile );
+void deleteRouteGraph ( RouteGraph *graph );
+int nearestRouteNode ( const RouteGraph *graph, float latitude, float longitude, float delta );
+int routeGraphSearch ( const RouteGraph *graph, int start, int goal, int *path_edges );
+char *routeGraphPathToJSON ( const RouteGraph *graph, float start_lat, float start_lon, float end_lat, float end_lon, float delta );
+char *routeGraphKey ( char *fileNames, char *gpxSchemaFile );
+char *findRoutePath ( char* fileNames, char* gpxSchemaFile, float start_lat, float start_lon, float end_lat, float end_lon, float delta );
+void pathCandidate_function ( PathIndex *index, const char *type, const char *name, int num_points, float length, bool loop, double first_lat, double first_lon, double last_lat, double last_lon );
+void pathIndexDocument ( PathIndex *index, const GPXdoc *doc );
+int compareLatitudeKeys ( const void *first, const void *second );
+PathIndex *buildPathIndex ( char *fileNames, char *gpxSchemaFile );
+void deletePathIndex ( PathIndex *index );
+void pathIndexNear_function ( const PathIndex *index, bool first, float latitude, float longitude, float delta, bool *matched );
+char *pathQuery_function ( const PathIndex *index, const PathQuery *query );
+void *pathQueryWorker_function ( void *arg );
+void runPathQueries ( const PathIndex *index, PathQuery *queries, int num_queries, int numThreads );
+int jsonString_function ( char *out, const char *text );
+char *batchPathFind ( char* fileNames, char* gpxSchemaFile, char* queries, int numThreads );
+SpatialIndex *cachedSpatialIndex ( char* fileNames, char* gpxSchemaFile );
+double chordAngle_function ( const double p[3], const double q[3] );
+CorridorEdge corridorEdge_function ( double lat1, double lon1, double lat2, double lon2, double distance );
+double pointSegmentDistance ( const double p[3], const CorridorEdge *edge );
+int corridorQuery ( const SpatialIndex *index, const PointArray *corridor, double distance, bool *hit );
+char *getCorridorComponents ( char* fileNames, char* gpxSchemaFile, char* corridor, float distance );
+int compareGridEntries ( const void *first, const void *second );
+int compareIntersections ( const void *first, const void *second );
+long long gridCell_function ( double x, double y, double cell );
+void intersectEdges_function ( IntersectionEngine *engine, int e, int f, long long cell );
+Intersection *findTrackIntersections ( const SpatialIndex *index, int *num_found );
+Intersection *findIntersections_function ( const SpatialIndex *index, bool tracksOnly, int *num_found );
+char *getTrackIntersections ( char* fileNames, char* gpxSchemaFile );
+bool parseTime_function ( const char *text, double *seconds );
+const char *waypointTime_function ( const Waypoint *wpt );
+TrackTimeline *buildTrackTimeline ( const Track *tr );
+void deleteTrackTimeline ( TrackTimeline *timeline );
+bool positionAtDistance ( const TrackTimeline *timeline, double metres, double *latitude, double *longitude );
+bool positionAtTime ( const TrackTimeline *timeline, double seconds, double *latitude, double *longitude );
+char *getTrackPositions ( char* fileName, char* gpxSchemaFile, char* componentName, char* mode, char* values );
+Series *series_function ( int capacity );
+void deleteSeries ( Series *series );
+Series *elevationSeries ( const Track *tr, const TrackTimeline *timeline );
+Series *speedSeries ( const TrackTimeline *timeline );
+Series *largestTriangleThreeBuckets ( const Series *series, int threshold );
+char *seriesToJSON ( const Series *series );
+char *getTrackProfile ( char* fileName, char* gpxSchemaFile, char* componentName, char* kind, int numPoints );
+int endVectorSlot_function ( const void *component, int capacity );
+void endVectorInsert_function ( const void *component, const Waypoint *first, const Waypoint *last );
+void endVectorRemove_function ( const void *component );
+void attachEndVectors ( const GPXdoc *doc );
+void detachEndVectors ( const GPXdoc *doc );
+void dropEndVectors ( const void *component );
+bool endVectorsActive_function ( DistanceKernel kernel );
+bool endVectors_function ( const void *component, double first[3], double last[3] );
+double chordLimit_function ( double delta );
+double chordSquared_function ( const double a[3], const double b[3] );
+int compareLengthEntries ( const void *first, const void *second );
+LengthEntry *lengthEntries_function ( List *list, bool routes, int *count );
+LengthIndex *buildLengthIndex ( const GPXdoc *doc );
+void deleteLengthIndex ( LengthIndex *index );
+int lengthRange_function ( const LengthEntry *entries, int count, float len, float delta, int *first );
+List *lengthIndexItems ( const LengthIndex *index, bool routes, float len, float delta );
+void attachLengthIndex ( const GPXdoc *doc );
+void detachLengthIndex ( const GPXdoc *doc );
+void dropLengthIndexOf ( const void *component );
+int lengthIndexCount_function ( const GPXdoc *doc, bool routes, float len, float delta );
+LengthEntry *buildCorpusLengths ( char *fileNames, char *gpxSchemaFile, int *count );
+char *getComponentsWithLength ( char* fileNames, char* gpxSchemaFile, float len, float delta );
+CorpusStats *loadCorpusStats ( const char *statsFile );
+bool readCorpusTotals_function ( FILE *fp, CorpusTotals *totals );
+void corpusTotals_function ( CorpusStats *stats );
+void corpusStatsAdd_function ( CorpusTotals *totals, const CorpusStatsEntry *entry, int sign );
+bool saveCorpusStats ( const CorpusStats *stats, const char *statsFile );
+void deleteCorpusStats ( CorpusStats *stats );
+bool corpusStatsRemove_function ( CorpusStats *stats, const char *fileName );
+void corpusStatsInclude_function ( CorpusStats *stats, char *fileName, char *gpxSchemaFile );
+int rebuildCorpusStats ( char* statsFile, char* fileNames, char* gpxSchemaFile );
+int updateCorpusStats ( char* statsFile, char* fileName, char* gpxSchemaFile );
+char *getCorpusStats ( char* statsFile );
@@ -53,6 +53,9 @@ app.post('/upload', function(req, res) {
       return res.status(500).send(err);
     }
 
+    updateHeatmap( 'uploads/' + uploadFile.name );
+    updateCorpusStats( 'uploads/' + uploadFile.name );
+
     res.redirect('/');
   });
 });
@@ -82,8 +85,94 @@ let sharedLib = ffi.Library('./parser/sharedLib', {
   'JSONtoGPX_create' : [ 'int', [ 'string', 'string', 'string' ] ],
   'addRouteToGPX' : [ 'int', [ 'string', 'string', 'string', 'string' ] ],
   'pathFindReturn' : [ 'string', [ 'string', 'string', 'float', 'float', 'float', 'float', 'float' ] ],
+  'pathFindKernel' : [ 'string', [ 'string', 'string', 'float', 'float', 'float', 'float', 'float', 'string' ] ],
+  'getSimplifiedPoints' : [ 'string', [ 'string', 'string', 'string', 'float' ] ],
+  'getResampledPoints' : [ 'string', [ 'string', 'string', 'string', 'float' ] ],
+  'getBoxPoints' : [ 'string', [ 'string', 'string', 'float', 'float', 'float', 'float' ] ],
+  'getNearestPoints' : [ 'string', [ 'string', 'string', 'float', 'float', 'int' ] ],
+  'getCandidateFiles' : [ 'string', [ 'string', 'string', 'string', 'float', 'float', 'float', 'float', 'float' ] ],
+  'rebuildHeatmap' : [ 'int', [ 'string', 'string', 'string', 'int', 'int', 'int' ] ],
+  'addFileToHeatmap' : [ 'int', [ 'string', 'string', 'string', 'int', 'int' ] ],
+  'addRouteToHeatmap' : [ 'int', [ 'string', 'string', 'string', 'int', 'int' ] ],
+  'getHeatmapTile' : [ 'string', [ 'string', 'int', 'int' ] ],
+  'getDuplicateTracks' : [ 'string', [ 'string', 'string', 'float' ] ],
+  'findRoutePath' : [ 'string', [ 'string', 'string', 'float', 'float', 'float', 'float', 'float' ] ],
+  'batchPathFind' : [ 'string', [ 'string', 'string', 'string', 'int' ] ],
+  'getCorridorComponents' : [ 'string', [ 'string', 'string', 'string', 'float' ] ],
+  'getTrackIntersections' : [ 'string', [ 'string', 'string' ] ],
+  'getTrackPositions' : [ 'string', [ 'string', 'string', 'string', 'string', 'string' ] ],
+  'getTrackProfile' : [ 'string', [ 'string', 'string', 'string', 'string', 'int' ] ],
+  'getComponentsWithLength' : [ 'string', [ 'string', 'string', 'float', 'float' ] ],
+  'rebuildCorpusStats' : [ 'int', [ 'string', 'string', 'string' ] ],
+  'updateCorpusStats' : [ 'int', [ 'string', 'string', 'string' ] ],
+  'getCorpusStats' : [ 'string', [ 'string' ] ],
 });
 
+let heatmapZoom = 14;
+let heatmapResolution = 256;
+
+// Rebuilds the saved heatmap from every upload
+function rebuildHeatmap () {
+
+  let filenames = fs.readdirSync("uploads");
+  let long_files = "";
+
+  for ( let i = 0; i < filenames.length; i++ ) {
+    if ( filenames[i].endsWith(".gpx") ) {
+      long_files = long_files + "uploads/" + filenames[i] + "!";
+    }
+  }
+
+  sharedLib.rebuildHeatmap( "uploads/heatmap.bin", long_files, "parser/gpx.xsd", heatmapZoom, heatmapResolution, 4 );
+
+}
+
+// Counts a newly uploaded file into the saved heatmap, rebuilding it when the file was already counted or none is saved
+function updateHeatmap ( fileName ) {
+
+  if ( sharedLib.addFileToHeatmap( "uploads/heatmap.bin", fileName, "parser/gpx.xsd", heatmapZoom, heatmapResolution ) == 0 ) {
+    rebuildHeatmap();
+  }
+
+}
+
+// Counts only the route just appended to fileName, rebuilding the heatmap when none is saved
+function updateHeatmapRoute ( fileName ) {
+
+  if ( sharedLib.addRouteToHeatmap( "uploads/heatmap.bin", fileName, "parser/gpx.xsd", heatmapZoom, heatmapResolution ) == 0 ) {
+    rebuildHeatmap();
+  }
+
+}
+
+// Recounts one file in the saved corpus statistics, rebuilding them from every upload when none are saved yet
+function updateCorpusStats ( fileName ) {
+
+  if ( !fileName.startsWith("uploads/") ) {
+    return;
+  }
+
+  if ( sharedLib.updateCorpusStats( "uploads/gpx.stats", fileName, "parser/gpx.xsd" ) == 0 ) {
+    rebuildCorpusStats();
+  }
+
+}
+
+function rebuildCorpusStats () {
+
+  let filenames = fs.readdirSync("uploads");
+  let long_files = "";
+
+  for ( let i = 0; i < filenames.length; i++ ) {
+    if ( filenames[i].endsWith(".gpx") ) {
+      long_files = long_files + "uploads/" + filenames[i] + "!";
+    }
+  }
+
+  sharedLib.rebuildCorpusStats( "uploads/gpx.stats", long_files, "parser/gpx.xsd" );
+
+}
+
 app.get('/new_rows', function(req , res){
 
   let filenames = fs.readdirSync("uploads");
@@ -425,6 +514,7 @@ for ( let i = 0; i < full_doc_info.length; i++ ) {
 }
 
   let check = sharedLib.changeTheNameofGPX( "./uploads/"+req.query.fileChange, "parser/gpx.xsd", req.query.userInput, req.query.changeName );
+  updateCorpusStats( "uploads/"+req.query.fileChange );
 
   res.send(
     {
@@ -718,6 +808,10 @@ app.get('/add_route', function(req , res){
 
   if ( !(req.query.fileName == "FALSE") ) {
     checker = sharedLib.addRouteToGPX( "./uploads/"+req.query.fileName, "parser/gpx.xsd", route_string, all_waypoints );
+    if ( checker == 1 ) {
+      updateHeatmapRoute( "uploads/"+req.query.fileName );
+    }
+    updateCorpusStats( "uploads/"+req.query.fileName );
     route_string = "";
     all_waypoints = "";
   }
@@ -732,6 +826,47 @@ app.get('/add_route', function(req , res){
 
 app.get('/find_path', function(req , res){
 
+  let filenames = fs.readdirSync("uploads");
+  let long_files = "";
+
+  for ( let i = 0; i < filenames.length; i++ ) {
+    if ( filenames[i].endsWith(".gpx") ) {
+      long_files = long_files + "uploads/" + filenames[i] + "!";
+    }
+  }
+
+  // Files whose catalog filter has no cells near either end are never opened
+  let candidates = sharedLib.getCandidateFiles( long_files, "uploads/gpx.catalog", "parser/gpx.xsd", req.query.start_lat, req.query.start_lon, req.query.end_lat, req.query.end_lon, req.query.delta ).split("!");
+
+  let final_for_chart = "";
+
+  // kernel is "equirectangular", "chord" (default) or "vincenty", passed with each call rather than set globally
+  let kernel = req.query.kernel != undefined ? req.query.kernel : "";
+
+  for ( let i = 0; i < candidates.length; i++ ) {
+
+    if ( candidates[i] != "" ) {
+
+      let path = sharedLib.pathFindKernel ( candidates[i], "parser/gpx.xsd", req.query.start_lat, req.query.start_lon, req.query.end_lat, req.query.end_lon, req.query.delta, kernel );
+
+      if ( path != null && path != "" ) {
+        final_for_chart = final_for_chart + path;
+      }
+
+    }
+
+  }
+
+  res.send(
+    {
+      variable12: final_for_chart
+    }
+  );
+
+});
+
+app.get('/create_doc', function(req , res){
+
   let filenames = fs.readdirSync("uploads");
 let j = 0;
 
@@ -809,114 +944,274 @@ for ( let i = 0; i < full_doc_info.length; i++ ) {
 
 }
 
-  let final_for_chart = "";
+  let final_string = "{\"version\":1.1,\"creator\":\"Carson Mifsud\"}";
 
-  for ( let i = 0; i < JSON_files_names.length; i++ ) {
+  if ( req.query.current != "FALSE" ) {
+    let checker = sharedLib.JSONtoGPX_create ( final_string, "./uploads/" + req.query.current, "parser/gpx.xsd" );
+    updateCorpusStats( "uploads/" + req.query.current );
+  }
 
-    if ( ( sharedLib.pathFindReturn ( "uploads/"+JSON_files_names[i], "parser/gpx.xsd", req.query.start_lat, req.query.start_lon, req.query.end_lat, req.query.end_lon, req.query.delta) ) != "" ) {
+  res.send(
+    {
+      variable14: my_array
+    }
+  );
 
-      final_for_chart = final_for_chart + sharedLib.pathFindReturn ( "uploads/"+JSON_files_names[i], "parser/gpx.xsd", req.query.start_lat, req.query.start_lon, req.query.end_lat, req.query.end_lon, req.query.delta );
-    
+});
+
+app.get('/simplified_points', function(req , res){
+
+  let points = sharedLib.getSimplifiedPoints( "uploads/"+req.query.fileName, "parser/gpx.xsd", req.query.componentName, parseFloat(req.query.tolerance) );
+
+  res.send(
+    {
+      variable12: points
+    }
+  );
+
+});
+
+app.get('/resampled_points', function(req , res){
+
+  let points = sharedLib.getResampledPoints( "uploads/"+req.query.fileName, "parser/gpx.xsd", req.query.componentName, parseFloat(req.query.interval) );
+
+  res.send(
+    {
+      variable12: points
+    }
+  );
+
+});
+
+app.get('/box_points', function(req , res){
+
+  let filenames = fs.readdirSync("uploads");
+  let long_files = "";
+
+  for ( let i = 0; i < filenames.length; i++ ) {
+    if ( filenames[i].endsWith(".gpx") ) {
+      long_files = long_files + "uploads/" + filenames[i] + "!";
     }
-  
   }
 
+  let points = sharedLib.getBoxPoints( long_files, "parser/gpx.xsd", parseFloat(req.query.minLat), parseFloat(req.query.maxLat), parseFloat(req.query.minLon), parseFloat(req.query.maxLon) );
+
   res.send(
     {
-      variable12: final_for_chart
+      variable12: points
     }
   );
 
 });
 
-app.get('/create_doc', function(req , res){
+app.get('/nearest_points', function(req , res){
+
+  let points = sharedLib.getNearestPoints( "uploads/"+req.query.fileName, "parser/gpx.xsd", parseFloat(req.query.lat), parseFloat(req.query.lon), parseInt(req.query.k) );
+
+  res.send(
+    {
+      variable12: points
+    }
+  );
+
+});
+
+app.get('/heatmap_tile', function(req , res){
+
+  let tile = sharedLib.getHeatmapTile( "uploads/heatmap.bin", parseInt(req.query.x), parseInt(req.query.y) );
+
+  res.send(
+    {
+      variable12: tile
+    }
+  );
+
+});
+
+app.get('/duplicate_tracks', function(req , res){
 
   let filenames = fs.readdirSync("uploads");
-let j = 0;
+  let long_files = "";
 
-let doc_info = null;
-let full_doc_info = "";
-let full_doc_info_table = "";
-let tableObject = null;
-let version = null;
-let creator = "";
-let files = "";
-let JSON_files = [];
-let JSON_files_names = [];
-let numWaypoints = null;
-let numRoutes = null;
-let numTracks = null;
-let tracker = 0;
-let long_files = "";
+  for ( let i = 0; i < filenames.length; i++ ) {
+    if ( filenames[i].endsWith(".gpx") ) {
+      long_files = long_files + "uploads/" + filenames[i] + "!";
+    }
+  }
 
-for ( let i = 0; i < filenames.length; i++ ) {
+  let duplicates = sharedLib.getDuplicateTracks( long_files, "parser/gpx.xsd", parseFloat(req.query.tolerance) );
 
-  if ( filenames[i][(filenames[i].length)-1] == 'x' && filenames[i][(filenames[i].length)-2] == 'p' && filenames[i][(filenames[i].length)-3] == 'g' && filenames[i][(filenames[i].length)-4] == '.' ) {
+  res.send(
+    {
+      variable12: duplicates
+    }
+  );
 
-    doc_info = sharedLib.createValidGPXdocAndFillTableInfo( "uploads/" + filenames[i], "parser/gpx.xsd" );
+});
 
-    if ( doc_info != null ) {
+app.get('/route_path', function(req , res){
 
-      long_files = long_files + filenames[i] + "!";
+  let filenames = fs.readdirSync("uploads");
+  let long_files = "";
 
-      JSON_files[tracker] = doc_info;
+  for ( let i = 0; i < filenames.length; i++ ) {
+    if ( filenames[i].endsWith(".gpx") ) {
+      long_files = long_files + "uploads/" + filenames[i] + "!";
+    }
+  }
 
-      JSON_files_names[tracker] = filenames[i];
+  let path = sharedLib.findRoutePath( long_files, "parser/gpx.xsd", req.query.start_lat, req.query.start_lon, req.query.end_lat, req.query.end_lon, req.query.delta );
 
-      tableObject = JSON.parse( doc_info );
-      version = version + tableObject.version + '\0';
-      creator = creator + tableObject.creator + '\0';
-      numWaypoints = numWaypoints + tableObject.numWaypoints + '\0';
-      numRoutes = numRoutes + tableObject.numRoutes + '\0';
-      numTracks = numTracks + tableObject.numTracks + '\0';
-      files = files + filenames[i] + '\0';
-    
-      tracker = tracker + 1;
+  res.send(
+    {
+      variable12: path
+    }
+  );
+
+});
+
+// queries is a JSON array of { start_lat, start_lon, end_lat, end_lon, delta }; answers come back in the same order
+app.get('/batch_find_path', function(req , res){
+
+  let filenames = fs.readdirSync("uploads");
+  let long_files = "";
 
+  for ( let i = 0; i < filenames.length; i++ ) {
+    if ( filenames[i].endsWith(".gpx") ) {
+      long_files = long_files + "uploads/" + filenames[i] + "!";
     }
+  }
 
+  let queries = JSON.parse( req.query.queries );
+  let long_queries = "";
+
+  for ( let i = 0; i < queries.length; i++ ) {
+    long_queries = long_queries + queries[i].start_lat + "," + queries[i].start_lon + "," + queries[i].end_lat + "," + queries[i].end_lon + "," + queries[i].delta + "!";
   }
 
-}
+  let results = sharedLib.batchPathFind( long_files, "parser/gpx.xsd", long_queries, 4 );
 
-for ( let i = 0; i < JSON_files_names.length; i++ ) {
+  res.send(
+    {
+      variable12: JSON.parse( results )
+    }
+  );
 
-  full_doc_info = full_doc_info + JSON_files_names[i] + "!";
-  full_doc_info = full_doc_info + sharedLib.getAllInfoOfGPX( "uploads/" + JSON_files_names[i], "parser/gpx.xsd" );
+});
 
-}
+app.get('/corridor_tracks', function(req , res){
 
-for ( let i = 0; i < JSON_files_names.length; i++ ) {
+  let filenames = fs.readdirSync("uploads");
+  let long_files = "";
 
-  full_doc_info_table = full_doc_info_table + sharedLib.getAllInfoOfGPXName( "uploads/" + JSON_files_names[i], "parser/gpx.xsd" );
+  for ( let i = 0; i < filenames.length; i++ ) {
+    if ( filenames[i].endsWith(".gpx") ) {
+      long_files = long_files + "uploads/" + filenames[i] + "!";
+    }
+  }
 
-}
+  let corridor = JSON.parse( req.query.corridor );
+  let long_corridor = "";
 
-let my_array2 = [];
+  for ( let i = 0; i < corridor.length; i++ ) {
+    long_corridor = long_corridor + corridor[i][0] + "," + corridor[i][1] + "!";
+  }
 
-for ( let i = 0; i < full_doc_info_table.length; i++ ) {
+  let results = sharedLib.getCorridorComponents( long_files, "parser/gpx.xsd", long_corridor, parseFloat(req.query.distance) );
 
-  my_array2 = full_doc_info_table.split("!");
+  res.send(
+    {
+      variable12: JSON.parse( results )
+    }
+  );
 
-}
+});
 
-let my_array = [];
+app.get('/track_intersections', function(req , res){
 
-for ( let i = 0; i < full_doc_info.length; i++ ) {
+  let filenames = fs.readdirSync("uploads");
+  let long_files = "";
 
-  my_array = full_doc_info.split("!");
+  for ( let i = 0; i < filenames.length; i++ ) {
+    if ( filenames[i].endsWith(".gpx") ) {
+      long_files = long_files + "uploads/" + filenames[i] + "!";
+    }
+  }
 
-}
+  let results = sharedLib.getTrackIntersections( long_files, "parser/gpx.xsd" );
 
-  let final_string = "{\"version\":1.1,\"creator\":\"Carson Mifsud\"}";
+  res.send(
+    {
+      variable12: JSON.parse( results )
+    }
+  );
 
-  if ( req.query.current != "FALSE" ) {
-    let checker = sharedLib.JSONtoGPX_create ( final_string, req.query.current, "parser/gpx.xsd" );
+});
+
+app.get('/track_positions', function(req , res){
+
+  let values = JSON.parse( req.query.values );
+  let long_values = "";
+
+  for ( let i = 0; i < values.length; i++ ) {
+    long_values = long_values + values[i] + "!";
   }
 
+  let positions = sharedLib.getTrackPositions( "uploads/"+req.query.fileName, "parser/gpx.xsd", req.query.componentName, req.query.mode, long_values );
+
   res.send(
     {
-      variable14: my_array
+      variable12: positions
+    }
+  );
+
+});
+
+app.get('/track_profile', function(req , res){
+
+  let profile = sharedLib.getTrackProfile( "uploads/"+req.query.fileName, "parser/gpx.xsd", req.query.componentName, req.query.kind, parseInt(req.query.numPoints) );
+
+  res.send(
+    {
+      variable12: profile
+    }
+  );
+
+});
+
+app.get('/length_range', function(req , res){
+
+  let filenames = fs.readdirSync("uploads");
+  let long_files = "";
+
+  for ( let i = 0; i < filenames.length; i++ ) {
+    if ( filenames[i].endsWith(".gpx") ) {
+      long_files = long_files + "uploads/" + filenames[i] + "!";
+    }
+  }
+
+  let results = sharedLib.getComponentsWithLength( long_files, "parser/gpx.xsd", parseFloat(req.query.length), parseFloat(req.query.delta) );
+
+  res.send(
+    {
+      variable12: JSON.parse( results )
+    }
+  );
+
+});
+
+app.get('/corpus_stats', function(req , res){
+
+  let stats = sharedLib.getCorpusStats( "uploads/gpx.stats" );
+
+  if ( stats == null ) {
+    rebuildCorpusStats();
+    stats = sharedLib.getCorpusStats( "uploads/gpx.stats" );
+  }
+
+  res.send(
+    {
+      variable12: JSON.parse( stats )
     }
   );
 
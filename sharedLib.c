@@ -1,10 +1,53 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "GPXParser.h"
 #include "LinkedListAPI.h"
 #include "GPXParserHelpers.h"
 
+/* Distance formula used by every length, loop and endpoint test; chordDistance unless a query picks another */
+DistanceKernel distance_kernel = &chordDistance;
+
+/* Unit vectors of route and track ends, keyed by the Route or Track, attached as documents are read and dropped as components are freed */
+EndVectorTable end_vectors = { NULL, 0, 0, PTHREAD_MUTEX_INITIALIZER };
+
+/* Length-sorted routes and tracks of documents read by createGPXdoc and createValidGPXdoc */
+LengthIndexTable length_indexes = { NULL, 0, 0, PTHREAD_MUTEX_INITIALIZER };
+
+/* Route and track lengths of the last file set searched by length */
+CorpusLengthCache corpus_lengths = { NULL, NULL, NULL, 0, PTHREAD_MUTEX_INITIALIZER };
+
+/* Element names shared by every interned otherData entry in the process */
+GPXSymbolTable symbol_table = { NULL, 0, 0, NULL, 0, PTHREAD_MUTEX_INITIALIZER };
+
+/* Slabs backing every list Node, plus each thread's private cache of free nodes */
+NodePool node_pool = { NULL, 0, 0, NULL, NULL, 0, PTHREAD_MUTEX_INITIALIZER };
+__thread NodeCache node_cache = { NULL, NULL, 0 };
+
+/* Hands a thread's cached nodes back to node_pool when the thread exits */
+pthread_key_t node_cache_key;
+pthread_once_t node_cache_once = PTHREAD_ONCE_INIT;
+
+/* Levels of detail of the last few files simplified, kept until the file changes */
+FileCache lod_cache = { { { NULL, NULL, NULL, NULL } }, 0, &buildLODIndex_function, &deleteLODIndex_function, PTHREAD_MUTEX_INITIALIZER };
+
+/* kd-trees of the last few files searched for nearest points */
+FileCache kd_cache = { { { NULL, NULL, NULL, NULL } }, 0, &buildKDIndex_function, &deleteKDIndex_function, PTHREAD_MUTEX_INITIALIZER };
+
+/* Routing graph of the last file set searched, kept until one of those files changes */
+RouteGraphCache route_graph_cache = { NULL, NULL, PTHREAD_MUTEX_INITIALIZER };
+
+/* Route and track ends of the last file set batch queried, under the same key as the routing graph */
+PathIndexCache path_index_cache = { NULL, NULL, PTHREAD_MUTEX_INITIALIZER };
+
+/* Segment and chunk boxes of the last file set queried by viewport or corridor */
+SpatialIndexCache spatial_index_cache = { NULL, NULL, PTHREAD_MUTEX_INITIALIZER };
+
 /** Function to initialize the list metadata head to the appropriate function pointers. Allocates memory to the struct.
 *@return pointer to the list head
 *@param printFunction function pointer to print a single node of the list
@@ -60,21 +103,195 @@ void clearList(List* list){
 	if (list->head == NULL && list->tail == NULL){
 		return;
 	}
+
+	//Packed lists own their nodes and data in the same block as the List struct
+	if (list->deleteData == &deletePackedData){
+		list->head = NULL;
+		list->tail = NULL;
+		list->length = 0;
+		return;
+	}
 	
-	Node* tmp;
+	Node* tmp = list->head;
 	
-	while (list->head != NULL){
-		list->deleteData(list->head->data);
-		tmp = list->head;
-		list->head = list->head->next;
-		free(tmp);
+	while (tmp != NULL){
+		list->deleteData(tmp->data);
+		tmp = tmp->next;
 	}
+
+	//Every node goes back to the pool in one step
+	releaseNodeChain(list->head, list->tail, list->length);
 	
 	list->head = NULL;
 	list->tail = NULL;
 	list->length = 0;
 }
 
+/** Takes a node from the calling thread's cache, refilling the cache from the shared pool
+ * (or a brand new slab) when it runs dry. Nodes are never handed back to malloc.
+ *@return pointer to an uninitialized node, NULL if a new slab could not be allocated
+ **/
+Node* allocateNode(void){
+	if (node_cache.head == NULL){
+		registerNodeCache();
+
+		pthread_mutex_lock(&(node_pool.lock));
+
+		if (node_pool.free_nodes != NULL){
+			//Take at most a slab's worth so one thread cannot hoard the pool while the others carve new slabs
+			Node* last = node_pool.free_nodes;
+			int taken = 1;
+
+			while (taken < NODE_SLAB_SIZE && last->next != NULL){
+				last = last->next;
+				taken++;
+			}
+
+			node_cache.head = node_pool.free_nodes;
+			node_cache.tail = last;
+			node_cache.length = taken;
+			node_pool.free_nodes = last->next;
+			node_pool.num_free -= taken;
+			last->next = NULL;
+
+			if (node_pool.free_nodes == NULL){
+				node_pool.free_tail = NULL;
+			}
+		}else{
+			Node* slab = malloc(sizeof(Node) * NODE_SLAB_SIZE);
+
+			if (slab == NULL){
+				pthread_mutex_unlock(&(node_pool.lock));
+				return NULL;
+			}
+
+			if (node_pool.num_slabs == node_pool.max_slabs){
+				int max_slabs = node_pool.max_slabs == 0 ? 16 : node_pool.max_slabs * 2;
+				Node** slabs = realloc(node_pool.slabs, sizeof(Node*) * max_slabs);
+
+				//The old slab table is still valid, so the pool is left as it was
+				if (slabs == NULL){
+					free(slab);
+					pthread_mutex_unlock(&(node_pool.lock));
+					return NULL;
+				}
+
+				node_pool.slabs = slabs;
+				node_pool.max_slabs = max_slabs;
+			}
+			node_pool.slabs[node_pool.num_slabs] = slab;
+			node_pool.num_slabs++;
+
+			for (int i = 0; i < NODE_SLAB_SIZE - 1; i++){
+				slab[i].next = &slab[i + 1];
+			}
+			slab[NODE_SLAB_SIZE - 1].next = NULL;
+
+			node_cache.head = &slab[0];
+			node_cache.tail = &slab[NODE_SLAB_SIZE - 1];
+			node_cache.length = NODE_SLAB_SIZE;
+		}
+
+		pthread_mutex_unlock(&(node_pool.lock));
+	}
+
+	Node* tmpNode = node_cache.head;
+	node_cache.head = tmpNode->next;
+	node_cache.length--;
+
+	if (node_cache.head == NULL){
+		node_cache.tail = NULL;
+	}
+
+	return tmpNode;
+}
+
+/** Returns a chain of nodes linked through next (head to tail) to the pool in O(1).
+ * The chain stays in the calling thread's cache until the cache grows past
+ * NODE_CACHE_LIMIT, then the whole cache is handed to the shared pool.
+ *@param head first node of the chain
+ *@param tail last node of the chain
+ *@param length number of nodes in the chain
+ **/
+void releaseNodeChain(Node* head, Node* tail, int length){
+	if (head == NULL || tail == NULL){
+		return;
+	}
+
+	tail->next = node_cache.head;
+	if (node_cache.head == NULL){
+		registerNodeCache();
+		node_cache.tail = tail;
+	}
+	node_cache.head = head;
+	node_cache.length += length;
+
+	if (node_cache.length > NODE_CACHE_LIMIT){
+		flushNodeCache(&node_cache);
+	}
+}
+
+/** Moves every node in a thread's cache to the shared pool in O(1).
+ *@param data the NodeCache to empty; it is also the destructor of node_cache_key, so it runs for every worker that exits
+ **/
+void flushNodeCache(void* data){
+	NodeCache* cache = (NodeCache*)data;
+
+	if (cache == NULL || cache->head == NULL){
+		return;
+	}
+
+	pthread_mutex_lock(&(node_pool.lock));
+
+	cache->tail->next = node_pool.free_nodes;
+	if (node_pool.free_nodes == NULL){
+		node_pool.free_tail = cache->tail;
+	}
+	node_pool.free_nodes = cache->head;
+	node_pool.num_free += cache->length;
+
+	pthread_mutex_unlock(&(node_pool.lock));
+
+	cache->head = NULL;
+	cache->tail = NULL;
+	cache->length = 0;
+}
+
+void createNodeCacheKey(void){
+	pthread_key_create(&node_cache_key, &flushNodeCache);
+}
+
+/** Makes sure the calling thread's cache is flushed when it exits. Called whenever the cache goes from empty to filled,
+ * which is rare enough that the extra pthread_setspecific does not show up.
+ **/
+void registerNodeCache(void){
+	pthread_once(&node_cache_once, &createNodeCacheKey);
+	pthread_setspecific(node_cache_key, &node_cache);
+}
+
+/** Returns a single node to the pool.
+ *@param node the node to release, it must have come from allocateNode
+ **/
+void releaseNode(Node* node){
+	if (node == NULL){
+		return;
+	}
+
+	node->next = NULL;
+	releaseNodeChain(node, node, 1);
+}
+
+/** Number of slabs the node pool has taken from malloc so far, for measuring the pool footprint
+ *@return slab count, each slab holds NODE_SLAB_SIZE nodes
+ **/
+int getNodePoolSlabs(void){
+	pthread_mutex_lock(&(node_pool.lock));
+	int num_slabs = node_pool.num_slabs;
+	pthread_mutex_unlock(&(node_pool.lock));
+
+	return num_slabs;
+}
+
 /**Function for creating a node for the linked list. 
 * This node contains abstracted (void *) data as well as previous and next
 * pointers to connect to other nodes in the list
@@ -85,7 +302,7 @@ void clearList(List* list){
 * @param data - is a void * pointer to any data type.  Data must be allocated on the heap.
 **/
 Node* initializeNode(void* data){
-	Node* tmpNode = (Node*)malloc(sizeof(Node));
+	Node* tmpNode = allocateNode();
 	
 	if (tmpNode == NULL){
 		return NULL;
@@ -98,6 +315,35 @@ Node* initializeNode(void* data){
 	return tmpNode;
 }
 
+/** Turns a packed otherData list back into an ordinary interned one in place, so nodes can be added or removed.
+ * Packed nodes live inside the list's own block and must never reach the node pool; the records are copied out
+ * and the block stays allocated as the List struct until freeList.
+ *@param list the list to unpack, any other list is left alone
+ **/
+void unpackList(List* list){
+	if (list == NULL || list->deleteData != &deletePackedData){
+		return;
+	}
+
+	Node* tmp = list->head;
+
+	list->head = NULL;
+	list->tail = NULL;
+	list->length = 0;
+	list->deleteData = &deleteSymbolData;
+
+	while (tmp != NULL){
+		GPXSymbolData* record = (GPXSymbolData*)tmp->data;
+		GPXSymbolData* copy = malloc(sizeof(GPXSymbolData) + strlen(record->value) + 1);
+
+		copy->symbol = record->symbol;
+		strcpy(copy->value, record->value);
+		insertBack(list, copy);
+
+		tmp = tmp->next;
+	}
+}
+
 /**Inserts a Node at the front of a linked list.  List metadata is updated
 * so that head and tail pointers are correct.
 *@pre 'List' type must exist and be used in order to keep track of the linked list.
@@ -108,6 +354,8 @@ void insertBack(List* list, void* toBeAdded){
 	if (list == NULL || toBeAdded == NULL){
 		return;
 	}
+
+	unpackList(list);
 	
 	(list->length)++;
 
@@ -133,6 +381,8 @@ void insertFront(List* list, void* toBeAdded){
 	if (list == NULL || toBeAdded == NULL){
 		return;
 	}
+
+	unpackList(list);
 	
 	(list->length)++;
 
@@ -178,6 +428,8 @@ void* deleteDataFromList(List* list, void* toBeDeleted){
 	if (list == NULL || toBeDeleted == NULL){
 		return NULL;
 	}
+
+	unpackList(list);
 	
 	Node* tmp = list->head;
 	
@@ -199,7 +451,7 @@ void* deleteDataFromList(List* list, void* toBeDeleted){
 			}
 			
 			void* data = delNode->data;
-			free(delNode);
+			releaseNode(delNode);
 			
 			(list->length)--;
 
@@ -228,6 +480,8 @@ void insertSorted(List *list, void *toBeAdded){
 		return;
 	}
 
+	unpackList(list);
+
 	if (list->head == NULL){
 		insertBack(list, toBeAdded);
 		return;
@@ -341,6 +595,36 @@ void* findElement(List * list, bool (*customCompare)(const void* first,const voi
 	return NULL;
 }
 
+/** Moves every node of the source list onto the back of the destination list without
+ * copying or reallocating them. The source list is left empty but is not freed.
+ *@pre Both lists exist and store the same kind of data
+ *@post destination length = old destination length + old source length, source length = 0
+ *@param destination pointer to the list receiving the nodes
+ *@param source pointer to the list whose nodes are moved
+ **/
+void spliceList(List* destination, List* source){
+	if (destination == NULL || source == NULL || source->head == NULL){
+		return;
+	}
+
+	unpackList(destination);
+	unpackList(source);
+
+	if (destination->head == NULL){
+		destination->head = source->head;
+	}else{
+		destination->tail->next = source->head;
+		source->head->previous = destination->tail;
+	}
+
+	destination->tail = source->tail;
+	destination->length += source->length;
+
+	source->head = NULL;
+	source->tail = NULL;
+	source->length = 0;
+}
+
 char *getOtherDataElement ( char* fileName, char* gpxSchemaFile, char* oldName ) {
 
 	if ( fileName == NULL || strcmp ( fileName, "" ) == 0 ) {
@@ -502,9 +786,9 @@ char *getOtherDataElement ( char* fileName, char* gpxSchemaFile, char* oldName )
 				while ( my_data != NULL ) {
 
 					strcat ( JSON_return, "{\"name\":\"" );
-					strcat ( JSON_return, my_data->name );
+					strcat ( JSON_return, gpxDataName ( my_route->otherData, my_data ) );
 					strcat ( JSON_return, "\",\"value\":\"" );
-					strcat ( JSON_return, my_data->value );
+					strcat ( JSON_return, gpxDataValue ( my_route->otherData, my_data ) );
 					strcat ( JSON_return, "\"}!" );
 
 					my_data = nextElement( &data_iterator );
@@ -539,9 +823,9 @@ char *getOtherDataElement ( char* fileName, char* gpxSchemaFile, char* oldName )
 				while ( my_data != NULL ) {
 
 					strcat ( JSON_return, "{\"name\":\"" );
-					strcat ( JSON_return, my_data->name );
+					strcat ( JSON_return, gpxDataName ( my_track->otherData, my_data ) );
 					strcat ( JSON_return, "\",\"value\":\"" );
-					strcat ( JSON_return, my_data->value );
+					strcat ( JSON_return, gpxDataValue ( my_track->otherData, my_data ) );
 					strcat ( JSON_return, "\"}!" );
 
 					my_data = nextElement( &data_iterator );
@@ -1132,7 +1416,7 @@ int getNumSegmentsWaypoints (const Track* doc) {
 
 }
 
-char* getTracksBetweenString(const GPXdoc* doc, float sourceLat, float sourceLong, float destLat, float destLong, float delta) {
+char* getTracksBetweenString ( const GPXdoc* doc, float sourceLat, float sourceLong, float destLat, float destLong, float delta, DistanceKernel kernel ) {
 
 	if ( doc == NULL ) {
 		return NULL;
@@ -1151,13 +1435,10 @@ char* getTracksBetweenString(const GPXdoc* doc, float sourceLat, float sourceLon
 	ListIterator track_iter = createIterator ( doc->tracks );
 	Track *my_track = nextElement ( &track_iter );
 
-	float source_dist = 0;
-	float dest_dist = 0;
-
-	float original_p1y = 0;
-	float original_p1x = 0;
-	float last_p2x = 0;
-	float last_p2y = 0;
+	double original_p1y = 0;
+	double original_p1x = 0;
+	double last_p2x = 0;
+	double last_p2y = 0;
 
 	while ( my_track != NULL ) {
 
@@ -1175,6 +1456,12 @@ char* getTracksBetweenString(const GPXdoc* doc, float sourceLat, float sourceLon
 				original_p1y = my_waypoint_route->longitude;
 				original_p1x = my_waypoint_route->latitude;
 			}
+
+			/* A segment of one point still ends the track there */
+			if ( my_waypoint_route != NULL ) {
+				last_p2y = my_waypoint_route->longitude;
+				last_p2x = my_waypoint_route->latitude;
+			}
 			
 			int the_length2 = my_segment->waypoints->length;
 
@@ -1195,27 +1482,7 @@ char* getTracksBetweenString(const GPXdoc* doc, float sourceLat, float sourceLon
 
 		}
 
-			float dx = 0;
-			float dy = 0;
-			float dz = 0;
-
-			original_p1y -= sourceLong;
-			original_p1y *= (3.1415926536 / 180), original_p1x *= (3.1415926536 / 180), sourceLat *= (3.1415926536 / 180);
-		
-			dz = sin(original_p1x) - sin(sourceLat);
-			dx = cos(original_p1y) * cos(original_p1x) - cos(sourceLat);
-			dy = sin(original_p1y) * cos(original_p1x);
-			source_dist = asin(sqrt(dx * dx + dy * dy + dz * dz) / 2) * 2 * 6371;
-
-			last_p2y -= destLong;
-			last_p2y *= (3.1415926536 / 180), last_p2x *= (3.1415926536 / 180), destLat *= (3.1415926536 / 180);
-		
-			dz = sin(last_p2x) - sin(destLat);
-			dx = cos(last_p2y) * cos(last_p2x) - cos(destLat);
-			dy = sin(last_p2y) * cos(last_p2x);
-			dest_dist = asin(sqrt(dx * dx + dy * dy + dz * dz) / 2) * 2 * 6371;
-
-			if ( (source_dist >= 0 && source_dist <= delta) || (dest_dist >= 0 && dest_dist <= delta) ) {
+			if ( withinDistanceKernel ( original_p1x, original_p1y, sourceLat, sourceLong, delta, kernel ) || withinDistanceKernel ( last_p2x, last_p2y, destLat, destLong, delta, kernel ) ) {
 				strcat ( return_string, "Track " );
 				strcat ( return_string, "!" );
 				strcat ( return_string, my_track->name );
@@ -1224,11 +1491,11 @@ char* getTracksBetweenString(const GPXdoc* doc, float sourceLat, float sourceLon
 				sprintf ( temp, "%d", num_tracks );
 				strcat ( return_string, temp );
 				strcat ( return_string, "!" );
-				float the_length = round10 ( getTrackLen ( my_track ) );
+				float the_length = round10 ( trackLenKernel ( my_track, kernel ) );
 				sprintf ( temp, "%.1f", the_length );
 				strcat ( return_string, temp );
 				strcat ( return_string, "!" );
-				if ( (isLoopTrack ( my_track, 10 )) == true ) {
+				if ( (isLoopTrackKernel ( my_track, 10, kernel )) == true ) {
 					strcat ( return_string, "true" );
 				} else {
 					strcat ( return_string, "false" );
@@ -1255,7 +1522,7 @@ char* getTracksBetweenString(const GPXdoc* doc, float sourceLat, float sourceLon
 
 }
 
-char* getRoutesBetweenString ( const GPXdoc* doc, float sourceLat, float sourceLong, float destLat, float destLong, float delta) {
+char* getRoutesBetweenString ( const GPXdoc* doc, float sourceLat, float sourceLong, float destLat, float destLong, float delta, DistanceKernel kernel ) {
 
 	if ( doc == NULL ) {
 		return NULL;
@@ -1272,9 +1539,7 @@ char* getRoutesBetweenString ( const GPXdoc* doc, float sourceLat, float sourceL
 	ListIterator route_iter = createIterator ( doc->routes );
 	Route *my_route = nextElement ( &route_iter );
 
-	float source_dist, dest_dist;
-
-	float original_p1y, original_p1x, last_p2x, last_p2y;
+	double original_p1y, original_p1x, last_p2x, last_p2y;
 
 	while ( my_route != NULL ) {
 
@@ -1297,27 +1562,7 @@ char* getRoutesBetweenString ( const GPXdoc* doc, float sourceLat, float sourceL
 			last_p2y = my_waypoint_route->longitude;
 			last_p2x = my_waypoint_route->latitude;
 
-			float dx = 0;
-			float dy = 0;
-			float dz = 0;
-
-			original_p1y -= sourceLong;
-			original_p1y *= (3.1415926536 / 180), original_p1x *= (3.1415926536 / 180), sourceLat *= (3.1415926536 / 180);
-		
-			dz = sin(original_p1x) - sin(sourceLat);
-			dx = cos(original_p1y) * cos(original_p1x) - cos(sourceLat);
-			dy = sin(original_p1y) * cos(original_p1x);
-			source_dist = asin(sqrt(dx * dx + dy * dy + dz * dz) / 2) * 2 * 6371;
-
-			last_p2y -= destLong;
-			last_p2y *= (3.1415926536 / 180), last_p2x *= (3.1415926536 / 180), destLat *= (3.1415926536 / 180);
-		
-			dz = sin(last_p2x) - sin(destLat);
-			dx = cos(last_p2y) * cos(last_p2x) - cos(destLat);
-			dy = sin(last_p2y) * cos(last_p2x);
-			dest_dist = asin(sqrt(dx * dx + dy * dy + dz * dz) / 2) * 2 * 6371;
-
-			if ( (source_dist >= 0 && source_dist <= delta) || (dest_dist >= 0 && dest_dist <= delta) ) {
+			if ( withinDistanceKernel ( original_p1x, original_p1y, sourceLat, sourceLong, delta, kernel ) || withinDistanceKernel ( last_p2x, last_p2y, destLat, destLong, delta, kernel ) ) {
 				strcat ( return_string, "Route " );
 				strcat ( return_string, "!" );
 				strcat ( return_string, my_route->name );
@@ -1326,11 +1571,11 @@ char* getRoutesBetweenString ( const GPXdoc* doc, float sourceLat, float sourceL
 				sprintf ( temp, "%d", temp_num );
 				strcat ( return_string, temp );
 				strcat ( return_string, "!" );
-				float the_length = round10 ( getRouteLen ( my_route ) );
+				float the_length = round10 ( routeLenKernel ( my_route, kernel ) );
 				sprintf ( temp, "%.1f", the_length );
 				strcat ( return_string, temp );
 				strcat ( return_string, "!" );
-				if ( (isLoopRoute ( my_route, 10 )) == true ) {
+				if ( (isLoopRouteKernel ( my_route, 10, kernel )) == true ) {
 					strcat ( return_string, "true" );
 				} else {
 					strcat ( return_string, "false" );
@@ -1361,6 +1606,19 @@ char* getRoutesBetweenString ( const GPXdoc* doc, float sourceLat, float sourceL
 
 char *pathFindReturn ( char* fileName, char* gpxSchemaFile, float start_lat, float start_lon, float end_lat, float end_lon, float delta ) {
 
+	return pathFindKernel ( fileName, gpxSchemaFile, start_lat, start_lon, end_lat, end_lon, delta, NULL );
+
+}
+
+/* pathFindReturn measured with the named kernel; NULL or an unknown name uses the process default */
+char *pathFindKernel ( char* fileName, char* gpxSchemaFile, float start_lat, float start_lon, float end_lat, float end_lon, float delta, char* kernelName ) {
+
+	DistanceKernel kernel = distanceKernelNamed ( kernelName );
+
+	if ( kernel == NULL ) {
+		kernel = distance_kernel;
+	}
+
 	if ( fileName == NULL || strcmp ( fileName, "" ) == 0 ) {
         fprintf ( stderr, "File name cannot be an empty string or NULL.\n" );
         // Check for return error?
@@ -1496,8 +1754,8 @@ char *pathFindReturn ( char* fileName, char* gpxSchemaFile, float start_lat, flo
 	char *getBetween = malloc ( sizeof ( doc ) * sizeof ( char * ) * my_doc->routes->length * my_doc->tracks->length + 100 );
 	strcpy ( getBetween, "" );
 
-	strcat ( getBetween, getRoutesBetweenString( my_doc, start_lat, start_lon, end_lat, end_lon, delta));
-	strcat ( getBetween, getTracksBetweenString( my_doc, start_lat, start_lon, end_lat, end_lon, delta));
+	strcat ( getBetween, getRoutesBetweenString( my_doc, start_lat, start_lon, end_lat, end_lon, delta, kernel ));
+	strcat ( getBetween, getTracksBetweenString( my_doc, start_lat, start_lon, end_lat, end_lon, delta, kernel ));
 
 	deleteGPXdoc ( my_doc );
 
@@ -2085,6 +2343,9 @@ Waypoint *waypoint_function ( xmlNode *cur_node ) {
 
 	Waypoint *my_waypoint = ( Waypoint *) malloc ( sizeof ( Waypoint ) );
 
+	my_waypoint->name = NULL;
+	my_waypoint->otherData = initializeList ( &gpxDataToString, &deleteGpxData, &compareGpxData );
+
 	xmlNode *temp_node = cur_node;
 
 	for (cur_node = cur_node->children; cur_node != NULL; cur_node = cur_node->next) {
@@ -2092,8 +2353,7 @@ Waypoint *waypoint_function ( xmlNode *cur_node ) {
 		if (cur_node->type == XML_ELEMENT_NODE) {
 
 			/* Retrieval of xmlNodeGetContent was retrieved from http://xmlsoft.org/ */
-			if ( strcmp ( "name", (char *)(cur_node->name) ) == 0 ) {
-				my_waypoint->otherData = initializeList ( &gpxDataToString, &deleteGpxData, &compareGpxData );
+			if ( strcmp ( "name", (char *)(cur_node->name) ) == 0 && my_waypoint->name == NULL ) {
 				char *temp_name2 = (char *) xmlNodeGetContent ( cur_node );
 				int len = strlen ( temp_name2 );
 				my_waypoint->name = (char *) ( malloc ( ( len ) + 1 ) );
@@ -2101,27 +2361,23 @@ Waypoint *waypoint_function ( xmlNode *cur_node ) {
 				free ( temp_name2 );
 			}
 			else {
-
-				my_waypoint->name = (char *) ( malloc ( sizeof ( char * ) + 1 ) );
-				my_waypoint->name[0] = '\0';
-
-				my_waypoint->otherData = initializeList ( &gpxDataToString, &deleteGpxData, &compareGpxData );
-
 				char *temp_name = (char *) xmlNodeGetContent ( cur_node );
-				GPXData *my_data = malloc ( sizeof ( GPXData ) + strlen(temp_name) * sizeof ( char *) + 1 );
+				GPXData *my_data = malloc ( sizeof ( GPXData ) + strlen(temp_name) + 1 );
 				strcpy ( my_data->name, (char*)cur_node->name );
 				strcpy ( my_data->value, temp_name );
 				insertBack ( my_waypoint->otherData, (void *)(my_data) );
 				free ( temp_name );
 			}
-			if ( my_waypoint->name == NULL ) {
-				my_waypoint->name[0] = '\0';
-			}
 
 		}
 
 	}
 
+	if ( my_waypoint->name == NULL ) {
+		my_waypoint->name = (char *) ( malloc ( 1 ) );
+		my_waypoint->name[0] = '\0';
+	}
+
 	cur_node = temp_node;
 
 	xmlAttr *attr = NULL;
@@ -2205,7 +2461,7 @@ Route *route_function ( xmlNode *cur_node ) {
 						temp_node7 = temp_node7->children;
 						temp_node7 = temp_node7->next;
 						char *temp_name = (char *) xmlNodeGetContent ( temp_node7 );
-						GPXData *my_data = malloc ( sizeof ( GPXData ) + strlen(temp_name) * sizeof ( char *) + 1 );
+						GPXData *my_data = malloc ( sizeof ( GPXData ) + strlen(temp_name) + 1 );
 						strcpy ( my_data->name, (char*)temp_node7->name );
 						strcpy ( my_data->value, temp_name );
 						insertBack ( my_waypoint->otherData, (void *)(my_data) );
@@ -2241,7 +2497,7 @@ Route *route_function ( xmlNode *cur_node ) {
 			else {
 
 				if ( my_route->name == NULL || strcmp ( my_route->name, "" ) == 0 ) {
-					my_route->name = (char *) ( malloc ( sizeof ( char * ) + 1 ) );
+					my_route->name = (char *) ( malloc ( 1 ) );
 					my_route->name[0] = '\0';
 
 					my_route->otherData = initializeList ( &gpxDataToString, &deleteGpxData, &compareGpxData );
@@ -2250,7 +2506,7 @@ Route *route_function ( xmlNode *cur_node ) {
 				}
 
 				char *temp_name = (char *) xmlNodeGetContent ( cur_node );
-				GPXData *my_data = malloc ( sizeof ( GPXData ) + strlen(temp_name) * sizeof ( char *) + 1 );
+				GPXData *my_data = malloc ( sizeof ( GPXData ) + strlen(temp_name) + 1 );
 				strcpy ( my_data->name, (char*)cur_node->name );
 				strcpy ( my_data->value, temp_name );
 				insertBack ( my_route->otherData, (void *)(my_data) );
@@ -2262,7 +2518,7 @@ Route *route_function ( xmlNode *cur_node ) {
 	}
 
 	if ( check == false ) {
-		my_route->name = (char *) ( malloc ( sizeof ( char * ) + 1 ) );
+		my_route->name = (char *) ( malloc ( 1 ) );
 		my_route->name[0] = '\0';
 	}
 
@@ -2283,6 +2539,8 @@ Track *track_function ( xmlNode *cur_node ) {
 
 	bool check = false;
 
+	my_track->name = NULL;
+
 	my_track->segments = initializeList ( &trackSegmentToString, &deleteTrackSegment, &compareTrackSegments );
 
 	my_track->otherData = initializeList ( &gpxDataToString, &deleteGpxData, &compareGpxData );
@@ -2302,94 +2560,96 @@ Track *track_function ( xmlNode *cur_node ) {
 			}
 			else if ( strcmp ( "trkseg", (char *)(cur_node->name) ) == 0 ) {
 
-				xmlNode *temp_node9 = cur_node->children;
 				xmlNode *temp_node8;
 
-				if ( temp_node9->next != NULL ) {
+				my_trackSegment = NULL;
+
+				/* Visit every child instead of stepping over the whitespace between trkpts, which a packed or truncated file may not have */
+				for (temp_node8 = cur_node->children; temp_node8 != NULL; temp_node8 = temp_node8->next) {
 
-					my_trackSegment = ( TrackSegment *) malloc ( sizeof ( TrackSegment ) );
-					my_trackSegment->waypoints = initializeList ( &waypointToString, &deleteWaypoint, &compareWaypoints );
+					if ( temp_node8->type != XML_ELEMENT_NODE || strcmp ( "trkpt", (char *)(temp_node8->name) ) != 0 ) {
+						continue;
+					}
+
+					if ( my_trackSegment == NULL ) {
+						my_trackSegment = ( TrackSegment *) malloc ( sizeof ( TrackSegment ) );
+						my_trackSegment->waypoints = initializeList ( &waypointToString, &deleteWaypoint, &compareWaypoints );
+					}
+
+					xmlNode *temp_node5 = temp_node8;
 
-					temp_node9 = temp_node9->next;
+					int name_check = 0;
+					int otherData_check = 0;
 
-					if ( strcmp ( "trkpt", (char *)(temp_node9->name) ) == 0 ) {
+					for (temp_node5 = temp_node5->children; temp_node5 != NULL; temp_node5 = temp_node5->next) {
+						if ( strcmp ( (char *)temp_node5->name, "name" ) == 0 ) {
+							name_check++;
+						} else if (!( strcmp ( (char *)temp_node5->name, "text" ) == 0 )) {
+							otherData_check++;
+						}
+					}
 
-						for (temp_node8 = temp_node9; temp_node8 != NULL; temp_node8 = temp_node8->next) {
+					if ( name_check == 0 ) {
 
-							xmlNode *temp_node5 = temp_node8;
+						my_waypoint = ( Waypoint *) malloc ( sizeof ( Waypoint ) );
 
-							int name_check = 0;
-							int otherData_check = 0;
+						my_waypoint->otherData = initializeList ( &gpxDataToString, &deleteGpxData, &compareGpxData );
 
-							for (temp_node5 = temp_node5->children; temp_node5 != NULL; temp_node5 = temp_node5->next) {
-								if ( strcmp ( (char *)temp_node5->name, "name" ) == 0 ) {
-									name_check++;
-								} else if (!( strcmp ( (char *)temp_node5->name, "text" ) == 0 )) {
-									otherData_check++;
-								}
-							}
+						int len = sizeof ( char );
+						my_waypoint->name = (char *) ( malloc ( ( len ) + 1 ) );
+						my_waypoint->name[0] = '\0';
 
-							if ( name_check == 0 ) {
-
-								my_waypoint = ( Waypoint *) malloc ( sizeof ( Waypoint ) );
-
-								my_waypoint->otherData = initializeList ( &gpxDataToString, &deleteGpxData, &compareGpxData );
-
-								int len = sizeof ( char );
-								my_waypoint->name = (char *) ( malloc ( ( len ) + 1 ) );
-								my_waypoint->name[0] = '\0';
-
-								if ( otherData_check != 0 ) {
-									xmlNode *temp_node7 = temp_node8;
-									temp_node7 = temp_node7->children;
-									temp_node7 = temp_node7->next;
-									char *temp_name = (char *) xmlNodeGetContent ( temp_node7 );
-									GPXData *my_data = malloc ( sizeof ( GPXData ) + strlen(temp_name) * sizeof ( char *) + 1 );
-									strcpy ( my_data->name, (char*)temp_node7->name );
-									strcpy ( my_data->value, temp_name );
-									insertBack ( my_waypoint->otherData, (void *)(my_data) );
-									free ( temp_name );
-								}
-
-								xmlAttr *attr = NULL;
-								for (attr = temp_node8->properties; attr != NULL; attr = attr->next)
-								{
-									xmlNode *value = attr->children;
-									char *attrName = (char *)attr->name;
-									char *cont = (char *)(value->content);
-
-									if ( strcmp ( "lat", attrName ) == 0 ) {
-										double parsed_lat = strtod ( cont, NULL );
-										my_waypoint->latitude = parsed_lat;
-									}
-									else if ( strcmp ( "lon", attrName ) == 0 ) {
-										double parsed_lon = strtod ( cont, NULL );
-										my_waypoint->longitude = parsed_lon;
-									}
-
-								}
-
-								insertBack ( my_trackSegment->waypoints, (void *)(my_waypoint) );
-							}
-							else {
-								insertBack ( my_trackSegment->waypoints, (void *)waypoint_function ( temp_node8 ) );
+						/* Keep every child, not just the first, so <time> after <ele> survives */
+						for ( xmlNode *temp_node7 = temp_node8->children; otherData_check != 0 && temp_node7 != NULL; temp_node7 = temp_node7->next ) {
+
+							if ( temp_node7->type != XML_ELEMENT_NODE ) {
+								continue;
 							}
 
-							temp_node8 = temp_node8->next;
+							char *temp_name = (char *) xmlNodeGetContent ( temp_node7 );
+							GPXData *my_data = malloc ( sizeof ( GPXData ) + strlen(temp_name) + 1 );
+							strcpy ( my_data->name, (char*)temp_node7->name );
+							strcpy ( my_data->value, temp_name );
+							insertBack ( my_waypoint->otherData, (void *)(my_data) );
+							free ( temp_name );
 
 						}
 
-						insertBack ( my_track->segments, (void *) (my_trackSegment) );
+						xmlAttr *attr = NULL;
+						for (attr = temp_node8->properties; attr != NULL; attr = attr->next)
+						{
+							xmlNode *value = attr->children;
+							char *attrName = (char *)attr->name;
+							char *cont = (char *)(value->content);
+
+							if ( strcmp ( "lat", attrName ) == 0 ) {
+								double parsed_lat = strtod ( cont, NULL );
+								my_waypoint->latitude = parsed_lat;
+							}
+							else if ( strcmp ( "lon", attrName ) == 0 ) {
+								double parsed_lon = strtod ( cont, NULL );
+								my_waypoint->longitude = parsed_lon;
+							}
+
+						}
 
+						insertBack ( my_trackSegment->waypoints, (void *)(my_waypoint) );
 					}
+					else {
+						insertBack ( my_trackSegment->waypoints, (void *)waypoint_function ( temp_node8 ) );
+					}
+
+				}
 
+				if ( my_trackSegment != NULL ) {
+					insertBack ( my_track->segments, (void *) (my_trackSegment) );
 				}
 
 			}
 			else {
 
 				if ( my_track->name == NULL || strcmp ( my_track->name, "" ) == 0 ) {
-					my_track->name = (char *) ( malloc ( sizeof ( char * ) + 1 ) );
+					my_track->name = (char *) ( malloc ( 1 ) );
 					my_track->name[0] = '\0';
 
 					my_track->otherData = initializeList ( &gpxDataToString, &deleteGpxData, &compareGpxData );
@@ -2398,7 +2658,7 @@ Track *track_function ( xmlNode *cur_node ) {
 				}
 
 				char *temp_name = (char *) xmlNodeGetContent ( cur_node );
-				GPXData *my_data = malloc ( sizeof ( GPXData ) + strlen(temp_name) * sizeof ( char *) + 1 );
+				GPXData *my_data = malloc ( sizeof ( GPXData ) + strlen(temp_name) + 1 );
 				strcpy ( my_data->name, (char*)cur_node->name );
 				strcpy ( my_data->value, temp_name );
 				insertBack ( my_track->otherData, (void *)(my_data) );
@@ -2410,7 +2670,7 @@ Track *track_function ( xmlNode *cur_node ) {
 	}
 
 	if ( check == false ) {
-		my_track->name = (char *) ( malloc ( sizeof ( char * ) + 1 ) );
+		my_track->name = (char *) ( malloc ( 1 ) );
 		my_track->name[0] = '\0';
 	}
 
@@ -2449,6 +2709,10 @@ void deleteRoute(void* data) {
 
 	tmpName = (Route*)data;
 
+	/* A later allocation at this address must not find these vectors or length entries */
+	dropEndVectors ( tmpName );
+	dropLengthIndexOf ( tmpName );
+
 	free ( tmpName->name );
 	freeList ( tmpName->waypoints );
 	freeList ( tmpName->otherData );
@@ -2465,6 +2729,9 @@ void deleteTrack(void* data) {
 	
 	tmpName = (Track*)data;
 
+	dropEndVectors ( tmpName );
+	dropLengthIndexOf ( tmpName );
+
 	free ( tmpName->name );
 	freeList ( tmpName->segments );
 	freeList ( tmpName->otherData );
@@ -2682,6 +2949,18 @@ int numTracksWithLength(const GPXdoc* doc, float len, float delta) {
 		return 0;
 	}
 
+	/* The first query builds the index, later ones reuse it until the document changes */
+	int indexed = lengthIndexCount_function ( doc, false, len, delta );
+
+	if ( indexed == -1 ) {
+		attachLengthIndex ( doc );
+		indexed = lengthIndexCount_function ( doc, false, len, delta );
+	}
+
+	if ( indexed != -1 ) {
+		return indexed;
+	}
+
 	int total_matches = 0;
 	float return_compare = 0;
 
@@ -2714,6 +2993,18 @@ int numRoutesWithLength ( const GPXdoc* doc, float len, float delta ) {
 		return 0;
 	}
 
+	/* The first query builds the index, later ones reuse it until the document changes */
+	int indexed = lengthIndexCount_function ( doc, true, len, delta );
+
+	if ( indexed == -1 ) {
+		attachLengthIndex ( doc );
+		indexed = lengthIndexCount_function ( doc, true, len, delta );
+	}
+
+	if ( indexed != -1 ) {
+		return indexed;
+	}
+
 	int total_matches = 0;
 	float return_compare = 0;
 
@@ -2736,7 +3027,7 @@ int numRoutesWithLength ( const GPXdoc* doc, float len, float delta ) {
 
 }
 
-float getTrackLen ( const Track *tr ) {
+float trackLenKernel ( const Track *tr, DistanceKernel kernel ) {
 
 	if ( tr == NULL ) {
 		return 0;
@@ -2746,7 +3037,7 @@ float getTrackLen ( const Track *tr ) {
 
 	int the_length1 = tr->segments->length;
 
-	float original_p1y, original_p1x, last_p2x, last_p2y;
+	double original_p1y, original_p1x, last_p2x, last_p2y;
 
 	if ( tr != NULL ) {
 
@@ -2763,7 +3054,7 @@ float getTrackLen ( const Track *tr ) {
 			for ( int i = 1; i < the_length2; i++ ) {
 
 
-				float p1x, p1y, p2x, p2y;
+				double p1x, p1y, p2x, p2y;
 
 				p1y = my_waypoint_route->longitude;
 				p1x = my_waypoint_route->latitude;
@@ -2773,15 +3064,7 @@ float getTrackLen ( const Track *tr ) {
 				p2y = my_waypoint_route->longitude;
 				p2x = my_waypoint_route->latitude;
 
-				float dx, dy, dz;
-				
-				p1y -= p2y;
-				p1y *= (3.1415926536 / 180), p1x *= (3.1415926536 / 180), p2x *= (3.1415926536 / 180);
-			
-				dz = sin(p1x) - sin(p2x);
-				dx = cos(p1y) * cos(p1x) - cos(p2x);
-				dy = sin(p1y) * cos(p1x);
-				total_dist = total_dist + asin(sqrt(dx * dx + dy * dy + dz * dz) / 2) * 2 * 6371;
+				total_dist = total_dist + kernel ( p1x, p1y, p2x, p2y );
 
 			}
 
@@ -2798,15 +3081,7 @@ float getTrackLen ( const Track *tr ) {
 
 				my_waypoint_route1 = nextElement( &data_waypoint_route );
 
-				float dx, dy, dz;
-				
-				original_p1y -= last_p2y;
-				original_p1y *= (3.1415926536 / 180), original_p1x *= (3.1415926536 / 180), last_p2x *= (3.1415926536 / 180);
-			
-				dz = sin(original_p1x) - sin(last_p2x);
-				dx = cos(original_p1y) * cos(original_p1x) - cos(last_p2x);
-				dy = sin(original_p1y) * cos(original_p1x);
-				total_dist = total_dist + asin(sqrt(dx * dx + dy * dy + dz * dz) / 2) * 2 * 6371;
+				total_dist = total_dist + kernel ( original_p1x, original_p1y, last_p2x, last_p2y );
 
 			}
 
@@ -2820,7 +3095,13 @@ float getTrackLen ( const Track *tr ) {
 
 }
 
-bool isLoopTrack(const Track *tr, float delta) {
+float getTrackLen ( const Track *tr ) {
+
+	return trackLenKernel ( tr, distance_kernel );
+
+}
+
+bool isLoopTrackKernel ( const Track *tr, float delta, DistanceKernel kernel ) {
 
 	if ( tr == NULL ) {
 		return false;
@@ -2830,16 +3111,23 @@ bool isLoopTrack(const Track *tr, float delta) {
 		return false;
 	}
 
+	double first_vector[3];
+	double last_vector[3];
+
+	if ( endVectorsActive_function ( kernel ) && endVectors_function ( tr, first_vector, last_vector ) ) {
+		return chordSquared_function ( first_vector, last_vector ) <= chordLimit_function ( delta / 1000 );
+	}
+
 	float total_dist = 0;
 
 	int the_length1 = tr->segments->length;
 
-	float original_p1y = 0;
-	float original_p1x = 0;
-	float last_p2x = 0;
-	float last_p2y = 0;
-	float p2x = 0;
-	float p2y = 0;
+	double original_p1y = 0;
+	double original_p1x = 0;
+	double last_p2x = 0;
+	double last_p2y = 0;
+	double p2x = 0;
+	double p2y = 0;
 
 	if ( tr != NULL ) {
 
@@ -2855,6 +3143,12 @@ bool isLoopTrack(const Track *tr, float delta) {
 				original_p1x = my_waypoint_route->latitude;
 			}
 
+			/* A segment of one point still ends the track there */
+			if ( my_waypoint_route != NULL ) {
+				p2y = my_waypoint_route->longitude;
+				p2x = my_waypoint_route->latitude;
+			}
+
 			int the_length2 = my_segment->waypoints->length;
 
 			for ( int i = 1; i < the_length2; i++ ) {
@@ -2880,17 +3174,7 @@ bool isLoopTrack(const Track *tr, float delta) {
 			last_p2y = p2y;
 			last_p2x = p2x;
 
-			float dx = 0;
-			float dy = 0;
-			float dz = 0;
-
-			original_p1y -= last_p2y;
-			original_p1y *= (3.1415926536 / 180), original_p1x *= (3.1415926536 / 180), last_p2x *= (3.1415926536 / 180);
-		
-			dz = sin(original_p1x) - sin(last_p2x);
-			dx = cos(original_p1y) * cos(original_p1x) - cos(last_p2x);
-			dy = sin(original_p1y) * cos(original_p1x);
-			total_dist = total_dist + asin(sqrt(dx * dx + dy * dy + dz * dz) / 2) * 2 * 6371;
+			total_dist = total_dist + kernel ( original_p1x, original_p1y, last_p2x, last_p2y );
 
 	}
 
@@ -2904,6 +3188,12 @@ bool isLoopTrack(const Track *tr, float delta) {
 
 }
 
+bool isLoopTrack(const Track *tr, float delta) {
+
+	return isLoopTrackKernel ( tr, delta, distance_kernel );
+
+}
+
 List* getTracksBetween(const GPXdoc* doc, float sourceLat, float sourceLong, float destLat, float destLong, float delta) {
 
 	if ( doc == NULL ) {
@@ -2915,19 +3205,39 @@ List* getTracksBetween(const GPXdoc* doc, float sourceLat, float sourceLong, flo
 
 	bool atleastOne = false;
 
+	/* With the chord kernel, cached end vectors replace the per-track sin and cos */
+	bool use_vectors = endVectorsActive_function ( distance_kernel );
+	double chord_limit = chordLimit_function ( delta );
+	double source_vector[3];
+	double dest_vector[3];
+	double first_vector[3];
+	double last_vector[3];
+
+	unitVector_function ( sourceLat, sourceLong, source_vector );
+	unitVector_function ( destLat, destLong, dest_vector );
+
 	ListIterator track_iter = createIterator ( doc->tracks );
 	Track *my_track = nextElement ( &track_iter );
 
-	float source_dist = 0;
-	float dest_dist = 0;
-
-	float original_p1y = 0;
-	float original_p1x = 0;
-	float last_p2x = 0;
-	float last_p2y = 0;
+	double original_p1y = 0;
+	double original_p1x = 0;
+	double last_p2x = 0;
+	double last_p2y = 0;
 
 	while ( my_track != NULL ) {
 
+		if ( use_vectors && endVectors_function ( my_track, first_vector, last_vector ) ) {
+
+			if ( chordSquared_function ( first_vector, source_vector ) <= chord_limit || chordSquared_function ( last_vector, dest_vector ) <= chord_limit ) {
+				insertBack ( betweenTracks, (void *)my_track );
+				atleastOne = true;
+			}
+
+			my_track = nextElement ( &track_iter );
+			continue;
+
+		}
+
 		ListIterator segment_move = createIterator ( my_track->segments );
 		TrackSegment *my_segment = nextElement ( &segment_move );
 
@@ -2942,6 +3252,12 @@ List* getTracksBetween(const GPXdoc* doc, float sourceLat, float sourceLong, flo
 				original_p1y = my_waypoint_route->longitude;
 				original_p1x = my_waypoint_route->latitude;
 			}
+
+			/* A segment of one point still ends the track there */
+			if ( my_waypoint_route != NULL ) {
+				last_p2y = my_waypoint_route->longitude;
+				last_p2x = my_waypoint_route->latitude;
+			}
 			
 			int the_length2 = my_segment->waypoints->length;
 
@@ -2962,27 +3278,7 @@ List* getTracksBetween(const GPXdoc* doc, float sourceLat, float sourceLong, flo
 
 		}
 
-			float dx = 0;
-			float dy = 0;
-			float dz = 0;
-
-			original_p1y -= sourceLong;
-			original_p1y *= (3.1415926536 / 180), original_p1x *= (3.1415926536 / 180), sourceLat *= (3.1415926536 / 180);
-		
-			dz = sin(original_p1x) - sin(sourceLat);
-			dx = cos(original_p1y) * cos(original_p1x) - cos(sourceLat);
-			dy = sin(original_p1y) * cos(original_p1x);
-			source_dist = asin(sqrt(dx * dx + dy * dy + dz * dz) / 2) * 2 * 6371;
-
-			last_p2y -= destLong;
-			last_p2y *= (3.1415926536 / 180), last_p2x *= (3.1415926536 / 180), destLat *= (3.1415926536 / 180);
-		
-			dz = sin(last_p2x) - sin(destLat);
-			dx = cos(last_p2y) * cos(last_p2x) - cos(destLat);
-			dy = sin(last_p2y) * cos(last_p2x);
-			dest_dist = asin(sqrt(dx * dx + dy * dy + dz * dz) / 2) * 2 * 6371;
-
-			if ( (source_dist >= 0 && source_dist <= delta) || (dest_dist >= 0 && dest_dist <= delta) ) {
+			if ( withinDistance ( original_p1x, original_p1y, sourceLat, sourceLong, delta ) || withinDistance ( last_p2x, last_p2y, destLat, destLong, delta ) ) {
 				insertBack ( betweenTracks, (void *)my_track );
 				atleastOne = true;
 			}
@@ -3016,12 +3312,33 @@ List* getRoutesBetween ( const GPXdoc* doc, float sourceLat, float sourceLong, f
 	ListIterator route_iter = createIterator ( doc->routes );
 	Route *my_route = nextElement ( &route_iter );
 
-	float source_dist, dest_dist;
+	double original_p1y, original_p1x, last_p2x, last_p2y;
 
-	float original_p1y, original_p1x, last_p2x, last_p2y;
+	/* With the chord kernel, cached end vectors replace the per-route sin and cos */
+	bool use_vectors = endVectorsActive_function ( distance_kernel );
+	double chord_limit = chordLimit_function ( delta );
+	double source_vector[3];
+	double dest_vector[3];
+	double first_vector[3];
+	double last_vector[3];
+
+	unitVector_function ( sourceLat, sourceLong, source_vector );
+	unitVector_function ( destLat, destLong, dest_vector );
 
 	while ( my_route != NULL ) {
 
+		if ( use_vectors && endVectors_function ( my_route, first_vector, last_vector ) ) {
+
+			if ( chordSquared_function ( first_vector, source_vector ) <= chord_limit || chordSquared_function ( last_vector, dest_vector ) <= chord_limit ) {
+				insertBack ( betweenRoutes, (void *)my_route );
+				atleastOne = true;
+			}
+
+			my_route = nextElement ( &route_iter );
+			continue;
+
+		}
+
 		ListIterator data_waypoint_route = createIterator ( my_route->waypoints );
 		Waypoint *my_waypoint_route = nextElement ( &data_waypoint_route );
 
@@ -3041,27 +3358,7 @@ List* getRoutesBetween ( const GPXdoc* doc, float sourceLat, float sourceLong, f
 			last_p2y = my_waypoint_route->longitude;
 			last_p2x = my_waypoint_route->latitude;
 
-			float dx = 0;
-			float dy = 0;
-			float dz = 0;
-
-			original_p1y -= sourceLong;
-			original_p1y *= (3.1415926536 / 180), original_p1x *= (3.1415926536 / 180), sourceLat *= (3.1415926536 / 180);
-		
-			dz = sin(original_p1x) - sin(sourceLat);
-			dx = cos(original_p1y) * cos(original_p1x) - cos(sourceLat);
-			dy = sin(original_p1y) * cos(original_p1x);
-			source_dist = asin(sqrt(dx * dx + dy * dy + dz * dz) / 2) * 2 * 6371;
-
-			last_p2y -= destLong;
-			last_p2y *= (3.1415926536 / 180), last_p2x *= (3.1415926536 / 180), destLat *= (3.1415926536 / 180);
-		
-			dz = sin(last_p2x) - sin(destLat);
-			dx = cos(last_p2y) * cos(last_p2x) - cos(destLat);
-			dy = sin(last_p2y) * cos(last_p2x);
-			dest_dist = asin(sqrt(dx * dx + dy * dy + dz * dz) / 2) * 2 * 6371;
-
-			if ( (source_dist >= 0 && source_dist <= delta) || (dest_dist >= 0 && dest_dist <= delta) ) {
+			if ( withinDistance ( original_p1x, original_p1y, sourceLat, sourceLong, delta ) || withinDistance ( last_p2x, last_p2y, destLat, destLong, delta ) ) {
 				insertBack ( betweenRoutes, (void *)my_route );
 				atleastOne = true;
 			}
@@ -3085,7 +3382,7 @@ List* getRoutesBetween ( const GPXdoc* doc, float sourceLat, float sourceLong, f
 
 }
 
-bool isLoopRoute ( const Route* route, float delta ) {
+bool isLoopRouteKernel ( const Route* route, float delta, DistanceKernel kernel ) {
 
 	if ( route == NULL ) {
 		return false;
@@ -3101,12 +3398,19 @@ bool isLoopRoute ( const Route* route, float delta ) {
 		return false;
 	}
 
+	double first_vector[3];
+	double last_vector[3];
+
+	if ( endVectorsActive_function ( kernel ) && endVectors_function ( route, first_vector, last_vector ) ) {
+		return chordSquared_function ( first_vector, last_vector ) <= chordLimit_function ( delta / 1000 );
+	}
+
 	float total_dist = 0;
 
-	float original_p1y = 0;
-	float original_p1x = 0;
-	float last_p2x = 0;
-	float last_p2y = 0;
+	double original_p1y = 0;
+	double original_p1x = 0;
+	double last_p2x = 0;
+	double last_p2y = 0;
 
 	if ( route != NULL ) {
 
@@ -3125,17 +3429,7 @@ bool isLoopRoute ( const Route* route, float delta ) {
 			last_p2y = my_waypoint_route->longitude;
 			last_p2x = my_waypoint_route->latitude;
 
-			float dx = 0;
-			float dy = 0;
-			float dz = 0;
-			
-			original_p1y -= last_p2y;
-			original_p1y *= (3.1415926536 / 180), original_p1x *= (3.1415926536 / 180), last_p2x *= (3.1415926536 / 180);
-		
-			dz = sin(original_p1x) - sin(last_p2x);
-			dx = cos(original_p1y) * cos(original_p1x) - cos(last_p2x);
-			dy = sin(original_p1y) * cos(original_p1x);
-			total_dist = asin(sqrt(dx * dx + dy * dy + dz * dz) / 2) * 2 * 6371;
+			total_dist = kernel ( original_p1x, original_p1y, last_p2x, last_p2y );
 
 	}
 
@@ -3149,7 +3443,13 @@ bool isLoopRoute ( const Route* route, float delta ) {
 
 }
 
-float getRouteLen ( const Route *rt ) {
+bool isLoopRoute ( const Route* route, float delta ) {
+
+	return isLoopRouteKernel ( route, delta, distance_kernel );
+
+}
+
+float routeLenKernel ( const Route *rt, DistanceKernel kernel ) {
 
 	if ( rt == NULL ) {
 		return 0;
@@ -3166,10 +3466,10 @@ float getRouteLen ( const Route *rt ) {
 
 		for ( int i = 1; i < the_length; i++ ) {
 
-			float p1x = 0;
-			float p1y = 0;
-			float p2x = 0;
-			float p2y = 0;
+			double p1x = 0;
+			double p1y = 0;
+			double p2x = 0;
+			double p2y = 0;
 
 			p1y = my_waypoint_route->longitude;
 			p1x = my_waypoint_route->latitude;
@@ -3179,17 +3479,7 @@ float getRouteLen ( const Route *rt ) {
 			p2y = my_waypoint_route->longitude;
 			p2x = my_waypoint_route->latitude;
 
-			float dx = 0;
-			float dy = 0;
-			float dz = 0;
-			
-			p1y -= p2y;
-			p1y *= (3.1415926536 / 180), p1x *= (3.1415926536 / 180), p2x *= (3.1415926536 / 180);
-		
-			dz = sin(p1x) - sin(p2x);
-			dx = cos(p1y) * cos(p1x) - cos(p2x);
-			dy = sin(p1y) * cos(p1x);
-			total_dist = total_dist + asin(sqrt(dx * dx + dy * dy + dz * dz) / 2) * 2 * 6371;
+			total_dist = total_dist + kernel ( p1x, p1y, p2x, p2y );
 
 		}
 
@@ -3201,6 +3491,12 @@ float getRouteLen ( const Route *rt ) {
 
 }
 
+float getRouteLen ( const Route *rt ) {
+
+	return routeLenKernel ( rt, distance_kernel );
+
+}
+
 float round10 ( float len ) {
 
 	int rounded = 0;
@@ -3260,7 +3556,7 @@ xmlDocPtr GPXtoXML ( GPXdoc* doc ) {
 			}
 
 			if ( my_waypoint->otherData != NULL ) {
-				node1 = xmlNewChild ( node, NULL, ( const xmlChar * ) my_data_waypoint->name, ( const xmlChar * ) my_data_waypoint->value );
+				node1 = xmlNewChild ( node, NULL, ( const xmlChar * ) gpxDataName ( my_waypoint->otherData, my_data_waypoint ), ( const xmlChar * ) gpxDataValue ( my_waypoint->otherData, my_data_waypoint ) );
 			}
 
 			my_data_waypoint = nextElement( &data_iterator_waypoint );
@@ -3288,7 +3584,7 @@ xmlDocPtr GPXtoXML ( GPXdoc* doc ) {
 		ListIterator route_iterator_otherData = createIterator ( my_route->otherData );
 		while ( (temp_current = nextElement(&route_iterator_otherData) ) != NULL ) {
 			GPXData * my_data = ( GPXData *) temp_current;
-			node1 = xmlNewChild ( node, NULL, ( const xmlChar * ) my_data->name, ( const xmlChar * ) my_data->value );
+			node1 = xmlNewChild ( node, NULL, ( const xmlChar * ) gpxDataName ( my_route->otherData, my_data ), ( const xmlChar * ) gpxDataValue ( my_route->otherData, my_data ) );
 			xmlAddChild ( node, node1 );
 		}
 
@@ -3304,8 +3600,7 @@ xmlDocPtr GPXtoXML ( GPXdoc* doc ) {
 			ListIterator waypoint_iterator_otherData = createIterator ( my_waypoint->otherData );
 			while ( (temp_current1 = nextElement(&waypoint_iterator_otherData) ) != NULL ) {
 				GPXData * my_data = ( GPXData *) temp_current1;
-				node2 = xmlNewChild ( node, NULL, ( const xmlChar * ) my_data->name, ( const xmlChar * ) my_data->value );
-				xmlAddChild ( node1, node2 );
+				node2 = xmlNewChild ( node1, NULL, ( const xmlChar * ) gpxDataName ( my_waypoint->otherData, my_data ), ( const xmlChar * ) gpxDataValue ( my_waypoint->otherData, my_data ) );
 			}
 			sprintf ( temporary,"%f", my_waypoint->latitude );
 			xmlNewProp ( node1, BAD_CAST "lat", ( const xmlChar * ) temporary );
@@ -3339,7 +3634,7 @@ xmlDocPtr GPXtoXML ( GPXdoc* doc ) {
 			}
 
 			if ( my_track->otherData != NULL ) {
-				node1 = xmlNewChild ( node, NULL, ( const xmlChar * ) my_data_track->name, ( const xmlChar * ) my_data_track->value );
+				node1 = xmlNewChild ( node, NULL, ( const xmlChar * ) gpxDataName ( my_track->otherData, my_data_track ), ( const xmlChar * ) gpxDataValue ( my_track->otherData, my_data_track ) );
 			}
 
 			void *temp2 = NULL;
@@ -3372,7 +3667,7 @@ xmlDocPtr GPXtoXML ( GPXdoc* doc ) {
 					}
 
 					if ( my_waypoint_track->otherData != NULL ) {
-						xmlNewChild ( node2, NULL, ( const xmlChar * ) my_data_track_waypoint->name, ( const xmlChar * ) my_data_track_waypoint->value );
+						xmlNewChild ( node2, NULL, ( const xmlChar * ) gpxDataName ( my_waypoint_track->otherData, my_data_track_waypoint ), ( const xmlChar * ) gpxDataValue ( my_waypoint_track->otherData, my_data_track_waypoint ) );
 					}
 
 				}
@@ -3704,6 +3999,10 @@ void addWaypoint(Route *rt, Waypoint *pt) {
 		return;
 	}
 
+	/* The route's far end moves, so its cached end vectors go stale */
+	dropEndVectors ( rt );
+	dropLengthIndexOf ( rt );
+
 	insertBack ( rt->waypoints, (void *) pt );
 
 	return;
@@ -3716,6 +4015,8 @@ void addRoute(GPXdoc* doc, Route* rt) {
 		return;
 	}
 
+	detachLengthIndex ( doc );
+
 	insertBack ( doc->routes, (void *) rt );
 
 	return;
@@ -4118,6 +4419,8 @@ GPXdoc* createValidGPXdoc ( char* fileName, char* gpxSchemaFile) {
 	xmlFreeDoc(doc);
 	xmlCleanupParser();
 
+	attachEndVectors ( my_doc );
+
     return my_doc;
 
 }
@@ -4221,6 +4524,8 @@ GPXdoc* createGPXdoc ( char* fileName ) {
 	/* xmlFreeDoc function was retrieved from http://xmlsoft.org/ */
 	xmlFreeDoc(doc);
 
+	attachEndVectors ( my_doc );
+
     return my_doc;
 
 }
@@ -4251,6 +4556,9 @@ void deleteGPXdoc ( GPXdoc* doc ) {
 		return;
     }
 
+	detachEndVectors ( doc );
+	detachLengthIndex ( doc );
+
     free ( doc->creator );
 
 	freeList ( doc->waypoints );
@@ -4261,6 +4569,8403 @@ void deleteGPXdoc ( GPXdoc* doc ) {
 
 }
 
+Waypoint *trackpoint_function ( xmlNode *cur_node ) {
+
+	if ( cur_node == NULL ) {
+		return NULL;
+	}
+
+	Waypoint *my_waypoint = ( Waypoint *) malloc ( sizeof ( Waypoint ) );
+
+	my_waypoint->name = NULL;
+	my_waypoint->latitude = 0;
+	my_waypoint->longitude = 0;
+	my_waypoint->otherData = initializeList ( &symbolDataToString, &deleteSymbolData, &compareSymbolData );
+
+	xmlNode *temp_node = NULL;
+
+	for ( temp_node = cur_node->children; temp_node != NULL; temp_node = temp_node->next ) {
+
+		if ( temp_node->type != XML_ELEMENT_NODE ) {
+			continue;
+		}
+
+		char *temp_name = (char *) xmlNodeGetContent ( temp_node );
+
+		if ( strcmp ( "name", (char *)(temp_node->name) ) == 0 && my_waypoint->name == NULL ) {
+			my_waypoint->name = (char *) ( malloc ( strlen ( temp_name ) + 1 ) );
+			strcpy ( my_waypoint->name, temp_name );
+		}
+		else {
+			insertBack ( my_waypoint->otherData, (void *)symbolData_function ( (char*)temp_node->name, temp_name ) );
+		}
+
+		free ( temp_name );
+
+	}
+
+	if ( my_waypoint->name == NULL ) {
+		my_waypoint->name = (char *) ( malloc ( 1 ) );
+		my_waypoint->name[0] = '\0';
+	}
+
+	List *temp_data = my_waypoint->otherData;
+	my_waypoint->otherData = packOtherData ( temp_data );
+	freeList ( temp_data );
+
+	xmlAttr *attr = NULL;
+	for ( attr = cur_node->properties; attr != NULL; attr = attr->next ) {
+
+		xmlNode *value = attr->children;
+		char *attrName = (char *)attr->name;
+		char *cont = (char *)(value->content);
+
+		if ( strcmp ( "lat", attrName ) == 0 ) {
+			my_waypoint->latitude = strtod ( cont, NULL );
+		}
+		else if ( strcmp ( "lon", attrName ) == 0 ) {
+			my_waypoint->longitude = strtod ( cont, NULL );
+		}
+
+	}
+
+	return my_waypoint;
+
+}
+
+/* Finds the next "<tag" whose name ends right after the tag (so "<trk" does not match "<trkpt") */
+const char *findTag ( const char *buffer, const char *end, const char *tag ) {
+
+	int len = strlen ( tag );
+
+	while ( buffer != NULL && buffer < end ) {
+
+		buffer = memchr ( buffer, '<', end - buffer );
+
+		if ( buffer == NULL || end - buffer < len + 2 ) {
+			return NULL;
+		}
+
+		if ( strncmp ( buffer + 1, tag, len ) == 0 ) {
+			char after = buffer[len + 1];
+			if ( after == '>' || after == '/' || after == ' ' || after == '\t' || after == '\r' || after == '\n' ) {
+				return buffer;
+			}
+		}
+
+		buffer = buffer + 1;
+
+	}
+
+	return NULL;
+
+}
+
+List *trackpointChunk_function ( const char *start, const char *end ) {
+
+	List *my_waypoints = initializeList ( &waypointToString, &deleteWaypoint, &compareWaypoints );
+
+	if ( start == NULL || end <= start ) {
+		return my_waypoints;
+	}
+
+	/* Wrap the chunk so libxml sees a single well formed trkseg element */
+	int len = end - start;
+	char *wrapped = malloc ( len + 32 );
+	strcpy ( wrapped, "<trkseg>" );
+	memcpy ( wrapped + 8, start, len );
+	strcpy ( wrapped + 8 + len, "</trkseg>" );
+
+	xmlDoc *doc = xmlReadMemory ( wrapped, len + 17, NULL, NULL, XML_PARSE_NOERROR | XML_PARSE_NOWARNING | XML_PARSE_HUGE );
+
+	free ( wrapped );
+
+	if ( doc == NULL ) {
+		return my_waypoints;
+	}
+
+	xmlNode *cur_node = NULL;
+
+	for ( cur_node = xmlDocGetRootElement ( doc )->children; cur_node != NULL; cur_node = cur_node->next ) {
+
+		if ( cur_node->type == XML_ELEMENT_NODE && strcmp ( "trkpt", (char *)(cur_node->name) ) == 0 ) {
+			insertBack ( my_waypoints, trackpoint_function ( cur_node ) );
+		}
+
+	}
+
+	xmlFreeDoc ( doc );
+
+	return my_waypoints;
+
+}
+
+void *parallelTrack_worker ( void *data ) {
+
+	ParallelTrackJob *job = (ParallelTrackJob *) data;
+
+	while ( true ) {
+
+		pthread_mutex_lock ( &(job->lock) );
+		int i = job->next_chunk;
+		job->next_chunk = job->next_chunk + 1;
+		pthread_mutex_unlock ( &(job->lock) );
+
+		if ( i >= job->num_chunks ) {
+			break;
+		}
+
+		job->chunks[i].waypoints = trackpointChunk_function ( job->chunks[i].start, job->chunks[i].end );
+
+	}
+
+	return NULL;
+
+}
+
+/* True when some tag names a trk, trkseg or trkpt through a namespace prefix, which findTag cannot see */
+bool prefixedTrackTags_function ( const char *buffer, const char *end ) {
+
+	const char *colon = memchr ( buffer, ':', end - buffer );
+
+	while ( colon != NULL && end - colon > 3 ) {
+
+		if ( strncmp ( colon + 1, "trk", 3 ) == 0 ) {
+			return true;
+		}
+
+		colon = memchr ( colon + 1, ':', end - colon - 1 );
+
+	}
+
+	return false;
+
+}
+
+/* The first track of fileName through track_function on the whole document, for files the chunk splitter cannot handle */
+Track *serialTrack_function ( char* fileName ) {
+
+	xmlDoc *doc = xmlReadFile ( fileName, NULL, XML_PARSE_HUGE );
+
+	if ( doc == NULL ) {
+		return NULL;
+	}
+
+	Track *my_track = NULL;
+	xmlNode *root_element = xmlDocGetRootElement ( doc );
+	xmlNode *cur_node = root_element == NULL ? NULL : root_element->children;
+
+	while ( cur_node != NULL && my_track == NULL ) {
+
+		if ( cur_node->type == XML_ELEMENT_NODE && strcmp ( "trk", (char *)(cur_node->name) ) == 0 ) {
+			my_track = track_function ( cur_node );
+		}
+
+		cur_node = cur_node->next;
+
+	}
+
+	xmlFreeDoc ( doc );
+
+	return my_track;
+
+}
+
+Track *createParallelTrack ( char* fileName, int numThreads ) {
+
+	if ( fileName == NULL || strcmp ( fileName, "" ) == 0 ) {
+		fprintf ( stderr, "File name cannot be an empty string or NULL.\n" );
+		return NULL;
+	}
+
+	if ( numThreads < 1 ) {
+		numThreads = 1;
+	}
+
+	if ( numThreads > 64 ) {
+		numThreads = 64;
+	}
+
+	int fd = open ( fileName, O_RDONLY );
+
+	if ( fd < 0 ) {
+		fprintf ( stderr, "Failed to open %s\n", fileName );
+		return NULL;
+	}
+
+	struct stat file_info;
+
+	if ( fstat ( fd, &file_info ) != 0 || file_info.st_size == 0 ) {
+		close ( fd );
+		return NULL;
+	}
+
+	size_t size = file_info.st_size;
+	const char *buffer = mmap ( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close ( fd );
+
+	if ( buffer == MAP_FAILED ) {
+		fprintf ( stderr, "Failed to map %s\n", fileName );
+		return NULL;
+	}
+
+	madvise ( (void *)buffer, size, MADV_SEQUENTIAL );
+
+	const char *end = buffer + size;
+
+	if ( prefixedTrackTags_function ( buffer, end ) ) {
+		munmap ( (void *)buffer, size );
+		return serialTrack_function ( fileName );
+	}
+
+	const char *trk_start = findTag ( buffer, end, "trk" );
+
+	if ( trk_start == NULL ) {
+		munmap ( (void *)buffer, size );
+		return NULL;
+	}
+
+	const char *trk_body = memchr ( trk_start, '>', end - trk_start );
+	const char *first_seg = findTag ( trk_body, end, "trkseg" );
+	const char *trk_end = NULL;
+
+	if ( first_seg == NULL ) {
+		first_seg = findTag ( trk_body, end, "/trk" );
+		trk_end = first_seg;
+	}
+
+	if ( trk_body == NULL || first_seg == NULL ) {
+		munmap ( (void *)buffer, size );
+		return NULL;
+	}
+
+	xmlInitParser();
+
+	/* Name and otherData live before the first trkseg, parse them with the regular track function */
+	int header_len = first_seg - ( trk_body + 1 );
+	char *header = malloc ( header_len + 16 );
+	strcpy ( header, "<trk>" );
+	memcpy ( header + 5, trk_body + 1, header_len );
+	strcpy ( header + 5 + header_len, "</trk>" );
+
+	xmlDoc *header_doc = xmlReadMemory ( header, header_len + 11, NULL, NULL, XML_PARSE_NOERROR | XML_PARSE_NOWARNING );
+	free ( header );
+
+	Track *my_track = NULL;
+
+	if ( header_doc != NULL ) {
+		my_track = track_function ( xmlDocGetRootElement ( header_doc ) );
+		xmlFreeDoc ( header_doc );
+	}
+
+	if ( my_track == NULL ) {
+		munmap ( (void *)buffer, size );
+		return NULL;
+	}
+
+	if ( trk_end != NULL ) {
+		munmap ( (void *)buffer, size );
+		return my_track;
+	}
+
+	/* Locate every trkseg body and cut it into chunks that start on a trkpt boundary */
+	size_t chunk_size = ( size / ( numThreads * 8 ) ) + 1;
+
+	if ( chunk_size < 65536 ) {
+		chunk_size = 65536;
+	}
+
+	int max_chunks = 64;
+	int num_chunks = 0;
+	int num_segments = 0;
+	TrackChunk *chunks = malloc ( sizeof ( TrackChunk ) * max_chunks );
+
+	const char *seg_start = first_seg;
+	const char *close_trk = NULL;
+
+	while ( seg_start != NULL ) {
+
+		const char *seg_body = memchr ( seg_start, '>', end - seg_start );
+
+		if ( seg_body == NULL ) {
+			break;
+		}
+
+		const char *seg_end = seg_body;
+
+		if ( *(seg_body - 1) != '/' ) {
+			seg_end = findTag ( seg_body, end, "/trkseg" );
+			if ( seg_end == NULL ) {
+				break;
+			}
+		}
+
+		const char *chunk_start = findTag ( seg_body, seg_end, "trkpt" );
+
+		while ( chunk_start != NULL ) {
+
+			const char *chunk_end = seg_end;
+
+			if ( (size_t)( seg_end - chunk_start ) > chunk_size ) {
+				chunk_end = findTag ( chunk_start + chunk_size, seg_end, "trkpt" );
+				if ( chunk_end == NULL ) {
+					chunk_end = seg_end;
+				}
+			}
+
+			if ( num_chunks == max_chunks ) {
+				max_chunks = max_chunks * 2;
+				chunks = realloc ( chunks, sizeof ( TrackChunk ) * max_chunks );
+			}
+
+			chunks[num_chunks].start = chunk_start;
+			chunks[num_chunks].end = chunk_end;
+			chunks[num_chunks].segment = num_segments;
+			chunks[num_chunks].waypoints = NULL;
+			num_chunks = num_chunks + 1;
+
+			chunk_start = ( chunk_end == seg_end ) ? NULL : chunk_end;
+
+		}
+
+		num_segments = num_segments + 1;
+
+		const char *next_tag = findTag ( seg_end + 1, end, "trkseg" );
+		close_trk = findTag ( seg_end + 1, end, "/trk" );
+
+		if ( next_tag != NULL && close_trk != NULL && close_trk < next_tag ) {
+			next_tag = NULL;
+		}
+
+		seg_start = next_tag;
+
+	}
+
+	/* Only the first track is split, so a file holding more goes through the serial parser */
+	if ( close_trk == NULL || findTag ( close_trk + 1, end, "trk" ) != NULL ) {
+		free ( chunks );
+		munmap ( (void *)buffer, size );
+		deleteTrack ( my_track );
+		return serialTrack_function ( fileName );
+	}
+
+	ParallelTrackJob job;
+	job.chunks = chunks;
+	job.num_chunks = num_chunks;
+	job.next_chunk = 0;
+	pthread_mutex_init ( &(job.lock), NULL );
+
+	if ( numThreads > num_chunks ) {
+		numThreads = num_chunks;
+	}
+
+	pthread_t *threads = malloc ( sizeof ( pthread_t ) * ( numThreads + 1 ) );
+	int num_started = 0;
+
+	/* A thread that cannot be started just leaves its share of the queue to the others */
+	for ( int i = 1; i < numThreads; i++ ) {
+		if ( pthread_create ( &threads[num_started], NULL, &parallelTrack_worker, &job ) == 0 ) {
+			num_started = num_started + 1;
+		}
+	}
+
+	/* The calling thread takes chunks too */
+	parallelTrack_worker ( &job );
+
+	for ( int i = 0; i < num_started; i++ ) {
+		pthread_join ( threads[i], NULL );
+	}
+
+	pthread_mutex_destroy ( &(job.lock) );
+	free ( threads );
+
+	/* Stitch the chunk lists back together in file order */
+	int current = 0;
+
+	for ( int i = 0; i < num_segments; i++ ) {
+
+		TrackSegment *my_trackSegment = ( TrackSegment *) malloc ( sizeof ( TrackSegment ) );
+		my_trackSegment->waypoints = initializeList ( &waypointToString, &deleteWaypoint, &compareWaypoints );
+
+		while ( current < num_chunks && chunks[current].segment == i ) {
+			spliceList ( my_trackSegment->waypoints, chunks[current].waypoints );
+			freeList ( chunks[current].waypoints );
+			current = current + 1;
+		}
+
+		insertBack ( my_track->segments, (void *) (my_trackSegment) );
+
+	}
+
+	free ( chunks );
+	munmap ( (void *)buffer, size );
+
+	return my_track;
+
+}
+
+/* Flat-earth approximation on the 6371 km sphere; within 0.02% of the sphere up to 100 km, 2% by 1000 km */
+double equirectangularDistance ( double p1x, double p1y, double p2x, double p2y ) {
+
+	double dlon = ( p1y - p2y ) * ( 3.1415926536 / 180 );
+	double dlat = ( p1x - p2x ) * ( 3.1415926536 / 180 );
+
+	if ( dlon > 3.1415926536 ) {
+		dlon = dlon - 2 * 3.1415926536;
+	} else if ( dlon < -3.1415926536 ) {
+		dlon = dlon + 2 * 3.1415926536;
+	}
+
+	double x = dlon * cos ( ( p1x + p2x ) * ( 3.1415926536 / 360 ) );
+
+	return sqrt ( x * x + dlat * dlat ) * 6371;
+
+}
+
+/* The original chord formula on the 6371 km sphere in float; up to 0.56% from the ellipsoid plus up to 1.7 m of float rounding per hop */
+double chordDistance ( double lat1, double lon1, double lat2, double lon2 ) {
+
+	float p1x = lat1;
+	float p1y = lon1;
+	float p2x = lat2;
+	float p2y = lon2;
+
+	float dx, dy, dz;
+
+	p1y -= p2y;
+	p1y *= (3.1415926536 / 180), p1x *= (3.1415926536 / 180), p2x *= (3.1415926536 / 180);
+
+	dz = sin(p1x) - sin(p2x);
+	dx = cos(p1y) * cos(p1x) - cos(p2x);
+	dy = sin(p1y) * cos(p1x);
+
+	return asin(sqrt(dx * dx + dy * dy + dz * dz) / 2) * 2 * 6371;
+
+}
+
+/* Vincenty's inverse formula on the WGS84 ellipsoid, good to well under a millimetre; nearly antipodal points that do not converge fall back to chordDistance */
+double vincentyDistance ( double p1x, double p1y, double p2x, double p2y ) {
+
+	const double a = 6378137.0;
+	const double f = 1 / 298.257223563;
+	const double b = a * ( 1 - f );
+
+	double L = ( p2y - p1y ) * ( 3.1415926536 / 180 );
+	double U1 = atan ( ( 1 - f ) * tan ( p1x * ( 3.1415926536 / 180 ) ) );
+	double U2 = atan ( ( 1 - f ) * tan ( p2x * ( 3.1415926536 / 180 ) ) );
+	double sinU1 = sin ( U1 );
+	double cosU1 = cos ( U1 );
+	double sinU2 = sin ( U2 );
+	double cosU2 = cos ( U2 );
+
+	double lambda = L;
+	double sin_sigma = 0;
+	double cos_sigma = 0;
+	double sigma = 0;
+	double cos_sq_alpha = 0;
+	double cos_2sigma_m = 0;
+
+	for ( int i = 0; i < 200; i++ ) {
+
+		double sin_lambda = sin ( lambda );
+		double cos_lambda = cos ( lambda );
+
+		sin_sigma = sqrt ( ( cosU2 * sin_lambda ) * ( cosU2 * sin_lambda ) + ( cosU1 * sinU2 - sinU1 * cosU2 * cos_lambda ) * ( cosU1 * sinU2 - sinU1 * cosU2 * cos_lambda ) );
+
+		if ( sin_sigma == 0 ) {
+			return 0;
+		}
+
+		cos_sigma = sinU1 * sinU2 + cosU1 * cosU2 * cos_lambda;
+		sigma = atan2 ( sin_sigma, cos_sigma );
+
+		double sin_alpha = cosU1 * cosU2 * sin_lambda / sin_sigma;
+
+		cos_sq_alpha = 1 - sin_alpha * sin_alpha;
+		cos_2sigma_m = cos_sq_alpha != 0 ? cos_sigma - 2 * sinU1 * sinU2 / cos_sq_alpha : 0;
+
+		double C = f / 16 * cos_sq_alpha * ( 4 + f * ( 4 - 3 * cos_sq_alpha ) );
+		double previous = lambda;
+
+		lambda = L + ( 1 - C ) * f * sin_alpha * ( sigma + C * sin_sigma * ( cos_2sigma_m + C * cos_sigma * ( -1 + 2 * cos_2sigma_m * cos_2sigma_m ) ) );
+
+		if ( fabs ( lambda - previous ) < 1e-12 ) {
+
+			double u_sq = cos_sq_alpha * ( a * a - b * b ) / ( b * b );
+			double A = 1 + u_sq / 16384 * ( 4096 + u_sq * ( -768 + u_sq * ( 320 - 175 * u_sq ) ) );
+			double B = u_sq / 1024 * ( 256 + u_sq * ( -128 + u_sq * ( 74 - 47 * u_sq ) ) );
+			double delta_sigma = B * sin_sigma * ( cos_2sigma_m + B / 4 * ( cos_sigma * ( -1 + 2 * cos_2sigma_m * cos_2sigma_m ) - B / 6 * cos_2sigma_m * ( -3 + 4 * sin_sigma * sin_sigma ) * ( -3 + 4 * cos_2sigma_m * cos_2sigma_m ) ) );
+
+			return b * A * ( sigma - delta_sigma ) / 1000;
+
+		}
+
+	}
+
+	return chordDistance ( p1x, p1y, p2x, p2y );
+
+}
+
+/* sin and cos of x for |x| < 12 from one reduction to [-pi/4, pi/4]; fdlibm kernel coefficients, within 1 ulp of libm there */
+void polySinCos_function ( double x, double *s, double *c ) {
+
+	int q = (int) ( x * 0.636619772367581343076 + 8.5 ) - 8;
+	double r = ( x - q * 1.57079632673412561417e+00 ) - q * 6.07710050650619224932e-11;
+	double z = r * r;
+
+	double sin_r = r + r * z * ( -1.66666666666666324348e-01 + z * ( 8.33333333332248946124e-03 + z * ( -1.98412698298579493134e-04 + z * ( 2.75573137070700676789e-06 + z * ( -2.50507602534068634195e-08 + z * 1.58969099521155010221e-10 ) ) ) ) );
+	double cos_r = 1 - 0.5 * z + z * z * ( 4.16666666666666019037e-02 + z * ( -1.38888888888741095749e-03 + z * ( 2.48015872894767294178e-05 + z * ( -2.75573143513906633035e-07 + z * ( 2.08757232129817482790e-09 + z * -1.13596475577881948265e-11 ) ) ) ) );
+
+	int quadrant = q & 3;
+
+	*s = quadrant == 0 ? sin_r : quadrant == 1 ? cos_r : quadrant == 2 ? -sin_r : -cos_r;
+	*c = quadrant == 0 ? cos_r : quadrant == 1 ? -sin_r : quadrant == 2 ? -cos_r : sin_r;
+
+}
+
+/* asin for 0 <= x <= 1; fdlibm's rational form on [0, 0.5], the half-angle identity above it */
+double polyAsin_function ( double x ) {
+
+	bool large = x > 0.5;
+	double y = large ? sqrt ( ( 1 - x ) / 2 ) : x;
+	double z = y * y;
+
+	double p = z * ( 1.66666666666666657415e-01 + z * ( -3.25565818622400915405e-01 + z * ( 2.01212532134862925881e-01 + z * ( -4.00555345006794114027e-02 + z * ( 7.91534994289814532176e-04 + z * 3.47933107596021167570e-05 ) ) ) ) );
+	double q = 1 + z * ( -2.40339491173441421878e+00 + z * ( 2.02094576023350569471e+00 + z * ( -6.88283971605453293030e-01 + z * 7.70381505559019352791e-02 ) ) );
+	double a = y + y * p / q;
+
+	return large ? 1.57079632679489661923 - 2 * a : a;
+
+}
+
+void polySinCosF_function ( float x, float *s, float *c ) {
+
+	int q = (int) ( x * 0.636619772f + 8.5f ) - 8;
+	float r = ( x - q * 1.5707963109f ) - q * 1.5893254e-08f;
+	float z = r * r;
+
+	float sin_r = r + r * z * ( -0.166666666416f + z * ( 0.0083333293859f + z * ( -0.000198393348361f + z * 0.0000027183114940f ) ) );
+	float cos_r = 1 + z * ( -0.499999997251f + z * ( 0.0416666233237f + z * ( -0.00138867637746f + z * 0.0000243904487963f ) ) );
+
+	int quadrant = q & 3;
+
+	*s = quadrant == 0 ? sin_r : quadrant == 1 ? cos_r : quadrant == 2 ? -sin_r : -cos_r;
+	*c = quadrant == 0 ? cos_r : quadrant == 1 ? -sin_r : quadrant == 2 ? -cos_r : sin_r;
+
+}
+
+float polyAsinF_function ( float x ) {
+
+	bool large = x > 0.5f;
+	float y = large ? sqrtf ( ( 1 - x ) / 2 ) : x;
+	float z = y * y;
+
+	float a = y + y * ( z * ( 1.6666586697e-01f + z * ( -4.2743422091e-02f + z * -8.6563630030e-03f ) ) / ( 1 + z * -7.0662963390e-01f ) );
+
+	return large ? 1.5707963268f - 2 * a : a;
+
+}
+
+/* chordDistance's formula in double with the polynomials above in place of libm; within 1e-8 m of libm per hop, so far closer than the float original */
+double polyChordDistance ( double lat1, double lon1, double lat2, double lon2 ) {
+
+	double sin_dlon, cos_dlon, sin_lat1, cos_lat1, sin_lat2, cos_lat2;
+
+	polySinCos_function ( ( lon1 - lon2 ) * ( 3.1415926536 / 180 ), &sin_dlon, &cos_dlon );
+	polySinCos_function ( lat1 * ( 3.1415926536 / 180 ), &sin_lat1, &cos_lat1 );
+	polySinCos_function ( lat2 * ( 3.1415926536 / 180 ), &sin_lat2, &cos_lat2 );
+
+	double dz = sin_lat1 - sin_lat2;
+	double dx = cos_dlon * cos_lat1 - cos_lat2;
+	double dy = sin_dlon * cos_lat1;
+	double half = sqrt ( dx * dx + dy * dy + dz * dz ) / 2;
+
+	return polyAsin_function ( half > 1 ? 1 : half ) * 2 * 6371;
+
+}
+
+/* Haversine with the float polynomials; the half differences are taken in double, so short hops keep float's relative precision instead of cancelling.
+ * Measured by GPXKernelTest against libm in double: at most 1.4 mm off on any hop and 1.6e-7 of a route or track total (3 mm on the longest) */
+double polyHaversineDistanceF ( double lat1, double lon1, double lat2, double lon2 ) {
+
+	float sin_dlat, cos_dlat, sin_dlon, cos_dlon, sin_lat1, cos_lat1, sin_lat2, cos_lat2;
+
+	polySinCosF_function ( (float) ( ( lat1 - lat2 ) * ( 3.14159265358979323846 / 360 ) ), &sin_dlat, &cos_dlat );
+	polySinCosF_function ( (float) ( ( lon1 - lon2 ) * ( 3.14159265358979323846 / 360 ) ), &sin_dlon, &cos_dlon );
+	polySinCosF_function ( (float) ( lat1 * ( 3.14159265358979323846 / 180 ) ), &sin_lat1, &cos_lat1 );
+	polySinCosF_function ( (float) ( lat2 * ( 3.14159265358979323846 / 180 ) ), &sin_lat2, &cos_lat2 );
+
+	float h = sin_dlat * sin_dlat + cos_lat1 * cos_lat2 * sin_dlon * sin_dlon;
+
+	return polyAsinF_function ( sqrtf ( h > 1 ? 1 : h ) ) * 2 * 6371;
+
+}
+
+/* "equirectangular", "chord", "chord_poly", "haversine_polyf" or "vincenty"; NULL for any other name */
+DistanceKernel distanceKernelNamed ( const char *name ) {
+
+	if ( name == NULL ) {
+		return NULL;
+	}
+
+	if ( strcmp ( name, "equirectangular" ) == 0 ) {
+		return &equirectangularDistance;
+	} else if ( strcmp ( name, "chord" ) == 0 ) {
+		return &chordDistance;
+	} else if ( strcmp ( name, "chord_poly" ) == 0 ) {
+		return &polyChordDistance;
+	} else if ( strcmp ( name, "haversine_polyf" ) == 0 ) {
+		return &polyHaversineDistanceF;
+	} else if ( strcmp ( name, "vincenty" ) == 0 ) {
+		return &vincentyDistance;
+	}
+
+	return NULL;
+
+}
+
+/* Sets the process default kernel; false leaves it unchanged. Per request kernels are passed to the *Kernel functions instead */
+bool setDistanceKernel ( const char *name ) {
+
+	DistanceKernel kernel = distanceKernelNamed ( name );
+
+	if ( kernel == NULL ) {
+		return false;
+	}
+
+	distance_kernel = kernel;
+
+	return true;
+
+}
+
+bool withinDistance ( double p1x, double p1y, double p2x, double p2y, double delta ) {
+
+	return withinDistanceKernel ( p1x, p1y, p2x, p2y, delta, distance_kernel );
+
+}
+
+/* Whether two points are within delta km under kernel; a latitude gap alone longer than delta rejects without the kernel */
+bool withinDistanceKernel ( double p1x, double p1y, double p2x, double p2y, double delta, DistanceKernel kernel ) {
+
+	/* No kernel puts a degree of latitude under 110.5 km (the WGS84 meridian minimum is 110.57) */
+	if ( fabs ( p1x - p2x ) * 110.5 > delta + 0.002 ) {
+		return false;
+	}
+
+	float dist = kernel ( p1x, p1y, p2x, p2y );
+
+	return dist >= 0 && dist <= delta;
+
+}
+
+float distance_function ( float p1x, float p1y, float p2x, float p2y ) {
+
+	return distance_kernel ( p1x, p1y, p2x, p2y );
+
+}
+
+/* distance_function under an explicit kernel, for structures that keep the kernel they were built with */
+float kernelDistance_function ( DistanceKernel kernel, float p1x, float p1y, float p2x, float p2y ) {
+
+	return kernel ( p1x, p1y, p2x, p2y );
+
+}
+
+/* Returns the first byte after the trkpt element starting at start, or NULL if it is not complete yet */
+const char *trackpointEnd ( const char *start, const char *end ) {
+
+	const char *close = memchr ( start, '>', end - start );
+
+	if ( close == NULL ) {
+		return NULL;
+	}
+
+	if ( *(close - 1) == '/' ) {
+		return close + 1;
+	}
+
+	close = findTag ( close, end, "/trkpt" );
+
+	if ( close == NULL || end - close < 8 ) {
+		return NULL;
+	}
+
+	return close + 8;
+
+}
+
+int tailAppend_function ( GPXTail *tail, const char *start, const char *end ) {
+
+	List *new_points = trackpointChunk_function ( start, end );
+
+	int num_new = getLength ( new_points );
+
+	if ( num_new == 0 ) {
+		freeList ( new_points );
+		return 0;
+	}
+
+	/* Only the hops from the last known point through the new points are added to the length */
+	ListIterator point_iter = createIterator ( new_points );
+	Waypoint *my_waypoint = nextElement ( &point_iter );
+
+	while ( my_waypoint != NULL ) {
+
+		if ( tail->last_point != NULL ) {
+			tail->length = tail->length + distance_function ( tail->last_point->latitude, tail->last_point->longitude, my_waypoint->latitude, my_waypoint->longitude ) * 1000;
+		}
+
+		tail->last_point = my_waypoint;
+		my_waypoint = nextElement ( &point_iter );
+
+	}
+
+	TrackSegment *my_trackSegment = getFromBack ( tail->track->segments );
+
+	if ( my_trackSegment == NULL ) {
+		my_trackSegment = ( TrackSegment *) malloc ( sizeof ( TrackSegment ) );
+		my_trackSegment->waypoints = initializeList ( &waypointToString, &deleteWaypoint, &compareWaypoints );
+		insertBack ( tail->track->segments, (void *) (my_trackSegment) );
+	}
+
+	spliceList ( my_trackSegment->waypoints, new_points );
+	freeList ( new_points );
+
+	tail->num_points = tail->num_points + num_new;
+
+	return num_new;
+
+}
+
+/* Appends every complete trkpt in [start, end) to the tail, opening a segment at each trkseg; returns the first byte not consumed */
+const char *tailScan_function ( GPXTail *tail, const char *start, const char *end, int *num_new ) {
+
+	const char *pos = start;
+	const char *consumed = start;
+	const char *run_start = NULL;
+	const char *run_end = NULL;
+
+	while ( pos < end ) {
+
+		const char *point = findTag ( pos, end, "trkpt" );
+		const char *segment = findTag ( pos, point == NULL ? end : point, "trkseg" );
+
+		/* A new trkseg closes the current run of points and opens a new segment */
+		if ( segment != NULL ) {
+
+			const char *segment_body = memchr ( segment, '>', end - segment );
+
+			if ( segment_body == NULL ) {
+				break;
+			}
+
+			if ( run_start != NULL ) {
+				*num_new = *num_new + tailAppend_function ( tail, run_start, run_end );
+				run_start = NULL;
+			}
+
+			TrackSegment *my_trackSegment = ( TrackSegment *) malloc ( sizeof ( TrackSegment ) );
+			my_trackSegment->waypoints = initializeList ( &waypointToString, &deleteWaypoint, &compareWaypoints );
+			insertBack ( tail->track->segments, (void *) (my_trackSegment) );
+
+			pos = segment_body + 1;
+			consumed = pos;
+			continue;
+
+		}
+
+		if ( point == NULL ) {
+			break;
+		}
+
+		const char *point_end = trackpointEnd ( point, end );
+
+		if ( point_end == NULL ) {
+			break;
+		}
+
+		if ( run_start == NULL ) {
+			run_start = point;
+		}
+
+		run_end = point_end;
+		pos = point_end;
+		consumed = pos;
+
+	}
+
+	if ( run_start != NULL ) {
+		*num_new = *num_new + tailAppend_function ( tail, run_start, run_end );
+	}
+
+	return consumed;
+
+}
+
+/* Track header (name, otherData) from the text between <trk ...> and its first trkseg; an empty track if it is not complete yet */
+Track *tailTrack_function ( const char *start, const char *end ) {
+
+	Track *my_track = NULL;
+
+	if ( start != NULL && end != NULL && end >= start ) {
+
+		int header_len = end - start;
+		char *header = malloc ( header_len + 16 );
+		strcpy ( header, "<trk>" );
+		memcpy ( header + 5, start, header_len );
+		strcpy ( header + 5 + header_len, "</trk>" );
+
+		xmlDoc *header_doc = xmlReadMemory ( header, header_len + 11, NULL, NULL, XML_PARSE_NOERROR | XML_PARSE_NOWARNING );
+		free ( header );
+
+		if ( header_doc != NULL ) {
+			my_track = track_function ( xmlDocGetRootElement ( header_doc ) );
+			xmlFreeDoc ( header_doc );
+		}
+
+	}
+
+	if ( my_track == NULL ) {
+		my_track = ( Track *) malloc ( sizeof ( Track ) );
+		my_track->name = (char *) ( malloc ( 1 ) );
+		my_track->name[0] = '\0';
+		my_track->segments = initializeList ( &trackSegmentToString, &deleteTrackSegment, &compareTrackSegments );
+		my_track->otherData = initializeList ( &gpxDataToString, &deleteGpxData, &compareGpxData );
+	}
+
+	return my_track;
+
+}
+
+GPXTail *openGPXTail ( char* fileName ) {
+
+	if ( fileName == NULL || strcmp ( fileName, "" ) == 0 ) {
+		fprintf ( stderr, "File name cannot be an empty string or NULL.\n" );
+		return NULL;
+	}
+
+	FILE *fp = fopen ( fileName, "rb" );
+
+	if ( fp == NULL ) {
+		fprintf ( stderr, "Failed to open %s\n", fileName );
+		return NULL;
+	}
+
+	fseek ( fp, 0, SEEK_END );
+	long size = ftell ( fp );
+	fseek ( fp, 0, SEEK_SET );
+
+	char *buffer = malloc ( size + 1 );
+	size = fread ( buffer, 1, size, fp );
+	fclose ( fp );
+
+	const char *end = buffer + size;
+
+	LIBXML_TEST_VERSION
+
+	/* Only the last trk can still be growing; everything before it is complete and parses normally */
+	const char *last_trk = NULL;
+
+	for ( const char *trk = findTag ( buffer, end, "trk" ); trk != NULL; trk = findTag ( trk + 1, end, "trk" ) ) {
+		last_trk = trk;
+	}
+
+	const char *header_end = last_trk;
+
+	if ( header_end == NULL ) {
+		header_end = findTag ( buffer, end, "/gpx" );
+	}
+
+	if ( header_end == NULL ) {
+		header_end = end;
+	}
+
+	int header_len = header_end - buffer;
+	char *header = malloc ( header_len + 8 );
+	memcpy ( header, buffer, header_len );
+	strcpy ( header + header_len, "</gpx>" );
+
+	xmlDoc *doc = xmlReadMemory ( header, header_len + 6, NULL, NULL, XML_PARSE_NOERROR | XML_PARSE_NOWARNING | XML_PARSE_HUGE );
+
+	free ( header );
+
+	if ( doc == NULL || xmlDocGetRootElement ( doc ) == NULL ) {
+		fprintf ( stderr, "Failed to parse %s\n", fileName );
+		xmlFreeDoc ( doc );
+		free ( buffer );
+		return NULL;
+	}
+
+	xmlNode *root_element = xmlDocGetRootElement ( doc );
+	xmlNode *cur_node = NULL;
+
+	GPXdoc *my_doc = (GPXdoc *) malloc ( sizeof ( GPXdoc ) );
+
+	my_doc->waypoints = initializeList ( &waypointToString, &deleteWaypoint, &compareWaypoints );
+	my_doc->routes = initializeList ( &routeToString, &deleteRoute, &compareRoutes );
+	my_doc->tracks = initializeList ( &trackToString, &deleteTrack, &compareTracks );
+	my_doc->version = 1.1;
+	my_doc->namespace[0] = '\0';
+
+	if ( root_element->ns != NULL && root_element->ns->href != NULL ) {
+		strcpy ( my_doc->namespace, (char *)( root_element->ns->href ) );
+	}
+
+	xmlChar *creator = xmlGetProp ( root_element, BAD_CAST "creator" );
+	my_doc->creator = (char *) malloc ( ( creator == NULL ? 0 : strlen ( (char *)creator ) ) + 1 );
+	strcpy ( my_doc->creator, creator == NULL ? "" : (char *)creator );
+	xmlFree ( creator );
+
+	for ( cur_node = root_element->children; cur_node != NULL; cur_node = cur_node->next ) {
+
+		if ( cur_node->type != XML_ELEMENT_NODE ) {
+			continue;
+		}
+
+		if ( strcmp ( "wpt", (char *)(cur_node->name) ) == 0 ) {
+			insertBack ( my_doc->waypoints, waypoint_function ( cur_node ) );
+		}
+		else if ( strcmp ( "rte", (char *)(cur_node->name) ) == 0 ) {
+			insertBack ( my_doc->routes, route_function ( cur_node ) );
+		}
+		else if ( strcmp ( "trk", (char *)(cur_node->name) ) == 0 ) {
+			insertBack ( my_doc->tracks, track_function ( cur_node ) );
+		}
+
+	}
+
+	xmlFreeDoc ( doc );
+
+	/* The live track's header is parsed on its own; its points go through the same scan as a refresh */
+	const char *points_start = header_end;
+	Track *my_track = NULL;
+
+	if ( last_trk != NULL ) {
+
+		const char *trk_body = memchr ( last_trk, '>', end - last_trk );
+		const char *first_seg = trk_body == NULL ? NULL : findTag ( trk_body, end, "trkseg" );
+		const char *trk_close = trk_body == NULL ? NULL : findTag ( trk_body, end, "/trk" );
+
+		if ( first_seg == NULL || ( trk_close != NULL && trk_close < first_seg ) ) {
+			first_seg = trk_close;
+		}
+
+		my_track = tailTrack_function ( trk_body == NULL ? NULL : trk_body + 1, first_seg );
+
+		if ( first_seg != NULL ) {
+			points_start = first_seg;
+		}
+
+	} else {
+		my_track = tailTrack_function ( NULL, NULL );
+	}
+
+	insertBack ( my_doc->tracks, (void *) my_track );
+
+	GPXTail *tail = malloc ( sizeof ( GPXTail ) );
+
+	tail->fileName = malloc ( strlen ( fileName ) + 1 );
+	strcpy ( tail->fileName, fileName );
+	tail->doc = my_doc;
+	tail->track = my_track;
+	tail->length = 0;
+	tail->num_points = 0;
+	tail->last_point = NULL;
+
+	/* The snapshot holds exactly the points before offset, so a refresh never reads a point twice */
+	int num_points = 0;
+	const char *consumed = tailScan_function ( tail, points_start, end, &num_points );
+
+	tail->offset = consumed - buffer;
+
+	free ( buffer );
+
+	return tail;
+
+}
+
+int refreshGPXTail ( GPXTail *tail ) {
+
+	if ( tail == NULL ) {
+		return -1;
+	}
+
+	FILE *fp = fopen ( tail->fileName, "rb" );
+
+	if ( fp == NULL ) {
+		return -1;
+	}
+
+	fseek ( fp, 0, SEEK_END );
+	long size = ftell ( fp );
+
+	/* The file was truncated or replaced, the caller has to open it again */
+	if ( size < tail->offset ) {
+		fclose ( fp );
+		return -1;
+	}
+
+	if ( size == tail->offset ) {
+		fclose ( fp );
+		return 0;
+	}
+
+	long len = size - tail->offset;
+	char *buffer = malloc ( len + 1 );
+
+	fseek ( fp, tail->offset, SEEK_SET );
+	len = fread ( buffer, 1, len, fp );
+	fclose ( fp );
+
+	int num_new = 0;
+	const char *consumed = tailScan_function ( tail, buffer, buffer + len, &num_new );
+
+	tail->offset = tail->offset + ( consumed - buffer );
+
+	free ( buffer );
+
+	return num_new;
+
+}
+
+float getTailTrackLen ( const GPXTail *tail ) {
+
+	if ( tail == NULL ) {
+		return 0;
+	}
+
+	return tail->length;
+
+}
+
+void closeGPXTail ( GPXTail *tail ) {
+
+	if ( tail == NULL ) {
+		return;
+	}
+
+	deleteGPXdoc ( tail->doc );
+	free ( tail->fileName );
+	free ( tail );
+
+}
+
+int internSymbol ( const char *name ) {
+
+	if ( name == NULL ) {
+		return -1;
+	}
+
+	pthread_mutex_lock ( &(symbol_table.lock) );
+
+	if ( symbol_table.num_slots == 0 ) {
+		symbol_table.num_slots = 256;
+		symbol_table.slots = malloc ( sizeof ( int ) * symbol_table.num_slots );
+		for ( int i = 0; i < symbol_table.num_slots; i++ ) {
+			symbol_table.slots[i] = -1;
+		}
+	}
+
+	/* djb2 hash with linear probing, the table is kept under half full */
+	unsigned int hash = 5381;
+	for ( int i = 0; name[i] != '\0'; i++ ) {
+		hash = ( ( hash << 5 ) + hash ) + (unsigned char)name[i];
+	}
+
+	int slot = hash & ( symbol_table.num_slots - 1 );
+
+	while ( symbol_table.slots[slot] != -1 ) {
+
+		if ( strcmp ( symbol_table.names[symbol_table.slots[slot]], name ) == 0 ) {
+			int symbol = symbol_table.slots[slot];
+			pthread_mutex_unlock ( &(symbol_table.lock) );
+			return symbol;
+		}
+
+		slot = ( slot + 1 ) & ( symbol_table.num_slots - 1 );
+
+	}
+
+	if ( symbol_table.num_symbols == symbol_table.max_symbols ) {
+		symbol_table.max_symbols = symbol_table.max_symbols == 0 ? 64 : symbol_table.max_symbols * 2;
+		symbol_table.names = realloc ( symbol_table.names, sizeof ( char * ) * symbol_table.max_symbols );
+	}
+
+	int symbol = symbol_table.num_symbols;
+	symbol_table.names[symbol] = malloc ( strlen ( name ) + 1 );
+	strcpy ( symbol_table.names[symbol], name );
+	symbol_table.num_symbols = symbol_table.num_symbols + 1;
+	symbol_table.slots[slot] = symbol;
+
+	if ( symbol_table.num_symbols * 2 > symbol_table.num_slots ) {
+
+		int old_slots = symbol_table.num_slots;
+		int *old_table = symbol_table.slots;
+
+		symbol_table.num_slots = old_slots * 2;
+		symbol_table.slots = malloc ( sizeof ( int ) * symbol_table.num_slots );
+
+		for ( int i = 0; i < symbol_table.num_slots; i++ ) {
+			symbol_table.slots[i] = -1;
+		}
+
+		for ( int i = 0; i < old_slots; i++ ) {
+
+			if ( old_table[i] == -1 ) {
+				continue;
+			}
+
+			unsigned int rehash = 5381;
+			char *old_name = symbol_table.names[old_table[i]];
+			for ( int j = 0; old_name[j] != '\0'; j++ ) {
+				rehash = ( ( rehash << 5 ) + rehash ) + (unsigned char)old_name[j];
+			}
+
+			int new_slot = rehash & ( symbol_table.num_slots - 1 );
+			while ( symbol_table.slots[new_slot] != -1 ) {
+				new_slot = ( new_slot + 1 ) & ( symbol_table.num_slots - 1 );
+			}
+			symbol_table.slots[new_slot] = old_table[i];
+
+		}
+
+		free ( old_table );
+
+	}
+
+	pthread_mutex_unlock ( &(symbol_table.lock) );
+
+	return symbol;
+
+}
+
+const char *getSymbolName ( int symbol ) {
+
+	const char *name = NULL;
+
+	pthread_mutex_lock ( &(symbol_table.lock) );
+
+	if ( symbol >= 0 && symbol < symbol_table.num_symbols ) {
+		name = symbol_table.names[symbol];
+	}
+
+	pthread_mutex_unlock ( &(symbol_table.lock) );
+
+	return name;
+
+}
+
+GPXSymbolData *symbolData_function ( const char *name, const char *value ) {
+
+	if ( name == NULL || value == NULL ) {
+		return NULL;
+	}
+
+	GPXSymbolData *my_data = malloc ( sizeof ( GPXSymbolData ) + strlen ( value ) + 1 );
+
+	my_data->symbol = internSymbol ( name );
+	strcpy ( my_data->value, value );
+
+	return my_data;
+
+}
+
+void deleteSymbolData ( void* data ) {
+
+	if ( data == NULL ) {
+		return;
+	}
+
+	free ( data );
+
+}
+
+char* symbolDataToString ( void* data ) {
+
+	char* tmpStr;
+	GPXSymbolData* tmpName = (GPXSymbolData*)data;
+
+	if ( data == NULL ) {
+		tmpStr = (char*) malloc ( 1 );
+		tmpStr[0] = '\0';
+		return tmpStr;
+	}
+
+	const char *name = getSymbolName ( tmpName->symbol );
+
+	tmpStr = (char*) malloc ( strlen ( name ) + strlen ( tmpName->value ) + 100 );
+
+	sprintf ( tmpStr, "\t otherData:\n\t\t   Name: %s\n\t\t   Value: %s\n", name, tmpName->value );
+
+	return tmpStr;
+
+}
+
+int compareSymbolData ( const void *first, const void *second ) {
+
+	if ( first == NULL || second == NULL ) {
+		return 0;
+	}
+
+	return strcmp ( getSymbolName ( ((GPXSymbolData*)first)->symbol ), getSymbolName ( ((GPXSymbolData*)second)->symbol ) );
+
+}
+
+bool isSymbolList ( const List *otherData ) {
+
+	return otherData != NULL && ( otherData->deleteData == &deleteSymbolData || otherData->deleteData == &deletePackedData );
+
+}
+
+const char *gpxDataName ( const List *otherData, const void *data ) {
+
+	if ( data == NULL ) {
+		return NULL;
+	}
+
+	if ( isSymbolList ( otherData ) ) {
+		return getSymbolName ( ((GPXSymbolData*)data)->symbol );
+	}
+
+	return ((GPXData*)data)->name;
+
+}
+
+const char *gpxDataValue ( const List *otherData, const void *data ) {
+
+	if ( data == NULL ) {
+		return NULL;
+	}
+
+	if ( isSymbolList ( otherData ) ) {
+		return ((GPXSymbolData*)data)->value;
+	}
+
+	return ((GPXData*)data)->value;
+
+}
+
+List *internOtherData ( List *otherData ) {
+
+	List *my_list = initializeList ( &symbolDataToString, &deleteSymbolData, &compareSymbolData );
+
+	if ( otherData == NULL ) {
+		return my_list;
+	}
+
+	ListIterator data_iter = createIterator ( otherData );
+	void *my_data = nextElement ( &data_iter );
+
+	while ( my_data != NULL ) {
+		insertBack ( my_list, symbolData_function ( gpxDataName ( otherData, my_data ), gpxDataValue ( otherData, my_data ) ) );
+		my_data = nextElement ( &data_iter );
+	}
+
+	return my_list;
+
+}
+
+List *expandOtherData ( List *otherData ) {
+
+	List *my_list = initializeList ( &gpxDataToString, &deleteGpxData, &compareGpxData );
+
+	if ( otherData == NULL ) {
+		return my_list;
+	}
+
+	ListIterator data_iter = createIterator ( otherData );
+	void *my_data = nextElement ( &data_iter );
+
+	while ( my_data != NULL ) {
+
+		const char *value = gpxDataValue ( otherData, my_data );
+		GPXData *new_data = malloc ( sizeof ( GPXData ) + strlen ( value ) + 1 );
+		strcpy ( new_data->name, gpxDataName ( otherData, my_data ) );
+		strcpy ( new_data->value, value );
+		insertBack ( my_list, (void *)new_data );
+
+		my_data = nextElement ( &data_iter );
+
+	}
+
+	return my_list;
+
+}
+
+void waypointOtherData_function ( List *waypoints, List *(*convert)( List *otherData ) ) {
+
+	ListIterator point_iter = createIterator ( waypoints );
+	Waypoint *my_waypoint = nextElement ( &point_iter );
+
+	while ( my_waypoint != NULL ) {
+
+		List *old_data = my_waypoint->otherData;
+		my_waypoint->otherData = convert ( old_data );
+		freeList ( old_data );
+
+		my_waypoint = nextElement ( &point_iter );
+
+	}
+
+}
+
+void convertOtherData_function ( GPXdoc *doc, List *(*convert)( List *otherData ) ) {
+
+	if ( doc == NULL ) {
+		return;
+	}
+
+	waypointOtherData_function ( doc->waypoints, convert );
+
+	ListIterator route_iter = createIterator ( doc->routes );
+	Route *my_route = nextElement ( &route_iter );
+
+	while ( my_route != NULL ) {
+
+		List *old_data = my_route->otherData;
+		my_route->otherData = convert ( old_data );
+		freeList ( old_data );
+
+		waypointOtherData_function ( my_route->waypoints, convert );
+
+		my_route = nextElement ( &route_iter );
+
+	}
+
+	ListIterator track_iter = createIterator ( doc->tracks );
+	Track *my_track = nextElement ( &track_iter );
+
+	while ( my_track != NULL ) {
+
+		List *old_data = my_track->otherData;
+		my_track->otherData = convert ( old_data );
+		freeList ( old_data );
+
+		ListIterator segment_iter = createIterator ( my_track->segments );
+		TrackSegment *my_segment = nextElement ( &segment_iter );
+
+		while ( my_segment != NULL ) {
+			waypointOtherData_function ( my_segment->waypoints, convert );
+			my_segment = nextElement ( &segment_iter );
+		}
+
+		my_track = nextElement ( &track_iter );
+
+	}
+
+}
+
+void internGPXdoc ( GPXdoc *doc ) {
+
+	convertOtherData_function ( doc, &internOtherData );
+
+}
+
+void expandGPXdoc ( GPXdoc *doc ) {
+
+	convertOtherData_function ( doc, &expandOtherData );
+
+}
+
+void deletePackedData ( void* data ) {
+
+	/* Entries live inside the list's own allocation and go away with it */
+	(void) data;
+
+}
+
+List *packOtherData ( List *otherData ) {
+
+	int num_data = otherData == NULL ? 0 : getLength ( otherData );
+	size_t size = sizeof ( List ) + num_data * sizeof ( Node );
+
+	ListIterator data_iter = createIterator ( otherData );
+	void *my_data = NULL;
+
+	if ( otherData != NULL ) {
+		while ( (my_data = nextElement ( &data_iter )) != NULL ) {
+			size = size + ( ( sizeof ( GPXSymbolData ) + strlen ( gpxDataValue ( otherData, my_data ) ) + 1 + 3 ) & ~(size_t)3 );
+		}
+	}
+
+	/* One block: the List header, then every Node, then the symbol id + value records */
+	char *block = malloc ( size );
+	List *my_list = (List *) block;
+	Node *nodes = (Node *) ( block + sizeof ( List ) );
+	char *records = block + sizeof ( List ) + num_data * sizeof ( Node );
+
+	my_list->head = num_data == 0 ? NULL : &nodes[0];
+	my_list->tail = num_data == 0 ? NULL : &nodes[num_data - 1];
+	my_list->length = num_data;
+	my_list->deleteData = &deletePackedData;
+	my_list->compare = &compareSymbolData;
+	my_list->printData = &symbolDataToString;
+
+	if ( num_data == 0 ) {
+		return my_list;
+	}
+
+	data_iter = createIterator ( otherData );
+
+	for ( int i = 0; i < num_data; i++ ) {
+
+		my_data = nextElement ( &data_iter );
+
+		const char *value = gpxDataValue ( otherData, my_data );
+		GPXSymbolData *record = (GPXSymbolData *) records;
+
+		record->symbol = internSymbol ( gpxDataName ( otherData, my_data ) );
+		strcpy ( record->value, value );
+
+		nodes[i].data = record;
+		nodes[i].previous = i == 0 ? NULL : &nodes[i - 1];
+		nodes[i].next = i == num_data - 1 ? NULL : &nodes[i + 1];
+
+		records = records + ( ( sizeof ( GPXSymbolData ) + strlen ( value ) + 1 + 3 ) & ~(size_t)3 );
+
+	}
+
+	return my_list;
+
+}
+
+bool isPackedList ( const List *otherData ) {
+
+	return otherData != NULL && otherData->deleteData == &deletePackedData;
+
+}
+
+void packGPXdoc ( GPXdoc *doc ) {
+
+	convertOtherData_function ( doc, &packOtherData );
+
+}
+
+/* Heap footprint of one malloc call: an 8 byte chunk header rounded up to 16 bytes, 32 at least */
+size_t allocationBytes ( size_t size ) {
+
+	size_t bytes = ( size + 8 + 15 ) & ~(size_t)15;
+
+	return bytes < 32 ? 32 : bytes;
+
+}
+
+size_t otherDataBytes ( const List *otherData ) {
+
+	if ( otherData == NULL ) {
+		return 0;
+	}
+
+	if ( isPackedList ( otherData ) ) {
+
+		size_t size = sizeof ( List );
+
+		ListIterator data_iter = createIterator ( (List *)otherData );
+		void *my_data = NULL;
+
+		while ( (my_data = nextElement ( &data_iter )) != NULL ) {
+			size = size + sizeof ( Node ) + ( ( sizeof ( GPXSymbolData ) + strlen ( gpxDataValue ( otherData, my_data ) ) + 1 + 3 ) & ~(size_t)3 );
+		}
+
+		return allocationBytes ( size );
+
+	}
+
+	size_t bytes = allocationBytes ( sizeof ( List ) );
+
+	ListIterator data_iter = createIterator ( (List *)otherData );
+	void *my_data = NULL;
+
+	while ( (my_data = nextElement ( &data_iter )) != NULL ) {
+
+		size_t len = strlen ( gpxDataValue ( otherData, my_data ) ) + 1;
+
+		if ( isSymbolList ( otherData ) ) {
+			bytes = bytes + allocationBytes ( sizeof ( Node ) ) + allocationBytes ( sizeof ( GPXSymbolData ) + len );
+		}
+		else {
+			bytes = bytes + allocationBytes ( sizeof ( Node ) ) + allocationBytes ( sizeof ( GPXData ) + len );
+		}
+
+	}
+
+	return bytes;
+
+}
+
+void waypointBytes_function ( List *waypoints, size_t *bytes, int *num_points ) {
+
+	ListIterator point_iter = createIterator ( waypoints );
+	Waypoint *my_waypoint = nextElement ( &point_iter );
+
+	while ( my_waypoint != NULL ) {
+
+		*bytes = *bytes + otherDataBytes ( my_waypoint->otherData );
+		*num_points = *num_points + 1;
+
+		my_waypoint = nextElement ( &point_iter );
+
+	}
+
+}
+
+float otherDataBytesPerPoint ( const GPXdoc *doc ) {
+
+	if ( doc == NULL ) {
+		return 0;
+	}
+
+	size_t bytes = 0;
+	int num_points = 0;
+
+	waypointBytes_function ( doc->waypoints, &bytes, &num_points );
+
+	ListIterator route_iter = createIterator ( doc->routes );
+	Route *my_route = nextElement ( &route_iter );
+
+	while ( my_route != NULL ) {
+		waypointBytes_function ( my_route->waypoints, &bytes, &num_points );
+		my_route = nextElement ( &route_iter );
+	}
+
+	ListIterator track_iter = createIterator ( doc->tracks );
+	Track *my_track = nextElement ( &track_iter );
+
+	while ( my_track != NULL ) {
+
+		ListIterator segment_iter = createIterator ( my_track->segments );
+		TrackSegment *my_segment = nextElement ( &segment_iter );
+
+		while ( my_segment != NULL ) {
+			waypointBytes_function ( my_segment->waypoints, &bytes, &num_points );
+			my_segment = nextElement ( &segment_iter );
+		}
+
+		my_track = nextElement ( &track_iter );
+
+	}
+
+	if ( num_points == 0 ) {
+		return 0;
+	}
+
+	return (float) bytes / num_points;
+
+}
+
+char *otherDataMemoryReport ( char* fileName ) {
+
+	GPXdoc *my_doc = createGPXdoc ( fileName );
+
+	if ( my_doc == NULL ) {
+		return NULL;
+	}
+
+	char *report = malloc ( 256 );
+
+	float legacy = otherDataBytesPerPoint ( my_doc );
+	internGPXdoc ( my_doc );
+	float interned = otherDataBytesPerPoint ( my_doc );
+	packGPXdoc ( my_doc );
+	float packed = otherDataBytesPerPoint ( my_doc );
+
+	sprintf ( report, "{\"legacyBytesPerPoint\":%.1f,\"internedBytesPerPoint\":%.1f,\"packedBytesPerPoint\":%.1f}", legacy, interned, packed );
+
+	deleteGPXdoc ( my_doc );
+
+	return report;
+
+}
+
+int32_t toFixedCoordinate ( double degrees ) {
+
+	return (int32_t) lround ( degrees * FIXED_SCALE );
+
+}
+
+double fromFixedCoordinate ( int32_t fixed ) {
+
+	return (double) fixed / FIXED_SCALE;
+
+}
+
+FixedTrack *fixedTrack_function ( int num_points, int num_segments ) {
+
+	FixedTrack *my_fixed = malloc ( sizeof ( FixedTrack ) );
+
+	my_fixed->num_points = 0;
+	my_fixed->num_segments = 0;
+	my_fixed->segment_starts = malloc ( sizeof ( int ) * ( num_segments + 1 ) );
+	my_fixed->latitude = malloc ( sizeof ( int32_t ) * ( num_points + 1 ) );
+	my_fixed->longitude = malloc ( sizeof ( int32_t ) * ( num_points + 1 ) );
+
+	return my_fixed;
+
+}
+
+void fixedAppend_function ( FixedTrack *my_fixed, List *waypoints ) {
+
+	my_fixed->segment_starts[my_fixed->num_segments] = my_fixed->num_points;
+	my_fixed->num_segments = my_fixed->num_segments + 1;
+
+	ListIterator point_iter = createIterator ( waypoints );
+	Waypoint *my_waypoint = nextElement ( &point_iter );
+
+	while ( my_waypoint != NULL ) {
+
+		my_fixed->latitude[my_fixed->num_points] = toFixedCoordinate ( my_waypoint->latitude );
+		my_fixed->longitude[my_fixed->num_points] = toFixedCoordinate ( my_waypoint->longitude );
+		my_fixed->num_points = my_fixed->num_points + 1;
+
+		my_waypoint = nextElement ( &point_iter );
+
+	}
+
+}
+
+FixedTrack *trackToFixed ( const Track *tr ) {
+
+	if ( tr == NULL ) {
+		return NULL;
+	}
+
+	FixedTrack *my_fixed = fixedTrack_function ( getNumSegmentsWaypoints ( tr ), getLength ( tr->segments ) );
+
+	ListIterator segment_iter = createIterator ( tr->segments );
+	TrackSegment *my_segment = nextElement ( &segment_iter );
+
+	while ( my_segment != NULL ) {
+		fixedAppend_function ( my_fixed, my_segment->waypoints );
+		my_segment = nextElement ( &segment_iter );
+	}
+
+	return my_fixed;
+
+}
+
+FixedTrack *routeToFixed ( const Route *rt ) {
+
+	if ( rt == NULL ) {
+		return NULL;
+	}
+
+	FixedTrack *my_fixed = fixedTrack_function ( getLength ( rt->waypoints ), 1 );
+
+	fixedAppend_function ( my_fixed, rt->waypoints );
+
+	return my_fixed;
+
+}
+
+double getFixedLatitude ( const FixedTrack *ft, int i ) {
+
+	if ( ft == NULL || i < 0 || i >= ft->num_points ) {
+		return 0;
+	}
+
+	return fromFixedCoordinate ( ft->latitude[i] );
+
+}
+
+double getFixedLongitude ( const FixedTrack *ft, int i ) {
+
+	if ( ft == NULL || i < 0 || i >= ft->num_points ) {
+		return 0;
+	}
+
+	return fromFixedCoordinate ( ft->longitude[i] );
+
+}
+
+float getFixedTrackLen ( const FixedTrack *ft ) {
+
+	if ( ft == NULL || ft->num_points < 2 ) {
+		return 0;
+	}
+
+	float total_dist = 0;
+	float lat[FIXED_BLOCK + 1];
+	float lon[FIXED_BLOCK + 1];
+
+	/* Convert a block of int32 pairs to float degrees in one tight loop, then walk the hops.
+	   Going through double first rounds to the same float getTrackLen gets from the double fields.
+	   Segments are joined end to start the same way getTrackLen joins them */
+	for ( int start = 0; start < ft->num_points - 1; start = start + FIXED_BLOCK ) {
+
+		int count = ft->num_points - start;
+
+		if ( count > FIXED_BLOCK + 1 ) {
+			count = FIXED_BLOCK + 1;
+		}
+
+		for ( int i = 0; i < count; i++ ) {
+			lat[i] = (float) ( ft->latitude[start + i] * ( 1.0 / FIXED_SCALE ) );
+			lon[i] = (float) ( ft->longitude[start + i] * ( 1.0 / FIXED_SCALE ) );
+		}
+
+		for ( int i = 1; i < count; i++ ) {
+			total_dist = total_dist + distance_function ( lat[i - 1], lon[i - 1], lat[i], lon[i] );
+		}
+
+	}
+
+	total_dist = total_dist * 1000;
+
+	return total_dist;
+
+}
+
+bool isLoopFixedTrack ( const FixedTrack *ft, float delta ) {
+
+	if ( ft == NULL || delta < 0 || ft->num_points < 1 ) {
+		return false;
+	}
+
+	int last = ft->num_points - 1;
+
+	float total_dist = distance_function ( getFixedLatitude ( ft, 0 ), getFixedLongitude ( ft, 0 ), getFixedLatitude ( ft, last ), getFixedLongitude ( ft, last ) ) * 1000;
+
+	if ( total_dist >= 0 && total_dist <= delta ) {
+		return true;
+	}
+
+	return false;
+
+}
+
+Track *fixedToTrack ( const FixedTrack *ft, char *name ) {
+
+	if ( ft == NULL ) {
+		return NULL;
+	}
+
+	Track *my_track = ( Track *) malloc ( sizeof ( Track ) );
+
+	my_track->name = (char *) malloc ( ( name == NULL ? 0 : strlen ( name ) ) + 1 );
+	strcpy ( my_track->name, name == NULL ? "" : name );
+	my_track->segments = initializeList ( &trackSegmentToString, &deleteTrackSegment, &compareTrackSegments );
+	my_track->otherData = initializeList ( &gpxDataToString, &deleteGpxData, &compareGpxData );
+
+	for ( int s = 0; s < ft->num_segments; s++ ) {
+
+		int end = ( s == ft->num_segments - 1 ) ? ft->num_points : ft->segment_starts[s + 1];
+
+		TrackSegment *my_trackSegment = ( TrackSegment *) malloc ( sizeof ( TrackSegment ) );
+		my_trackSegment->waypoints = initializeList ( &waypointToString, &deleteWaypoint, &compareWaypoints );
+
+		for ( int i = ft->segment_starts[s]; i < end; i++ ) {
+
+			Waypoint *my_waypoint = ( Waypoint *) malloc ( sizeof ( Waypoint ) );
+			my_waypoint->name = (char *) malloc ( 1 );
+			my_waypoint->name[0] = '\0';
+			my_waypoint->latitude = getFixedLatitude ( ft, i );
+			my_waypoint->longitude = getFixedLongitude ( ft, i );
+			my_waypoint->otherData = initializeList ( &gpxDataToString, &deleteGpxData, &compareGpxData );
+
+			insertBack ( my_trackSegment->waypoints, (void *)my_waypoint );
+
+		}
+
+		insertBack ( my_track->segments, (void *)my_trackSegment );
+
+	}
+
+	return my_track;
+
+}
+
+void deleteFixedTrack ( FixedTrack *ft ) {
+
+	if ( ft == NULL ) {
+		return;
+	}
+
+	free ( ft->segment_starts );
+	free ( ft->latitude );
+	free ( ft->longitude );
+	free ( ft );
+
+}
+
+void varintWrite_function ( CompressedTrack *ct, int64_t delta ) {
+
+	/* zigzag so small negative steps stay small, then 7 bits per byte */
+	uint64_t value = ( (uint64_t) delta << 1 ) ^ (uint64_t) ( delta >> 63 );
+
+	if ( ct->size + 10 > ct->capacity ) {
+		ct->capacity = ct->capacity * 2 + 16;
+		ct->data = realloc ( ct->data, ct->capacity );
+	}
+
+	while ( value >= 0x80 ) {
+		ct->data[ct->size] = (unsigned char) ( value | 0x80 );
+		ct->size = ct->size + 1;
+		value = value >> 7;
+	}
+
+	ct->data[ct->size] = (unsigned char) value;
+	ct->size = ct->size + 1;
+
+}
+
+int64_t varintRead_function ( const unsigned char **cursor ) {
+
+	const unsigned char *pos = *cursor;
+	uint64_t value = 0;
+	int shift = 0;
+
+	while ( *pos & 0x80 ) {
+		value = value | ( (uint64_t) ( *pos & 0x7f ) << shift );
+		shift = shift + 7;
+		pos = pos + 1;
+	}
+
+	value = value | ( (uint64_t) *pos << shift );
+	*cursor = pos + 1;
+
+	return (int64_t) ( value >> 1 ) ^ -(int64_t) ( value & 1 );
+
+}
+
+CompressedTrack *fixedToCompressed ( const FixedTrack *ft ) {
+
+	if ( ft == NULL ) {
+		return NULL;
+	}
+
+	CompressedTrack *ct = malloc ( sizeof ( CompressedTrack ) );
+
+	ct->num_points = ft->num_points;
+	ct->num_segments = ft->num_segments;
+	ct->segment_starts = malloc ( sizeof ( int ) * ( ft->num_segments + 1 ) );
+	memcpy ( ct->segment_starts, ft->segment_starts, sizeof ( int ) * ft->num_segments );
+	ct->capacity = ft->num_points * 3 + 16;
+	ct->size = 0;
+	ct->data = malloc ( ct->capacity );
+
+	int32_t prev_lat = 0;
+	int32_t prev_lon = 0;
+
+	for ( int i = 0; i < ft->num_points; i++ ) {
+
+		varintWrite_function ( ct, (int64_t) ft->latitude[i] - prev_lat );
+		varintWrite_function ( ct, (int64_t) ft->longitude[i] - prev_lon );
+
+		prev_lat = ft->latitude[i];
+		prev_lon = ft->longitude[i];
+
+	}
+
+	/* Keep the end points so loop checks do not need a full decode */
+	ct->first_lat = ft->num_points > 0 ? ft->latitude[0] : 0;
+	ct->first_lon = ft->num_points > 0 ? ft->longitude[0] : 0;
+	ct->last_lat = prev_lat;
+	ct->last_lon = prev_lon;
+
+	ct->data = realloc ( ct->data, ct->size + 1 );
+	ct->capacity = ct->size + 1;
+
+	return ct;
+
+}
+
+CompressedTrack *compressTrack ( const Track *tr ) {
+
+	FixedTrack *ft = trackToFixed ( tr );
+	CompressedTrack *ct = fixedToCompressed ( ft );
+
+	deleteFixedTrack ( ft );
+
+	return ct;
+
+}
+
+CompressedTrack *compressRoute ( const Route *rt ) {
+
+	FixedTrack *ft = routeToFixed ( rt );
+	CompressedTrack *ct = fixedToCompressed ( ft );
+
+	deleteFixedTrack ( ft );
+
+	return ct;
+
+}
+
+FixedTrack *compressedToFixed ( const CompressedTrack *ct ) {
+
+	if ( ct == NULL ) {
+		return NULL;
+	}
+
+	FixedTrack *ft = fixedTrack_function ( ct->num_points, ct->num_segments );
+
+	memcpy ( ft->segment_starts, ct->segment_starts, sizeof ( int ) * ct->num_segments );
+	ft->num_segments = ct->num_segments;
+	ft->num_points = ct->num_points;
+
+	const unsigned char *cursor = ct->data;
+	int32_t lat = 0;
+	int32_t lon = 0;
+
+	for ( int i = 0; i < ct->num_points; i++ ) {
+		lat = lat + (int32_t) varintRead_function ( &cursor );
+		lon = lon + (int32_t) varintRead_function ( &cursor );
+		ft->latitude[i] = lat;
+		ft->longitude[i] = lon;
+	}
+
+	return ft;
+
+}
+
+float getCompressedTrackLen ( const CompressedTrack *ct ) {
+
+	if ( ct == NULL || ct->num_points < 2 ) {
+		return 0;
+	}
+
+	float total_dist = 0;
+
+	const unsigned char *cursor = ct->data;
+	int32_t lat = (int32_t) varintRead_function ( &cursor );
+	int32_t lon = (int32_t) varintRead_function ( &cursor );
+	float p1x = (float) fromFixedCoordinate ( lat );
+	float p1y = (float) fromFixedCoordinate ( lon );
+
+	/* Decode one point at a time straight into the distance formula, no Waypoints are built */
+	for ( int i = 1; i < ct->num_points; i++ ) {
+
+		lat = lat + (int32_t) varintRead_function ( &cursor );
+		lon = lon + (int32_t) varintRead_function ( &cursor );
+
+		float p2x = (float) fromFixedCoordinate ( lat );
+		float p2y = (float) fromFixedCoordinate ( lon );
+
+		total_dist = total_dist + distance_function ( p1x, p1y, p2x, p2y );
+
+		p1x = p2x;
+		p1y = p2y;
+
+	}
+
+	total_dist = total_dist * 1000;
+
+	return total_dist;
+
+}
+
+bool isLoopCompressedTrack ( const CompressedTrack *ct, float delta ) {
+
+	if ( ct == NULL || delta < 0 || ct->num_points < 1 ) {
+		return false;
+	}
+
+	float total_dist = distance_function ( fromFixedCoordinate ( ct->first_lat ), fromFixedCoordinate ( ct->first_lon ), fromFixedCoordinate ( ct->last_lat ), fromFixedCoordinate ( ct->last_lon ) ) * 1000;
+
+	if ( total_dist >= 0 && total_dist <= delta ) {
+		return true;
+	}
+
+	return false;
+
+}
+
+size_t compressedTrackBytes ( const CompressedTrack *ct ) {
+
+	if ( ct == NULL ) {
+		return 0;
+	}
+
+	return sizeof ( CompressedTrack ) + ct->capacity + sizeof ( int ) * ( ct->num_segments + 1 );
+
+}
+
+void deleteCompressedTrack ( CompressedTrack *ct ) {
+
+	if ( ct == NULL ) {
+		return;
+	}
+
+	free ( ct->segment_starts );
+	free ( ct->data );
+	free ( ct );
+
+}
+
+PointArray *pointArray_function ( int capacity ) {
+
+	PointArray *my_points = malloc ( sizeof ( PointArray ) );
+
+	my_points->length = 0;
+	my_points->capacity = capacity < 16 ? 16 : capacity;
+	my_points->latitude = malloc ( sizeof ( double ) * my_points->capacity );
+	my_points->longitude = malloc ( sizeof ( double ) * my_points->capacity );
+
+	return my_points;
+
+}
+
+void addPoint ( PointArray *points, double latitude, double longitude ) {
+
+	if ( points == NULL ) {
+		return;
+	}
+
+	if ( points->length == points->capacity ) {
+		points->capacity = points->capacity * 2;
+		points->latitude = realloc ( points->latitude, sizeof ( double ) * points->capacity );
+		points->longitude = realloc ( points->longitude, sizeof ( double ) * points->capacity );
+	}
+
+	points->latitude[points->length] = latitude;
+	points->longitude[points->length] = longitude;
+	points->length = points->length + 1;
+
+}
+
+void pointArrayAppend_function ( PointArray *points, List *waypoints ) {
+
+	ListIterator point_iter = createIterator ( waypoints );
+	Waypoint *my_waypoint = nextElement ( &point_iter );
+
+	while ( my_waypoint != NULL ) {
+		addPoint ( points, my_waypoint->latitude, my_waypoint->longitude );
+		my_waypoint = nextElement ( &point_iter );
+	}
+
+}
+
+PointArray *trackToPointArray ( const Track *tr ) {
+
+	if ( tr == NULL ) {
+		return NULL;
+	}
+
+	PointArray *my_points = pointArray_function ( getNumSegmentsWaypoints ( tr ) );
+
+	ListIterator segment_iter = createIterator ( tr->segments );
+	TrackSegment *my_segment = nextElement ( &segment_iter );
+
+	while ( my_segment != NULL ) {
+		pointArrayAppend_function ( my_points, my_segment->waypoints );
+		my_segment = nextElement ( &segment_iter );
+	}
+
+	return my_points;
+
+}
+
+PointArray *routeToPointArray ( const Route *rt ) {
+
+	if ( rt == NULL ) {
+		return NULL;
+	}
+
+	PointArray *my_points = pointArray_function ( getLength ( rt->waypoints ) );
+
+	pointArrayAppend_function ( my_points, rt->waypoints );
+
+	return my_points;
+
+}
+
+void deletePointArray ( PointArray *points ) {
+
+	if ( points == NULL ) {
+		return;
+	}
+
+	free ( points->latitude );
+	free ( points->longitude );
+	free ( points );
+
+}
+
+char *pointArrayToJSON ( const PointArray *points ) {
+
+	if ( points == NULL ) {
+		char *tmpStr = malloc ( 3 );
+		strcpy ( tmpStr, "[]" );
+		return tmpStr;
+	}
+
+	char *tmpStr = malloc ( points->length * 50 + 3 );
+	int len = 0;
+
+	tmpStr[len++] = '[';
+
+	for ( int i = 0; i < points->length; i++ ) {
+		len = len + sprintf ( tmpStr + len, "%s{\"lat\":%.7f,\"lon\":%.7f}", i == 0 ? "" : ",", points->latitude[i], points->longitude[i] );
+	}
+
+	tmpStr[len++] = ']';
+	tmpStr[len] = '\0';
+
+	return tmpStr;
+
+}
+
+/* Distance in metres from p to the segment a-b on a local flat projection around a */
+double segmentDistance_function ( double px, double py, double ax, double ay, double bx, double by ) {
+
+	double scale = cos ( ax * ( 3.1415926536 / 180 ) );
+
+	double x = ( py - ay ) * scale;
+	double y = px - ax;
+	double sx = ( by - ay ) * scale;
+	double sy = bx - ax;
+
+	double seg_len = sx * sx + sy * sy;
+	double t = 0;
+
+	if ( seg_len > 0 ) {
+		t = ( x * sx + y * sy ) / seg_len;
+		t = t < 0 ? 0 : ( t > 1 ? 1 : t );
+	}
+
+	double dx = x - t * sx;
+	double dy = y - t * sy;
+
+	return sqrt ( dx * dx + dy * dy ) * ( 3.1415926536 / 180 ) * 6371000;
+
+}
+
+LevelOfDetail *buildLevelOfDetail ( const PointArray *points ) {
+
+	if ( points == NULL ) {
+		return NULL;
+	}
+
+	int n = points->length;
+	LevelOfDetail *lod = malloc ( sizeof ( LevelOfDetail ) );
+
+	lod->points = points;
+	lod->importance = malloc ( sizeof ( float ) * ( n + 1 ) );
+
+	for ( int i = 0; i < n; i++ ) {
+		lod->importance[i] = 0;
+	}
+
+	if ( n > 0 ) {
+		lod->importance[0] = HUGE_VALF;
+		lod->importance[n - 1] = HUGE_VALF;
+	}
+
+	/* One Douglas-Peucker pass with an explicit stack. Each point records the largest tolerance
+	   that still keeps it, capped by its parent's, so every tolerance level falls out of one run */
+	int *stack = malloc ( sizeof ( int ) * 2 * ( n + 1 ) );
+	float *stack_tol = malloc ( sizeof ( float ) * ( n + 1 ) );
+	int top = 0;
+
+	if ( n > 2 ) {
+		stack[0] = 0;
+		stack[1] = n - 1;
+		stack_tol[0] = HUGE_VALF;
+		top = 1;
+	}
+
+	while ( top > 0 ) {
+
+		top = top - 1;
+		int first = stack[top * 2];
+		int last = stack[top * 2 + 1];
+		float parent_tol = stack_tol[top];
+
+		if ( last - first < 2 ) {
+			continue;
+		}
+
+		double max_dist = -1;
+		int max_index = first + 1;
+
+		for ( int i = first + 1; i < last; i++ ) {
+
+			double dist = segmentDistance_function ( points->latitude[i], points->longitude[i], points->latitude[first], points->longitude[first], points->latitude[last], points->longitude[last] );
+
+			if ( dist > max_dist ) {
+				max_dist = dist;
+				max_index = i;
+			}
+
+		}
+
+		float tol = max_dist < parent_tol ? (float) max_dist : parent_tol;
+		lod->importance[max_index] = tol;
+
+		/* Nothing finer than LOD_FLOOR is ever asked for, so the whole span shares its bound */
+		if ( max_dist < LOD_FLOOR ) {
+			for ( int i = first + 1; i < last; i++ ) {
+				lod->importance[i] = tol;
+			}
+			continue;
+		}
+
+		stack[top * 2] = first;
+		stack[top * 2 + 1] = max_index;
+		stack_tol[top] = tol;
+		top = top + 1;
+
+		stack[top * 2] = max_index;
+		stack[top * 2 + 1] = last;
+		stack_tol[top] = tol;
+		top = top + 1;
+
+	}
+
+	free ( stack );
+	free ( stack_tol );
+
+	/* Cache the index list of every standard level */
+	const float tolerances[LOD_LEVELS] = LOD_TOLERANCES;
+
+	for ( int level = 0; level < LOD_LEVELS; level++ ) {
+
+		lod->tolerance[level] = tolerances[level];
+		lod->level_length[level] = 0;
+		lod->level[level] = malloc ( sizeof ( int ) * ( n + 1 ) );
+
+		for ( int i = 0; i < n; i++ ) {
+			if ( lod->importance[i] > tolerances[level] ) {
+				lod->level[level][lod->level_length[level]] = i;
+				lod->level_length[level] = lod->level_length[level] + 1;
+			}
+		}
+
+		lod->level[level] = realloc ( lod->level[level], sizeof ( int ) * ( lod->level_length[level] + 1 ) );
+
+	}
+
+	return lod;
+
+}
+
+PointArray *getLevelOfDetail ( const LevelOfDetail *lod, float tolerance ) {
+
+	if ( lod == NULL ) {
+		return NULL;
+	}
+
+	/* Coarsest cached level that is still at least as detailed as asked for */
+	int level = -1;
+
+	for ( int i = 0; i < LOD_LEVELS; i++ ) {
+		if ( lod->tolerance[i] <= tolerance ) {
+			level = i;
+		}
+	}
+
+	PointArray *my_points = NULL;
+
+	if ( level == -1 ) {
+
+		my_points = pointArray_function ( lod->points->length );
+
+		for ( int i = 0; i < lod->points->length; i++ ) {
+			if ( lod->importance[i] > tolerance ) {
+				addPoint ( my_points, lod->points->latitude[i], lod->points->longitude[i] );
+			}
+		}
+
+		return my_points;
+
+	}
+
+	my_points = pointArray_function ( lod->level_length[level] );
+
+	for ( int i = 0; i < lod->level_length[level]; i++ ) {
+		int index = lod->level[level][i];
+		addPoint ( my_points, lod->points->latitude[index], lod->points->longitude[index] );
+	}
+
+	return my_points;
+
+}
+
+void deleteLevelOfDetail ( LevelOfDetail *lod ) {
+
+	if ( lod == NULL ) {
+		return;
+	}
+
+	for ( int i = 0; i < LOD_LEVELS; i++ ) {
+		free ( lod->level[i] );
+	}
+
+	free ( lod->importance );
+	deletePointArray ( (PointArray *)lod->points );
+	free ( lod );
+
+}
+
+DocumentLOD *buildDocumentLOD ( const GPXdoc *doc ) {
+
+	if ( doc == NULL ) {
+		return NULL;
+	}
+
+	DocumentLOD *my_lod = malloc ( sizeof ( DocumentLOD ) );
+
+	my_lod->num_routes = getNumRoutes ( doc );
+	my_lod->routes = malloc ( sizeof ( Route * ) * ( my_lod->num_routes + 1 ) );
+	my_lod->route_lods = malloc ( sizeof ( LevelOfDetail * ) * ( my_lod->num_routes + 1 ) );
+
+	ListIterator route_iter = createIterator ( doc->routes );
+	for ( int i = 0; i < my_lod->num_routes; i++ ) {
+		my_lod->routes[i] = nextElement ( &route_iter );
+		my_lod->route_lods[i] = buildLevelOfDetail ( routeToPointArray ( my_lod->routes[i] ) );
+	}
+
+	my_lod->num_tracks = getNumTracks ( doc );
+	my_lod->tracks = malloc ( sizeof ( Track * ) * ( my_lod->num_tracks + 1 ) );
+	my_lod->track_lods = malloc ( sizeof ( LevelOfDetail * ) * ( my_lod->num_tracks + 1 ) );
+
+	ListIterator track_iter = createIterator ( doc->tracks );
+	for ( int i = 0; i < my_lod->num_tracks; i++ ) {
+		my_lod->tracks[i] = nextElement ( &track_iter );
+		my_lod->track_lods[i] = buildLevelOfDetail ( trackToPointArray ( my_lod->tracks[i] ) );
+	}
+
+	return my_lod;
+
+}
+
+PointArray *getRouteLOD ( const DocumentLOD *lod, const Route *rt, float tolerance ) {
+
+	if ( lod == NULL || rt == NULL ) {
+		return NULL;
+	}
+
+	for ( int i = 0; i < lod->num_routes; i++ ) {
+		if ( lod->routes[i] == rt ) {
+			return getLevelOfDetail ( lod->route_lods[i], tolerance );
+		}
+	}
+
+	return NULL;
+
+}
+
+PointArray *getTrackLOD ( const DocumentLOD *lod, const Track *tr, float tolerance ) {
+
+	if ( lod == NULL || tr == NULL ) {
+		return NULL;
+	}
+
+	for ( int i = 0; i < lod->num_tracks; i++ ) {
+		if ( lod->tracks[i] == tr ) {
+			return getLevelOfDetail ( lod->track_lods[i], tolerance );
+		}
+	}
+
+	return NULL;
+
+}
+
+void deleteDocumentLOD ( DocumentLOD *lod ) {
+
+	if ( lod == NULL ) {
+		return;
+	}
+
+	for ( int i = 0; i < lod->num_routes; i++ ) {
+		deleteLevelOfDetail ( lod->route_lods[i] );
+	}
+
+	for ( int i = 0; i < lod->num_tracks; i++ ) {
+		deleteLevelOfDetail ( lod->track_lods[i] );
+	}
+
+	free ( lod->routes );
+	free ( lod->route_lods );
+	free ( lod->tracks );
+	free ( lod->track_lods );
+	free ( lod );
+
+}
+
+/* "Route 2" / "Track 1" labels are the 1 based names the web tables use */
+PointArray *componentPoints_function ( const GPXdoc *doc, const char *componentName ) {
+
+	if ( doc == NULL || componentName == NULL || strlen ( componentName ) < 7 ) {
+		return NULL;
+	}
+
+	int value = atoi ( componentName + 6 );
+
+	if ( strncmp ( componentName, "Route", 5 ) == 0 ) {
+
+		ListIterator route_iter = createIterator ( doc->routes );
+		Route *my_route = nextElement ( &route_iter );
+
+		for ( int i = 1; i < value && my_route != NULL; i++ ) {
+			my_route = nextElement ( &route_iter );
+		}
+
+		return routeToPointArray ( my_route );
+
+	}
+
+	ListIterator track_iter = createIterator ( doc->tracks );
+	Track *my_track = nextElement ( &track_iter );
+
+	for ( int i = 1; i < value && my_track != NULL; i++ ) {
+		my_track = nextElement ( &track_iter );
+	}
+
+	return trackToPointArray ( my_track );
+
+}
+
+void *buildLODIndex_function ( const GPXdoc *doc ) {
+
+	return buildDocumentLOD ( doc );
+
+}
+
+void deleteLODIndex_function ( void *index ) {
+
+	deleteDocumentLOD ( index );
+
+}
+
+/* Index built over fileName by cache->build, reused until the file changes; NULL if the file is not valid. Call with cache->lock held */
+void *cachedFileIndex ( FileCache *cache, char *fileName, char *gpxSchemaFile ) {
+
+	char *key = routeGraphKey ( fileName, gpxSchemaFile );
+	FileCacheSlot *my_slot = NULL;
+
+	for ( int i = 0; i < FILE_CACHE_SLOTS; i++ ) {
+
+		if ( cache->slots[i].key != NULL && strcmp ( cache->slots[i].key, key ) == 0 ) {
+			free ( key );
+			return cache->slots[i].index;
+		}
+
+		/* A changed file replaces its own stale slot */
+		if ( my_slot == NULL && cache->slots[i].fileName != NULL && strcmp ( cache->slots[i].fileName, fileName ) == 0 ) {
+			my_slot = &cache->slots[i];
+		}
+
+	}
+
+	GPXdoc *my_doc = createValidGPXdoc ( fileName, gpxSchemaFile );
+
+	if ( my_doc == NULL ) {
+		free ( key );
+		return NULL;
+	}
+
+	if ( my_slot == NULL ) {
+		my_slot = &cache->slots[cache->next_slot];
+		cache->next_slot = ( cache->next_slot + 1 ) % FILE_CACHE_SLOTS;
+	}
+
+	if ( my_slot->index != NULL ) {
+		cache->destroy ( my_slot->index );
+	}
+
+	deleteGPXdoc ( my_slot->doc );
+	free ( my_slot->fileName );
+	free ( my_slot->key );
+
+	my_slot->key = key;
+	my_slot->fileName = malloc ( strlen ( fileName ) + 1 );
+	strcpy ( my_slot->fileName, fileName );
+	my_slot->doc = my_doc;
+	my_slot->index = cache->build ( my_doc );
+
+	return my_slot->index;
+
+}
+
+/* Cached levels of the "Route n" / "Track n" component, or NULL */
+const LevelOfDetail *componentLOD_function ( const DocumentLOD *lod, const char *componentName ) {
+
+	if ( lod == NULL || componentName == NULL || strlen ( componentName ) < 7 ) {
+		return NULL;
+	}
+
+	int value = atoi ( componentName + 6 );
+
+	if ( strncmp ( componentName, "Route", 5 ) == 0 ) {
+		return ( value >= 1 && value <= lod->num_routes ) ? lod->route_lods[value - 1] : NULL;
+	}
+
+	return ( value >= 1 && value <= lod->num_tracks ) ? lod->track_lods[value - 1] : NULL;
+
+}
+
+/* Every level of every component is computed once per version of the file and then only read */
+char *getSimplifiedPoints ( char* fileName, char* gpxSchemaFile, char* componentName, float tolerance ) {
+
+	if ( fileName == NULL || gpxSchemaFile == NULL ) {
+		return NULL;
+	}
+
+	pthread_mutex_lock ( &lod_cache.lock );
+
+	DocumentLOD *lod = cachedFileIndex ( &lod_cache, fileName, gpxSchemaFile );
+
+	if ( lod == NULL ) {
+		pthread_mutex_unlock ( &lod_cache.lock );
+		return NULL;
+	}
+
+	PointArray *my_points = getLevelOfDetail ( componentLOD_function ( lod, componentName ), tolerance );
+
+	pthread_mutex_unlock ( &lod_cache.lock );
+
+	char *JSON_return = pointArrayToJSON ( my_points );
+
+	deletePointArray ( my_points );
+
+	return JSON_return;
+
+}
+
+/* Points every interval metres along the polyline, measured with the getTrackLen distance, plus the last point */
+PointArray *resamplePoints ( const PointArray *points, float interval ) {
+
+	if ( points == NULL || interval <= 0 ) {
+		return NULL;
+	}
+
+	PointArray *my_points = pointArray_function ( 16 );
+
+	if ( points->length == 0 ) {
+		return my_points;
+	}
+
+	addPoint ( my_points, points->latitude[0], points->longitude[0] );
+
+	double travelled = 0;
+	double next = interval;
+
+	for ( int i = 1; i < points->length; i++ ) {
+
+		double dist = distance_function ( points->latitude[i - 1], points->longitude[i - 1], points->latitude[i], points->longitude[i] ) * 1000;
+
+		while ( dist > 0 && next <= travelled + dist ) {
+
+			double t = ( next - travelled ) / dist;
+
+			addPoint ( my_points, points->latitude[i - 1] + ( points->latitude[i] - points->latitude[i - 1] ) * t, points->longitude[i - 1] + ( points->longitude[i] - points->longitude[i - 1] ) * t );
+			next = next + interval;
+
+		}
+
+		travelled = travelled + dist;
+
+	}
+
+	/* Keep the true end unless a sample already landed on it */
+	if ( next - interval < travelled ) {
+		addPoint ( my_points, points->latitude[points->length - 1], points->longitude[points->length - 1] );
+	}
+
+	return my_points;
+
+}
+
+PointArray *resampleTrack ( const Track *tr, float interval ) {
+
+	PointArray *my_points = trackToPointArray ( tr );
+	PointArray *resampled = resamplePoints ( my_points, interval );
+
+	deletePointArray ( my_points );
+
+	return resampled;
+
+}
+
+PointArray *resampleRoute ( const Route *rt, float interval ) {
+
+	PointArray *my_points = routeToPointArray ( rt );
+	PointArray *resampled = resamplePoints ( my_points, interval );
+
+	deletePointArray ( my_points );
+
+	return resampled;
+
+}
+
+/* New waypoint list holding the resampled points, unnamed and without otherData */
+List *resampleWaypoints_function ( List *waypoints, float interval ) {
+
+	PointArray *my_points = pointArray_function ( getLength ( waypoints ) );
+	pointArrayAppend_function ( my_points, waypoints );
+
+	PointArray *resampled = resamplePoints ( my_points, interval );
+	deletePointArray ( my_points );
+
+	List *my_list = initializeList ( &waypointToString, &deleteWaypoint, &compareWaypoints );
+
+	for ( int i = 0; resampled != NULL && i < resampled->length; i++ ) {
+
+		Waypoint *my_waypoint = malloc ( sizeof ( Waypoint ) );
+
+		my_waypoint->name = malloc ( 1 );
+		my_waypoint->name[0] = '\0';
+		my_waypoint->latitude = resampled->latitude[i];
+		my_waypoint->longitude = resampled->longitude[i];
+		my_waypoint->otherData = initializeList ( &gpxDataToString, &deleteGpxData, &compareGpxData );
+
+		insertBack ( my_list, my_waypoint );
+
+	}
+
+	deletePointArray ( resampled );
+
+	return my_list;
+
+}
+
+/* Writes doc with every route and track segment resampled, leaving doc itself unchanged */
+bool writeResampledGPXdoc ( GPXdoc* doc, char* fileName, float interval ) {
+
+	if ( doc == NULL || fileName == NULL || interval <= 0 ) {
+		return false;
+	}
+
+	int num_lists = getNumRoutes ( doc ) + getNumSegments ( doc );
+	List **originals = malloc ( sizeof ( List * ) * ( num_lists + 1 ) );
+	int count = 0;
+
+	ListIterator route_iter = createIterator ( doc->routes );
+	Route *my_route = nextElement ( &route_iter );
+
+	while ( my_route != NULL ) {
+		originals[count++] = my_route->waypoints;
+		my_route->waypoints = resampleWaypoints_function ( my_route->waypoints, interval );
+		my_route = nextElement ( &route_iter );
+	}
+
+	ListIterator track_iter = createIterator ( doc->tracks );
+	Track *my_track = nextElement ( &track_iter );
+
+	while ( my_track != NULL ) {
+
+		ListIterator segment_iter = createIterator ( my_track->segments );
+		TrackSegment *my_segment = nextElement ( &segment_iter );
+
+		while ( my_segment != NULL ) {
+			originals[count++] = my_segment->waypoints;
+			my_segment->waypoints = resampleWaypoints_function ( my_segment->waypoints, interval );
+			my_segment = nextElement ( &segment_iter );
+		}
+
+		my_track = nextElement ( &track_iter );
+
+	}
+
+	bool written = writeGPXdoc ( doc, fileName );
+
+	/* Put the original lists back in the same order they were swapped out */
+	count = 0;
+
+	route_iter = createIterator ( doc->routes );
+	my_route = nextElement ( &route_iter );
+
+	while ( my_route != NULL ) {
+		freeList ( my_route->waypoints );
+		my_route->waypoints = originals[count++];
+		my_route = nextElement ( &route_iter );
+	}
+
+	track_iter = createIterator ( doc->tracks );
+	my_track = nextElement ( &track_iter );
+
+	while ( my_track != NULL ) {
+
+		ListIterator segment_iter = createIterator ( my_track->segments );
+		TrackSegment *my_segment = nextElement ( &segment_iter );
+
+		while ( my_segment != NULL ) {
+			freeList ( my_segment->waypoints );
+			my_segment->waypoints = originals[count++];
+			my_segment = nextElement ( &segment_iter );
+		}
+
+		my_track = nextElement ( &track_iter );
+
+	}
+
+	free ( originals );
+
+	return written;
+
+}
+
+char *getResampledPoints ( char* fileName, char* gpxSchemaFile, char* componentName, float interval ) {
+
+	GPXdoc *my_doc = createValidGPXdoc ( fileName, gpxSchemaFile );
+
+	if ( my_doc == NULL ) {
+		return NULL;
+	}
+
+	PointArray *my_points = componentPoints_function ( my_doc, componentName );
+	PointArray *resampled = resamplePoints ( my_points, interval );
+
+	char *JSON_return = pointArrayToJSON ( resampled );
+
+	deletePointArray ( resampled );
+	deletePointArray ( my_points );
+	deleteGPXdoc ( my_doc );
+
+	return JSON_return;
+
+}
+
+void boxInclude_function ( BoundingBox *box, double latitude, double longitude ) {
+
+	if ( latitude < box->min_lat ) {
+		box->min_lat = latitude;
+	}
+	if ( latitude > box->max_lat ) {
+		box->max_lat = latitude;
+	}
+	if ( longitude < box->min_lon ) {
+		box->min_lon = longitude;
+	}
+	if ( longitude > box->max_lon ) {
+		box->max_lon = longitude;
+	}
+
+}
+
+bool boxOverlap_function ( const BoundingBox *a, const BoundingBox *b ) {
+
+	return a->min_lat <= b->max_lat && a->max_lat >= b->min_lat && a->min_lon <= b->max_lon && a->max_lon >= b->min_lon;
+
+}
+
+bool boxContains_function ( const BoundingBox *box, double latitude, double longitude ) {
+
+	return latitude >= box->min_lat && latitude <= box->max_lat && longitude >= box->min_lon && longitude <= box->max_lon;
+
+}
+
+SpatialIndex *spatialIndex_function ( void ) {
+
+	SpatialIndex *my_index = malloc ( sizeof ( SpatialIndex ) );
+
+	my_index->points = pointArray_function ( 1024 );
+
+	my_index->num_segments = 0;
+	my_index->segment_capacity = 64;
+	my_index->segments = malloc ( sizeof ( SpatialSegment ) * my_index->segment_capacity );
+
+	my_index->num_chunks = 0;
+	my_index->chunk_capacity = 256;
+	my_index->chunks = malloc ( sizeof ( BoundingBox ) * my_index->chunk_capacity );
+
+	my_index->num_components = 0;
+	my_index->component_capacity = 64;
+	my_index->components = malloc ( sizeof ( char * ) * my_index->component_capacity );
+
+	return my_index;
+
+}
+
+int spatialComponent_function ( SpatialIndex *index, const char *fileName, const char *type, int number ) {
+
+	if ( index->num_components == index->component_capacity ) {
+		index->component_capacity = index->component_capacity * 2;
+		index->components = realloc ( index->components, sizeof ( char * ) * index->component_capacity );
+	}
+
+	const char *source = fileName == NULL ? "" : fileName;
+	char *label = malloc ( strlen ( source ) + strlen ( type ) + 20 );
+	sprintf ( label, "%s!%s %d", source, type, number );
+
+	index->components[index->num_components] = label;
+	index->num_components = index->num_components + 1;
+
+	return index->num_components - 1;
+
+}
+
+/* Copies one waypoint list into the index as a segment with a box per BBOX_CHUNK points */
+void spatialSegment_function ( SpatialIndex *index, List *waypoints, int component ) {
+
+	if ( getLength ( waypoints ) == 0 ) {
+		return;
+	}
+
+	if ( index->num_segments == index->segment_capacity ) {
+		index->segment_capacity = index->segment_capacity * 2;
+		index->segments = realloc ( index->segments, sizeof ( SpatialSegment ) * index->segment_capacity );
+	}
+
+	SpatialSegment *my_segment = &index->segments[index->num_segments];
+
+	my_segment->component = component;
+	my_segment->start = index->points->length;
+	my_segment->first_chunk = index->num_chunks;
+
+	pointArrayAppend_function ( index->points, waypoints );
+
+	my_segment->end = index->points->length;
+	my_segment->box = (BoundingBox) { HUGE_VAL, -HUGE_VAL, HUGE_VAL, -HUGE_VAL };
+
+	for ( int start = my_segment->start; start < my_segment->end; start = start + BBOX_CHUNK ) {
+
+		if ( index->num_chunks == index->chunk_capacity ) {
+			index->chunk_capacity = index->chunk_capacity * 2;
+			index->chunks = realloc ( index->chunks, sizeof ( BoundingBox ) * index->chunk_capacity );
+		}
+
+		BoundingBox *my_chunk = &index->chunks[index->num_chunks];
+		*my_chunk = (BoundingBox) { HUGE_VAL, -HUGE_VAL, HUGE_VAL, -HUGE_VAL };
+
+		for ( int i = start; i < my_segment->end && i < start + BBOX_CHUNK; i++ ) {
+			boxInclude_function ( my_chunk, index->points->latitude[i], index->points->longitude[i] );
+		}
+
+		boxInclude_function ( &my_segment->box, my_chunk->min_lat, my_chunk->min_lon );
+		boxInclude_function ( &my_segment->box, my_chunk->max_lat, my_chunk->max_lon );
+
+		index->num_chunks = index->num_chunks + 1;
+
+	}
+
+	index->num_segments = index->num_segments + 1;
+
+}
+
+void addDocumentToSpatialIndex ( SpatialIndex *index, const GPXdoc *doc, const char *fileName ) {
+
+	if ( index == NULL || doc == NULL ) {
+		return;
+	}
+
+	ListIterator route_iter = createIterator ( doc->routes );
+	Route *my_route = nextElement ( &route_iter );
+
+	for ( int i = 1; my_route != NULL; i++ ) {
+		spatialSegment_function ( index, my_route->waypoints, spatialComponent_function ( index, fileName, "Route", i ) );
+		my_route = nextElement ( &route_iter );
+	}
+
+	ListIterator track_iter = createIterator ( doc->tracks );
+	Track *my_track = nextElement ( &track_iter );
+
+	for ( int i = 1; my_track != NULL; i++ ) {
+
+		int component = spatialComponent_function ( index, fileName, "Track", i );
+
+		ListIterator segment_iter = createIterator ( my_track->segments );
+		TrackSegment *my_segment = nextElement ( &segment_iter );
+
+		while ( my_segment != NULL ) {
+			spatialSegment_function ( index, my_segment->waypoints, component );
+			my_segment = nextElement ( &segment_iter );
+		}
+
+		my_track = nextElement ( &track_iter );
+
+	}
+
+}
+
+void deleteSpatialIndex ( SpatialIndex *index ) {
+
+	if ( index == NULL ) {
+		return;
+	}
+
+	for ( int i = 0; i < index->num_components; i++ ) {
+		free ( index->components[i] );
+	}
+
+	free ( index->components );
+	free ( index->chunks );
+	free ( index->segments );
+	deletePointArray ( index->points );
+	free ( index );
+
+}
+
+void deletePointRun ( void* data ) {
+
+	if ( data == NULL ) {
+		return;
+	}
+
+	PointRun *my_run = data;
+
+	free ( my_run->label );
+	deletePointArray ( my_run->points );
+	free ( my_run );
+
+}
+
+char* pointRunToString ( void* data ) {
+
+	if ( data == NULL ) {
+		return NULL;
+	}
+
+	PointRun *my_run = data;
+
+	char *points = pointArrayToJSON ( my_run->points );
+	char *label = my_run->label;
+	char *component = strchr ( label, '!' );
+
+	char *tmpStr = malloc ( strlen ( points ) + strlen ( label ) + 50 );
+
+	sprintf ( tmpStr, "{\"file\":\"%.*s\",\"component\":\"%s\",\"points\":%s}", (int) ( component - label ), label, component + 1, points );
+
+	free ( points );
+
+	return tmpStr;
+
+}
+
+int comparePointRuns ( const void *first, const void *second ) {
+
+	return strcmp ( ( (const PointRun *) first )->label, ( (const PointRun *) second )->label );
+
+}
+
+PointRun *pointRun_function ( const SpatialIndex *index, int component, int first, int last ) {
+
+	PointRun *my_run = malloc ( sizeof ( PointRun ) );
+
+	my_run->label = malloc ( strlen ( index->components[component] ) + 1 );
+	strcpy ( my_run->label, index->components[component] );
+
+	my_run->points = pointArray_function ( last - first + 1 );
+
+	for ( int i = first; i <= last; i++ ) {
+		addPoint ( my_run->points, index->points->latitude[i], index->points->longitude[i] );
+	}
+
+	return my_run;
+
+}
+
+/* Runs of consecutive points inside box, each with the neighbour on either side so the drawn line reaches the edge */
+List *queryBoundingBox ( const SpatialIndex *index, BoundingBox box ) {
+
+	if ( index == NULL ) {
+		return NULL;
+	}
+
+	List *my_runs = initializeList ( &pointRunToString, &deletePointRun, &comparePointRuns );
+
+	const double *lat = index->points->latitude;
+	const double *lon = index->points->longitude;
+
+	for ( int s = 0; s < index->num_segments; s++ ) {
+
+		const SpatialSegment *my_segment = &index->segments[s];
+
+		if ( !boxOverlap_function ( &my_segment->box, &box ) ) {
+			continue;
+		}
+
+		int run_start = -1;
+		int run_end = -1;
+
+		for ( int start = my_segment->start, c = my_segment->first_chunk; start < my_segment->end; start = start + BBOX_CHUNK, c++ ) {
+
+			int end = start + BBOX_CHUNK < my_segment->end ? start + BBOX_CHUNK : my_segment->end;
+
+			if ( !boxOverlap_function ( &index->chunks[c], &box ) ) {
+				continue;
+			}
+
+			for ( int i = start; i < end; i++ ) {
+
+				if ( !boxContains_function ( &box, lat[i], lon[i] ) ) {
+					continue;
+				}
+
+				/* A gap of more than the two neighbour points closes the current run */
+				if ( run_start != -1 && i > run_end + 1 ) {
+
+					insertBack ( my_runs, pointRun_function ( index, my_segment->component, run_start, run_end ) );
+					run_start = -1;
+
+				}
+
+				if ( run_start == -1 ) {
+					run_start = i > my_segment->start ? i - 1 : i;
+				}
+
+				run_end = i + 1 < my_segment->end ? i + 1 : i;
+
+			}
+
+		}
+
+		if ( run_start != -1 ) {
+
+			insertBack ( my_runs, pointRun_function ( index, my_segment->component, run_start, run_end ) );
+
+		}
+
+	}
+
+	return my_runs;
+
+}
+
+char *pointRunsToJSON ( List *runs ) {
+
+	if ( runs == NULL ) {
+		char *tmpStr = malloc ( 3 );
+		strcpy ( tmpStr, "[]" );
+		return tmpStr;
+	}
+
+	int size = 3;
+	int len = 0;
+	char *tmpStr = malloc ( size );
+
+	tmpStr[len++] = '[';
+
+	ListIterator run_iter = createIterator ( runs );
+	PointRun *my_run = nextElement ( &run_iter );
+
+	while ( my_run != NULL ) {
+
+		char *run = pointRunToString ( my_run );
+		int run_len = strlen ( run );
+
+		size = size + run_len + 1;
+		tmpStr = realloc ( tmpStr, size );
+
+		if ( len > 1 ) {
+			tmpStr[len++] = ',';
+		}
+
+		memcpy ( tmpStr + len, run, run_len );
+		len = len + run_len;
+		free ( run );
+
+		my_run = nextElement ( &run_iter );
+
+	}
+
+	tmpStr[len++] = ']';
+	tmpStr[len] = '\0';
+
+	return tmpStr;
+
+}
+
+/* fileNames is the "!" separated list the web app already builds, e.g. "uploads/a.gpx!uploads/b.gpx!" */
+SpatialIndex *buildSpatialIndex ( char* fileNames, char* gpxSchemaFile ) {
+
+	if ( fileNames == NULL ) {
+		return NULL;
+	}
+
+	SpatialIndex *my_index = spatialIndex_function ( );
+
+	char *names = malloc ( strlen ( fileNames ) + 1 );
+	strcpy ( names, fileNames );
+
+	char *save = NULL;
+	char *name = strtok_r ( names, "!", &save );
+
+	while ( name != NULL ) {
+
+		GPXdoc *my_doc = createValidGPXdoc ( name, gpxSchemaFile );
+
+		if ( my_doc != NULL ) {
+			addDocumentToSpatialIndex ( my_index, my_doc, name );
+			deleteGPXdoc ( my_doc );
+		}
+
+		name = strtok_r ( NULL, "!", &save );
+
+	}
+
+	free ( names );
+
+	return my_index;
+
+}
+
+char *getBoxPoints ( char* fileNames, char* gpxSchemaFile, float minLat, float maxLat, float minLon, float maxLon ) {
+
+	if ( fileNames == NULL || gpxSchemaFile == NULL ) {
+		return NULL;
+	}
+
+	pthread_mutex_lock ( &spatial_index_cache.lock );
+
+	BoundingBox box = { minLat, maxLat, minLon, maxLon };
+	List *my_runs = queryBoundingBox ( cachedSpatialIndex ( fileNames, gpxSchemaFile ), box );
+
+	pthread_mutex_unlock ( &spatial_index_cache.lock );
+
+	char *JSON_return = pointRunsToJSON ( my_runs );
+	freeList ( my_runs );
+
+	return JSON_return;
+
+}
+
+void unitVector_function ( double latitude, double longitude, double vector[3] ) {
+
+	double lat = latitude * ( 3.1415926536 / 180 );
+	double lon = longitude * ( 3.1415926536 / 180 );
+
+	vector[0] = cos ( lat ) * cos ( lon );
+	vector[1] = cos ( lat ) * sin ( lon );
+	vector[2] = sin ( lat );
+
+}
+
+void kdAdd_function ( KDTree *tree, const Waypoint *waypoint, int component ) {
+
+	if ( tree->num_points == tree->capacity ) {
+		tree->capacity = tree->capacity * 2;
+		tree->points = realloc ( tree->points, sizeof ( KDPoint ) * tree->capacity );
+	}
+
+	KDPoint *my_point = &tree->points[tree->num_points];
+
+	unitVector_function ( waypoint->latitude, waypoint->longitude, my_point->vector );
+	my_point->waypoint = waypoint;
+	my_point->component = component;
+
+	tree->num_points = tree->num_points + 1;
+
+}
+
+int kdComponent_function ( KDTree *tree, const char *type, int number ) {
+
+	tree->components = realloc ( tree->components, sizeof ( char * ) * ( tree->num_components + 1 ) );
+
+	char *label = malloc ( strlen ( type ) + 20 );
+
+	if ( number == 0 ) {
+		strcpy ( label, type );
+	} else {
+		sprintf ( label, "%s %d", type, number );
+	}
+
+	tree->components[tree->num_components] = label;
+	tree->num_components = tree->num_components + 1;
+
+	return tree->num_components - 1;
+
+}
+
+/* Quickselect so points[nth] holds the median on axis with smaller values to its left */
+void kdSelect_function ( KDPoint *points, int left, int right, int nth, int axis ) {
+
+	while ( left < right ) {
+
+		double pivot = points[( left + right ) / 2].vector[axis];
+		int i = left;
+		int j = right;
+
+		while ( i <= j ) {
+
+			while ( points[i].vector[axis] < pivot ) {
+				i++;
+			}
+			while ( points[j].vector[axis] > pivot ) {
+				j--;
+			}
+
+			if ( i <= j ) {
+				KDPoint temp = points[i];
+				points[i] = points[j];
+				points[j] = temp;
+				i++;
+				j--;
+			}
+
+		}
+
+		if ( nth <= j ) {
+			right = j;
+		} else if ( nth >= i ) {
+			left = i;
+		} else {
+			return;
+		}
+
+	}
+
+}
+
+/* Implicit tree: the middle of every range is its node, split on axis depth % 3 */
+void kdBuild_function ( KDPoint *points, int left, int right, int depth ) {
+
+	if ( left >= right ) {
+		return;
+	}
+
+	int mid = ( left + right ) / 2;
+
+	kdSelect_function ( points, left, right, mid, depth % 3 );
+
+	kdBuild_function ( points, left, mid - 1, depth + 1 );
+	kdBuild_function ( points, mid + 1, right, depth + 1 );
+
+}
+
+KDTree *buildKDTree ( const GPXdoc *doc ) {
+
+	if ( doc == NULL ) {
+		return NULL;
+	}
+
+	KDTree *tree = malloc ( sizeof ( KDTree ) );
+
+	tree->num_points = 0;
+	tree->capacity = 1024;
+	tree->points = malloc ( sizeof ( KDPoint ) * tree->capacity );
+	tree->num_components = 0;
+	tree->components = NULL;
+
+	int component = kdComponent_function ( tree, "Waypoint", 0 );
+
+	ListIterator waypoint_iter = createIterator ( doc->waypoints );
+	Waypoint *my_waypoint = nextElement ( &waypoint_iter );
+
+	while ( my_waypoint != NULL ) {
+		kdAdd_function ( tree, my_waypoint, component );
+		my_waypoint = nextElement ( &waypoint_iter );
+	}
+
+	ListIterator route_iter = createIterator ( doc->routes );
+	Route *my_route = nextElement ( &route_iter );
+
+	for ( int i = 1; my_route != NULL; i++ ) {
+
+		component = kdComponent_function ( tree, "Route", i );
+
+		ListIterator point_iter = createIterator ( my_route->waypoints );
+		my_waypoint = nextElement ( &point_iter );
+
+		while ( my_waypoint != NULL ) {
+			kdAdd_function ( tree, my_waypoint, component );
+			my_waypoint = nextElement ( &point_iter );
+		}
+
+		my_route = nextElement ( &route_iter );
+
+	}
+
+	ListIterator track_iter = createIterator ( doc->tracks );
+	Track *my_track = nextElement ( &track_iter );
+
+	for ( int i = 1; my_track != NULL; i++ ) {
+
+		component = kdComponent_function ( tree, "Track", i );
+
+		ListIterator segment_iter = createIterator ( my_track->segments );
+		TrackSegment *my_segment = nextElement ( &segment_iter );
+
+		while ( my_segment != NULL ) {
+
+			ListIterator point_iter = createIterator ( my_segment->waypoints );
+			my_waypoint = nextElement ( &point_iter );
+
+			while ( my_waypoint != NULL ) {
+				kdAdd_function ( tree, my_waypoint, component );
+				my_waypoint = nextElement ( &point_iter );
+			}
+
+			my_segment = nextElement ( &segment_iter );
+
+		}
+
+		my_track = nextElement ( &track_iter );
+
+	}
+
+	kdBuild_function ( tree->points, 0, tree->num_points - 1, 0 );
+
+	return tree;
+
+}
+
+void deleteKDTree ( KDTree *tree ) {
+
+	if ( tree == NULL ) {
+		return;
+	}
+
+	for ( int i = 0; i < tree->num_components; i++ ) {
+		free ( tree->components[i] );
+	}
+
+	free ( tree->components );
+	free ( tree->points );
+	free ( tree );
+
+}
+
+/* Max-heap on squared chord length so the worst of the current k sits at the top */
+void knnPush_function ( int *heap, double *heap_dist, int *size, int k, int index, double dist ) {
+
+	int i = 0;
+
+	if ( *size < k ) {
+
+		i = *size;
+		*size = *size + 1;
+
+		while ( i > 0 && heap_dist[( i - 1 ) / 2] < dist ) {
+			heap[i] = heap[( i - 1 ) / 2];
+			heap_dist[i] = heap_dist[( i - 1 ) / 2];
+			i = ( i - 1 ) / 2;
+		}
+
+	} else {
+
+		if ( dist >= heap_dist[0] ) {
+			return;
+		}
+
+		while ( 1 ) {
+
+			int child = i * 2 + 1;
+
+			if ( child >= *size ) {
+				break;
+			}
+			if ( child + 1 < *size && heap_dist[child + 1] > heap_dist[child] ) {
+				child++;
+			}
+			if ( heap_dist[child] <= dist ) {
+				break;
+			}
+
+			heap[i] = heap[child];
+			heap_dist[i] = heap_dist[child];
+			i = child;
+
+		}
+
+	}
+
+	heap[i] = index;
+	heap_dist[i] = dist;
+
+}
+
+void kdSearch_function ( const KDTree *tree, int left, int right, int depth, const double query[3], int *heap, double *heap_dist, int *size, int k ) {
+
+	if ( left > right ) {
+		return;
+	}
+
+	int mid = ( left + right ) / 2;
+	const double *vector = tree->points[mid].vector;
+
+	double dx = query[0] - vector[0];
+	double dy = query[1] - vector[1];
+	double dz = query[2] - vector[2];
+
+	knnPush_function ( heap, heap_dist, size, k, mid, dx * dx + dy * dy + dz * dz );
+
+	double diff = query[depth % 3] - vector[depth % 3];
+
+	if ( diff < 0 ) {
+		kdSearch_function ( tree, left, mid - 1, depth + 1, query, heap, heap_dist, size, k );
+	} else {
+		kdSearch_function ( tree, mid + 1, right, depth + 1, query, heap, heap_dist, size, k );
+	}
+
+	if ( *size < k || diff * diff < heap_dist[0] ) {
+		if ( diff < 0 ) {
+			kdSearch_function ( tree, mid + 1, right, depth + 1, query, heap, heap_dist, size, k );
+		} else {
+			kdSearch_function ( tree, left, mid - 1, depth + 1, query, heap, heap_dist, size, k );
+		}
+	}
+
+}
+
+/* Fills results with up to k nearest points, closest first, and returns how many were found */
+int nearestPoints ( const KDTree *tree, float latitude, float longitude, int k, Neighbour *results ) {
+
+	if ( tree == NULL || k <= 0 || results == NULL ) {
+		return 0;
+	}
+
+	if ( k > tree->num_points ) {
+		k = tree->num_points;
+	}
+
+	double query[3];
+	unitVector_function ( latitude, longitude, query );
+
+	int *heap = malloc ( sizeof ( int ) * k );
+	double *heap_dist = malloc ( sizeof ( double ) * k );
+	int size = 0;
+
+	kdSearch_function ( tree, 0, tree->num_points - 1, 0, query, heap, heap_dist, &size, k );
+
+	int found = size;
+
+	/* Popping the max-heap fills results from the back */
+	while ( size > 0 ) {
+
+		const KDPoint *my_point = &tree->points[heap[0]];
+
+		results[size - 1].waypoint = my_point->waypoint;
+		results[size - 1].component = tree->components[my_point->component];
+		results[size - 1].distance = distance_function ( latitude, longitude, my_point->waypoint->latitude, my_point->waypoint->longitude ) * 1000;
+
+		size = size - 1;
+
+		int last = heap[size];
+		double last_dist = heap_dist[size];
+		int i = 0;
+
+		while ( 1 ) {
+
+			int child = i * 2 + 1;
+
+			if ( child >= size ) {
+				break;
+			}
+			if ( child + 1 < size && heap_dist[child + 1] > heap_dist[child] ) {
+				child++;
+			}
+			if ( heap_dist[child] <= last_dist ) {
+				break;
+			}
+
+			heap[i] = heap[child];
+			heap_dist[i] = heap_dist[child];
+			i = child;
+
+		}
+
+		heap[i] = last;
+		heap_dist[i] = last_dist;
+
+	}
+
+	free ( heap );
+	free ( heap_dist );
+
+	return found;
+
+}
+
+void *buildKDIndex_function ( const GPXdoc *doc ) {
+
+	return buildKDTree ( doc );
+
+}
+
+void deleteKDIndex_function ( void *index ) {
+
+	deleteKDTree ( index );
+
+}
+
+/* The tree is built once per version of the file; a query only searches it */
+char *getNearestPoints ( char* fileName, char* gpxSchemaFile, float latitude, float longitude, int k ) {
+
+	if ( fileName == NULL || gpxSchemaFile == NULL ) {
+		return NULL;
+	}
+
+	pthread_mutex_lock ( &kd_cache.lock );
+
+	KDTree *tree = cachedFileIndex ( &kd_cache, fileName, gpxSchemaFile );
+
+	if ( tree == NULL ) {
+		pthread_mutex_unlock ( &kd_cache.lock );
+		return NULL;
+	}
+
+	if ( k > tree->num_points ) {
+		k = tree->num_points;
+	}
+
+	Neighbour *results = malloc ( sizeof ( Neighbour ) * ( k > 0 ? k : 1 ) );
+
+	int found = nearestPoints ( tree, latitude, longitude, k, results );
+
+	int len = 0;
+	char *JSON_return = malloc ( 3 );
+	JSON_return[len++] = '[';
+
+	for ( int i = 0; i < found; i++ ) {
+
+		JSON_return = realloc ( JSON_return, len + ( strlen ( results[i].waypoint->name ) + strlen ( results[i].component ) ) * 6 + 150 );
+
+		len = len + sprintf ( JSON_return + len, "%s{\"name\":", i == 0 ? "" : "," );
+		len = len + jsonString_function ( JSON_return + len, results[i].waypoint->name );
+		len = len + sprintf ( JSON_return + len, ",\"component\":\"%s\",\"lat\":%.7f,\"lon\":%.7f,\"distance\":%.1f}", results[i].component, results[i].waypoint->latitude, results[i].waypoint->longitude, results[i].distance );
+
+	}
+
+	pthread_mutex_unlock ( &kd_cache.lock );
+
+	JSON_return[len++] = ']';
+	JSON_return[len] = '\0';
+
+	free ( results );
+
+	return JSON_return;
+
+}
+
+void geohash_function ( double latitude, double longitude, int precision, char *hash ) {
+
+	const char *base32 = "0123456789bcdefghjkmnpqrstuvwxyz";
+
+	double lat_range[2] = { -90, 90 };
+	double lon_range[2] = { -180, 180 };
+	bool even = true;
+
+	for ( int i = 0; i < precision; i++ ) {
+
+		int value = 0;
+
+		for ( int bit = 0; bit < 5; bit++ ) {
+
+			double *range = even ? lon_range : lat_range;
+			double coordinate = even ? longitude : latitude;
+			double mid = ( range[0] + range[1] ) / 2;
+
+			value = value * 2;
+
+			if ( coordinate >= mid ) {
+				value = value + 1;
+				range[0] = mid;
+			} else {
+				range[1] = mid;
+			}
+
+			even = !even;
+
+		}
+
+		hash[i] = base32[value];
+
+	}
+
+	hash[precision] = '\0';
+
+}
+
+/* 64 bit FNV-1a, split into the two halves used for double hashing */
+uint64_t bloomHash_function ( const char *key ) {
+
+	uint64_t hash = 14695981039346656037ULL;
+
+	for ( int i = 0; key[i] != '\0'; i++ ) {
+		hash = hash ^ (unsigned char) key[i];
+		hash = hash * 1099511628211ULL;
+	}
+
+	return hash;
+
+}
+
+/* Sized for about 1% false positives at the expected number of keys */
+BloomFilter bloomFilter_function ( int expected ) {
+
+	BloomFilter filter;
+
+	filter.num_bits = expected * BLOOM_BITS_PER_KEY;
+
+	if ( filter.num_bits < 64 ) {
+		filter.num_bits = 64;
+	}
+
+	filter.num_bits = ( filter.num_bits + 7 ) / 8 * 8;
+	filter.num_hashes = BLOOM_HASHES;
+	filter.bits = calloc ( filter.num_bits / 8, 1 );
+
+	return filter;
+
+}
+
+void bloomAdd ( BloomFilter *filter, const char *key ) {
+
+	uint64_t hash = bloomHash_function ( key );
+	uint32_t h1 = hash;
+	uint32_t h2 = hash >> 32;
+
+	for ( int i = 0; i < filter->num_hashes; i++ ) {
+		uint32_t bit = ( h1 + i * h2 ) % filter->num_bits;
+		filter->bits[bit / 8] |= 1 << ( bit % 8 );
+	}
+
+}
+
+bool bloomContains ( const BloomFilter *filter, const char *key ) {
+
+	if ( filter->num_bits == 0 ) {
+		return false;
+	}
+
+	uint64_t hash = bloomHash_function ( key );
+	uint32_t h1 = hash;
+	uint32_t h2 = hash >> 32;
+
+	for ( int i = 0; i < filter->num_hashes; i++ ) {
+		uint32_t bit = ( h1 + i * h2 ) % filter->num_bits;
+		if ( ( filter->bits[bit / 8] & ( 1 << ( bit % 8 ) ) ) == 0 ) {
+			return false;
+		}
+	}
+
+	return true;
+
+}
+
+/* Adds the cells of every precision the points pass through, skipping repeats of the previous point's cell */
+void geoCells_function ( List *waypoints, char **cells, int *num_cells, int *capacity ) {
+
+	char last[GEOHASH_MAX_PRECISION + 1][GEOHASH_MAX_PRECISION + 2];
+
+	for ( int p = 0; p <= GEOHASH_MAX_PRECISION; p++ ) {
+		last[p][0] = '\0';
+	}
+
+	ListIterator point_iter = createIterator ( waypoints );
+	Waypoint *my_waypoint = nextElement ( &point_iter );
+
+	while ( my_waypoint != NULL ) {
+
+		char hash[GEOHASH_MAX_PRECISION + 1];
+		geohash_function ( my_waypoint->latitude, my_waypoint->longitude, GEOHASH_MAX_PRECISION, hash );
+
+		for ( int p = GEOHASH_MIN_PRECISION; p <= GEOHASH_MAX_PRECISION; p++ ) {
+
+			if ( strncmp ( last[p], hash, p ) == 0 ) {
+				continue;
+			}
+
+			memcpy ( last[p], hash, p );
+			last[p][p] = '\0';
+
+			if ( *num_cells == *capacity ) {
+				*capacity = *capacity * 2;
+				*cells = realloc ( *cells, *capacity * ( GEOHASH_MAX_PRECISION + 1 ) );
+			}
+
+			strcpy ( *cells + *num_cells * ( GEOHASH_MAX_PRECISION + 1 ), last[p] );
+			*num_cells = *num_cells + 1;
+
+		}
+
+		my_waypoint = nextElement ( &point_iter );
+
+	}
+
+}
+
+BloomFilter buildGeoFilter ( const GPXdoc *doc ) {
+
+	int num_cells = 0;
+	int capacity = 256;
+	char *cells = malloc ( capacity * ( GEOHASH_MAX_PRECISION + 1 ) );
+
+	ListIterator route_iter = createIterator ( doc->routes );
+	Route *my_route = nextElement ( &route_iter );
+
+	while ( my_route != NULL ) {
+		geoCells_function ( my_route->waypoints, &cells, &num_cells, &capacity );
+		my_route = nextElement ( &route_iter );
+	}
+
+	ListIterator track_iter = createIterator ( doc->tracks );
+	Track *my_track = nextElement ( &track_iter );
+
+	while ( my_track != NULL ) {
+
+		ListIterator segment_iter = createIterator ( my_track->segments );
+		TrackSegment *my_segment = nextElement ( &segment_iter );
+
+		while ( my_segment != NULL ) {
+			geoCells_function ( my_segment->waypoints, &cells, &num_cells, &capacity );
+			my_segment = nextElement ( &segment_iter );
+		}
+
+		my_track = nextElement ( &track_iter );
+
+	}
+
+	BloomFilter filter = bloomFilter_function ( num_cells );
+
+	for ( int i = 0; i < num_cells; i++ ) {
+		bloomAdd ( &filter, cells + i * ( GEOHASH_MAX_PRECISION + 1 ) );
+	}
+
+	free ( cells );
+
+	return filter;
+
+}
+
+/* False only if no geohash cell overlapping the box is in the filter */
+bool geoBoxMayContain_function ( const BloomFilter *filter, double min_lat, double max_lat, double min_lon, double max_lon ) {
+
+	/* Finest precision whose cover of the search box stays small */
+	for ( int p = GEOHASH_MAX_PRECISION; p >= GEOHASH_MIN_PRECISION; p-- ) {
+
+		int lat_bits = p * 5 / 2;
+		int lon_bits = p * 5 - lat_bits;
+		double cell_height = 180.0 / ( 1 << lat_bits );
+		double cell_width = 360.0 / ( 1 << lon_bits );
+
+		int first_row = ( min_lat + 90 ) / cell_height;
+		int last_row = ( max_lat + 90 ) / cell_height;
+		int first_col = ( min_lon + 180 ) / cell_width;
+		int last_col = ( max_lon + 180 ) / cell_width;
+
+		/* The north pole and the antimeridian fall in the last row and column */
+		if ( last_row >= ( 1 << lat_bits ) ) {
+			last_row = ( 1 << lat_bits ) - 1;
+		}
+
+		if ( last_col >= ( 1 << lon_bits ) ) {
+			last_col = ( 1 << lon_bits ) - 1;
+		}
+
+		if ( ( last_row - first_row + 1 ) * ( last_col - first_col + 1 ) > GEOHASH_QUERY_CELLS ) {
+			continue;
+		}
+
+		for ( int row = first_row; row <= last_row; row++ ) {
+			for ( int col = first_col; col <= last_col; col++ ) {
+
+				char hash[GEOHASH_MAX_PRECISION + 1];
+				geohash_function ( -90 + ( row + 0.5 ) * cell_height, -180 + ( col + 0.5 ) * cell_width, p, hash );
+
+				if ( bloomContains ( filter, hash ) ) {
+					return true;
+				}
+
+			}
+		}
+
+		return false;
+
+	}
+
+	return filter->num_bits != 0;
+
+}
+
+/* False only if no route or track point can be within radius km of the point, under any distance kernel */
+bool geoFilterMayContain ( const BloomFilter *filter, float latitude, float longitude, float radius ) {
+
+	/* 110.5 km is the shortest degree of latitude, the same bound withinDistanceKernel uses */
+	double dlat = radius / 110.5;
+
+	double min_lat = latitude - dlat < -90 ? -90 : latitude - dlat;
+	double max_lat = latitude + dlat > 90 ? 90 : latitude + dlat;
+
+	/* A cap reaching a pole spans every longitude, otherwise it spans asin ( sin r / cos lat ) either side */
+	if ( fabs ( latitude ) + dlat >= 90 || dlat >= 90 ) {
+		return geoBoxMayContain_function ( filter, min_lat, max_lat, -180, 180 );
+	}
+
+	double to_rad = 3.1415926536 / 180;
+	double dlon = asin ( sin ( dlat * to_rad ) / cos ( latitude * to_rad ) ) / to_rad;
+
+	/* The equirectangular kernel, the loosest, scales longitude by the pair's mean latitude instead */
+	double flat_dlon = dlat / cos ( ( fabs ( latitude ) + dlat / 2 ) * to_rad );
+
+	if ( flat_dlon > dlon ) {
+		dlon = flat_dlon;
+	}
+
+	if ( dlon >= 180 ) {
+		return geoBoxMayContain_function ( filter, min_lat, max_lat, -180, 180 );
+	}
+
+	double min_lon = longitude - dlon;
+	double max_lon = longitude + dlon;
+
+	/* Split a box crossing the antimeridian into its two sides */
+	if ( min_lon < -180 ) {
+		return geoBoxMayContain_function ( filter, min_lat, max_lat, -180, max_lon ) || geoBoxMayContain_function ( filter, min_lat, max_lat, min_lon + 360, 180 );
+	}
+
+	if ( max_lon > 180 ) {
+		return geoBoxMayContain_function ( filter, min_lat, max_lat, min_lon, 180 ) || geoBoxMayContain_function ( filter, min_lat, max_lat, -180, max_lon - 360 );
+	}
+
+	return geoBoxMayContain_function ( filter, min_lat, max_lat, min_lon, max_lon );
+
+}
+
+GeoCatalog *loadGeoCatalog ( const char *catalogFile ) {
+
+	GeoCatalog *catalog = malloc ( sizeof ( GeoCatalog ) );
+
+	catalog->num_entries = 0;
+	catalog->capacity = 16;
+	catalog->entries = malloc ( sizeof ( GeoCatalogEntry ) * catalog->capacity );
+
+	FILE *fp = catalogFile == NULL ? NULL : fopen ( catalogFile, "rb" );
+
+	if ( fp == NULL ) {
+		return catalog;
+	}
+
+	char magic[4];
+	int count = 0;
+
+	if ( fread ( magic, 1, 4, fp ) != 4 || memcmp ( magic, "GPXC", 4 ) != 0 || fread ( &count, sizeof ( int ), 1, fp ) != 1 ) {
+		fclose ( fp );
+		return catalog;
+	}
+
+	for ( int i = 0; i < count; i++ ) {
+
+		GeoCatalogEntry my_entry;
+		int name_len = 0;
+
+		if ( fread ( &name_len, sizeof ( int ), 1, fp ) != 1 || name_len < 0 || name_len > 4096 ) {
+			break;
+		}
+
+		my_entry.fileName = malloc ( name_len + 1 );
+
+		if ( fread ( my_entry.fileName, 1, name_len, fp ) != (size_t) name_len || fread ( &my_entry.mtime, sizeof ( int64_t ), 1, fp ) != 1 || fread ( &my_entry.filter.num_bits, sizeof ( int ), 1, fp ) != 1 || fread ( &my_entry.filter.num_hashes, sizeof ( int ), 1, fp ) != 1 ) {
+			free ( my_entry.fileName );
+			break;
+		}
+
+		my_entry.fileName[name_len] = '\0';
+		my_entry.filter.bits = malloc ( my_entry.filter.num_bits / 8 + 1 );
+
+		if ( fread ( my_entry.filter.bits, 1, my_entry.filter.num_bits / 8, fp ) != (size_t) ( my_entry.filter.num_bits / 8 ) ) {
+			free ( my_entry.fileName );
+			free ( my_entry.filter.bits );
+			break;
+		}
+
+		if ( catalog->num_entries == catalog->capacity ) {
+			catalog->capacity = catalog->capacity * 2;
+			catalog->entries = realloc ( catalog->entries, sizeof ( GeoCatalogEntry ) * catalog->capacity );
+		}
+
+		catalog->entries[catalog->num_entries] = my_entry;
+		catalog->num_entries = catalog->num_entries + 1;
+
+	}
+
+	fclose ( fp );
+
+	return catalog;
+
+}
+
+bool saveGeoCatalog ( const GeoCatalog *catalog, const char *catalogFile ) {
+
+	if ( catalog == NULL || catalogFile == NULL ) {
+		return false;
+	}
+
+	/* Written beside the catalog and renamed over it so readers never see half a file */
+	char *temp_name = malloc ( strlen ( catalogFile ) + 5 );
+	sprintf ( temp_name, "%s.tmp", catalogFile );
+
+	FILE *fp = fopen ( temp_name, "wb" );
+
+	if ( fp == NULL ) {
+		free ( temp_name );
+		return false;
+	}
+
+	fwrite ( "GPXC", 1, 4, fp );
+	fwrite ( &catalog->num_entries, sizeof ( int ), 1, fp );
+
+	for ( int i = 0; i < catalog->num_entries; i++ ) {
+
+		const GeoCatalogEntry *my_entry = &catalog->entries[i];
+		int name_len = strlen ( my_entry->fileName );
+
+		fwrite ( &name_len, sizeof ( int ), 1, fp );
+		fwrite ( my_entry->fileName, 1, name_len, fp );
+		fwrite ( &my_entry->mtime, sizeof ( int64_t ), 1, fp );
+		fwrite ( &my_entry->filter.num_bits, sizeof ( int ), 1, fp );
+		fwrite ( &my_entry->filter.num_hashes, sizeof ( int ), 1, fp );
+		fwrite ( my_entry->filter.bits, 1, my_entry->filter.num_bits / 8, fp );
+
+	}
+
+	bool written = ferror ( fp ) == 0;
+
+	if ( fclose ( fp ) != 0 ) {
+		written = false;
+	}
+
+	if ( written ) {
+		written = rename ( temp_name, catalogFile ) == 0;
+	} else {
+		remove ( temp_name );
+	}
+
+	free ( temp_name );
+
+	return written;
+
+}
+
+/* Modification time in nanoseconds; whole seconds miss a same-size edit made within the second */
+int64_t fileStamp_function ( const struct stat *file_stat ) {
+
+	return (int64_t) file_stat->st_mtim.tv_sec * 1000000000 + file_stat->st_mtim.tv_nsec;
+
+}
+
+/* Catalog entry for fileName, re-parsing the file only when it changed since it was catalogued */
+GeoCatalogEntry *geoCatalogEntry ( GeoCatalog *catalog, char *fileName, char *gpxSchemaFile, bool *changed ) {
+
+	struct stat file_stat;
+
+	if ( catalog == NULL || fileName == NULL || stat ( fileName, &file_stat ) != 0 ) {
+		return NULL;
+	}
+
+	GeoCatalogEntry *my_entry = NULL;
+
+	for ( int i = 0; i < catalog->num_entries; i++ ) {
+		if ( strcmp ( catalog->entries[i].fileName, fileName ) == 0 ) {
+			my_entry = &catalog->entries[i];
+		}
+	}
+
+	if ( my_entry != NULL && my_entry->mtime == fileStamp_function ( &file_stat ) ) {
+		return my_entry;
+	}
+
+	if ( my_entry == NULL ) {
+
+		if ( catalog->num_entries == catalog->capacity ) {
+			catalog->capacity = catalog->capacity * 2;
+			catalog->entries = realloc ( catalog->entries, sizeof ( GeoCatalogEntry ) * catalog->capacity );
+		}
+
+		my_entry = &catalog->entries[catalog->num_entries];
+		catalog->num_entries = catalog->num_entries + 1;
+
+		my_entry->fileName = malloc ( strlen ( fileName ) + 1 );
+		strcpy ( my_entry->fileName, fileName );
+
+	} else {
+		free ( my_entry->filter.bits );
+	}
+
+	my_entry->mtime = fileStamp_function ( &file_stat );
+
+	/* Invalid files get an empty filter so they are never candidates until they change */
+	GPXdoc *my_doc = createValidGPXdoc ( fileName, gpxSchemaFile );
+
+	if ( my_doc != NULL ) {
+		my_entry->filter = buildGeoFilter ( my_doc );
+		deleteGPXdoc ( my_doc );
+	} else {
+		my_entry->filter.num_bits = 0;
+		my_entry->filter.num_hashes = 0;
+		my_entry->filter.bits = malloc ( 1 );
+	}
+
+	if ( changed != NULL ) {
+		*changed = true;
+	}
+
+	return my_entry;
+
+}
+
+void deleteGeoCatalog ( GeoCatalog *catalog ) {
+
+	if ( catalog == NULL ) {
+		return;
+	}
+
+	for ( int i = 0; i < catalog->num_entries; i++ ) {
+		free ( catalog->entries[i].fileName );
+		free ( catalog->entries[i].filter.bits );
+	}
+
+	free ( catalog->entries );
+	free ( catalog );
+
+}
+
+/* The "!" separated subset of fileNames that may hold a route or track with an end within delta km of either point */
+char *getCandidateFiles ( char* fileNames, char* catalogFile, char* gpxSchemaFile, float start_lat, float start_lon, float end_lat, float end_lon, float delta ) {
+
+	if ( fileNames == NULL ) {
+		return NULL;
+	}
+
+	GeoCatalog *catalog = loadGeoCatalog ( catalogFile );
+	bool changed = false;
+
+	char *names = malloc ( strlen ( fileNames ) + 1 );
+	strcpy ( names, fileNames );
+
+	char *candidates = malloc ( strlen ( fileNames ) + 1 );
+	strcpy ( candidates, "" );
+
+	bool *listed = calloc ( catalog->num_entries + 1, sizeof ( bool ) );
+	int num_listed = catalog->num_entries;
+
+	char *save = NULL;
+	char *name = strtok_r ( names, "!", &save );
+
+	while ( name != NULL ) {
+
+		GeoCatalogEntry *my_entry = geoCatalogEntry ( catalog, name, gpxSchemaFile, &changed );
+
+		if ( my_entry != NULL ) {
+
+			int index = my_entry - catalog->entries;
+
+			if ( index < num_listed ) {
+				listed[index] = true;
+			}
+
+			if ( geoFilterMayContain ( &my_entry->filter, start_lat, start_lon, delta ) || geoFilterMayContain ( &my_entry->filter, end_lat, end_lon, delta ) ) {
+				strcat ( candidates, name );
+				strcat ( candidates, "!" );
+			}
+
+		}
+
+		name = strtok_r ( NULL, "!", &save );
+
+	}
+
+	/* Drop files that are no longer in the directory listing */
+	int kept = 0;
+
+	for ( int i = 0; i < catalog->num_entries; i++ ) {
+
+		if ( i < num_listed && !listed[i] ) {
+			free ( catalog->entries[i].fileName );
+			free ( catalog->entries[i].filter.bits );
+			changed = true;
+			continue;
+		}
+
+		catalog->entries[kept++] = catalog->entries[i];
+
+	}
+
+	catalog->num_entries = kept;
+
+	if ( changed ) {
+		saveGeoCatalog ( catalog, catalogFile );
+	}
+
+	free ( listed );
+	free ( names );
+	deleteGeoCatalog ( catalog );
+
+	return candidates;
+
+}
+
+Heatmap *heatmap_function ( int zoom, int resolution ) {
+
+	Heatmap *my_heatmap = malloc ( sizeof ( Heatmap ) );
+
+	my_heatmap->zoom = zoom;
+	my_heatmap->resolution = resolution;
+	my_heatmap->num_tiles = 0;
+	my_heatmap->capacity = 64;
+	my_heatmap->tiles = calloc ( my_heatmap->capacity, sizeof ( HeatTile ) );
+	my_heatmap->fileNames = NULL;
+	my_heatmap->num_files = 0;
+
+	return my_heatmap;
+
+}
+
+uint32_t heatTileHash_function ( int x, int y ) {
+
+	uint64_t key = ( (uint64_t) (uint32_t) x << 32 ) | (uint32_t) y;
+
+	key = key ^ ( key >> 33 );
+	key = key * 0xff51afd7ed558ccdULL;
+	key = key ^ ( key >> 33 );
+
+	return (uint32_t) key;
+
+}
+
+/* Open addressing on (x, y); a tile with no counts array is an empty slot */
+HeatTile *heatTile_function ( Heatmap *heatmap, int x, int y ) {
+
+	if ( ( heatmap->num_tiles + 1 ) * 2 > heatmap->capacity ) {
+
+		HeatTile *old_tiles = heatmap->tiles;
+		int old_capacity = heatmap->capacity;
+
+		heatmap->capacity = heatmap->capacity * 2;
+		heatmap->tiles = calloc ( heatmap->capacity, sizeof ( HeatTile ) );
+
+		for ( int i = 0; i < old_capacity; i++ ) {
+
+			if ( old_tiles[i].counts == NULL ) {
+				continue;
+			}
+
+			uint32_t slot = heatTileHash_function ( old_tiles[i].x, old_tiles[i].y ) & ( heatmap->capacity - 1 );
+
+			while ( heatmap->tiles[slot].counts != NULL ) {
+				slot = ( slot + 1 ) & ( heatmap->capacity - 1 );
+			}
+
+			heatmap->tiles[slot] = old_tiles[i];
+
+		}
+
+		free ( old_tiles );
+
+	}
+
+	uint32_t slot = heatTileHash_function ( x, y ) & ( heatmap->capacity - 1 );
+
+	while ( heatmap->tiles[slot].counts != NULL ) {
+
+		if ( heatmap->tiles[slot].x == x && heatmap->tiles[slot].y == y ) {
+			return &heatmap->tiles[slot];
+		}
+
+		slot = ( slot + 1 ) & ( heatmap->capacity - 1 );
+
+	}
+
+	heatmap->tiles[slot].x = x;
+	heatmap->tiles[slot].y = y;
+	heatmap->tiles[slot].counts = calloc ( heatmap->resolution * heatmap->resolution, sizeof ( uint32_t ) );
+	heatmap->num_tiles = heatmap->num_tiles + 1;
+
+	return &heatmap->tiles[slot];
+
+}
+
+const HeatTile *findHeatTile ( const Heatmap *heatmap, int x, int y ) {
+
+	uint32_t slot = heatTileHash_function ( x, y ) & ( heatmap->capacity - 1 );
+
+	while ( heatmap->tiles[slot].counts != NULL ) {
+
+		if ( heatmap->tiles[slot].x == x && heatmap->tiles[slot].y == y ) {
+			return &heatmap->tiles[slot];
+		}
+
+		slot = ( slot + 1 ) & ( heatmap->capacity - 1 );
+
+	}
+
+	return NULL;
+
+}
+
+/* Web Mercator pixel at zoom, resolution pixels per tile side */
+void heatmapAddPoint ( Heatmap *heatmap, double latitude, double longitude ) {
+
+	if ( latitude > 85.0511 ) {
+		latitude = 85.0511;
+	}
+	if ( latitude < -85.0511 ) {
+		latitude = -85.0511;
+	}
+
+	double size = (double) ( 1 << heatmap->zoom ) * heatmap->resolution;
+	double lat = latitude * ( 3.1415926536 / 180 );
+
+	long px = ( longitude + 180 ) / 360 * size;
+	long py = ( 1 - log ( tan ( lat ) + 1 / cos ( lat ) ) / 3.1415926536 ) / 2 * size;
+
+	if ( px < 0 || py < 0 || px >= size || py >= size ) {
+		return;
+	}
+
+	HeatTile *my_tile = heatTile_function ( heatmap, px / heatmap->resolution, py / heatmap->resolution );
+	uint32_t *count = &my_tile->counts[( py % heatmap->resolution ) * heatmap->resolution + px % heatmap->resolution];
+
+	if ( *count != UINT32_MAX ) {
+		*count = *count + 1;
+	}
+
+}
+
+void heatmapAddWaypoints ( Heatmap *heatmap, List *waypoints ) {
+
+	ListIterator point_iter = createIterator ( waypoints );
+	Waypoint *my_waypoint = nextElement ( &point_iter );
+
+	while ( my_waypoint != NULL ) {
+		heatmapAddPoint ( heatmap, my_waypoint->latitude, my_waypoint->longitude );
+		my_waypoint = nextElement ( &point_iter );
+	}
+
+}
+
+void heatmapAddDocument ( Heatmap *heatmap, const GPXdoc *doc ) {
+
+	ListIterator route_iter = createIterator ( doc->routes );
+	Route *my_route = nextElement ( &route_iter );
+
+	while ( my_route != NULL ) {
+		heatmapAddWaypoints ( heatmap, my_route->waypoints );
+		my_route = nextElement ( &route_iter );
+	}
+
+	ListIterator track_iter = createIterator ( doc->tracks );
+	Track *my_track = nextElement ( &track_iter );
+
+	while ( my_track != NULL ) {
+
+		ListIterator segment_iter = createIterator ( my_track->segments );
+		TrackSegment *my_segment = nextElement ( &segment_iter );
+
+		while ( my_segment != NULL ) {
+			heatmapAddWaypoints ( heatmap, my_segment->waypoints );
+			my_segment = nextElement ( &segment_iter );
+		}
+
+		my_track = nextElement ( &track_iter );
+
+	}
+
+}
+
+void mergeHeatmap ( Heatmap *destination, const Heatmap *source ) {
+
+	int pixels = source->resolution * source->resolution;
+
+	for ( int i = 0; i < source->capacity; i++ ) {
+
+		if ( source->tiles[i].counts == NULL ) {
+			continue;
+		}
+
+		HeatTile *my_tile = heatTile_function ( destination, source->tiles[i].x, source->tiles[i].y );
+
+		for ( int j = 0; j < pixels; j++ ) {
+			uint64_t sum = (uint64_t) my_tile->counts[j] + source->tiles[i].counts[j];
+			my_tile->counts[j] = sum > UINT32_MAX ? UINT32_MAX : sum;
+		}
+
+	}
+
+}
+
+void heatmapIncludeFile ( Heatmap *heatmap, const char *fileName ) {
+
+	heatmap->fileNames = realloc ( heatmap->fileNames, sizeof ( char * ) * ( heatmap->num_files + 1 ) );
+	heatmap->fileNames[heatmap->num_files] = malloc ( strlen ( fileName ) + 1 );
+	strcpy ( heatmap->fileNames[heatmap->num_files], fileName );
+	heatmap->num_files = heatmap->num_files + 1;
+
+}
+
+bool heatmapHasFile ( const Heatmap *heatmap, const char *fileName ) {
+
+	for ( int i = 0; i < heatmap->num_files; i++ ) {
+		if ( strcmp ( heatmap->fileNames[i], fileName ) == 0 ) {
+			return true;
+		}
+	}
+
+	return false;
+
+}
+
+void deleteHeatmap ( Heatmap *heatmap ) {
+
+	if ( heatmap == NULL ) {
+		return;
+	}
+
+	for ( int i = 0; i < heatmap->capacity; i++ ) {
+		free ( heatmap->tiles[i].counts );
+	}
+
+	for ( int i = 0; i < heatmap->num_files; i++ ) {
+		free ( heatmap->fileNames[i] );
+	}
+
+	free ( heatmap->fileNames );
+	free ( heatmap->tiles );
+	free ( heatmap );
+
+}
+
+/* Each worker fills a private heatmap from the shared queue and merges it once at the end */
+void *heatmapWorker_function ( void *arg ) {
+
+	HeatmapJob *job = arg;
+	Heatmap *local = heatmap_function ( job->result->zoom, job->result->resolution );
+
+	while ( 1 ) {
+
+		pthread_mutex_lock ( &job->lock );
+		int list = job->next_list < job->num_lists ? job->next_list++ : -1;
+		pthread_mutex_unlock ( &job->lock );
+
+		if ( list == -1 ) {
+			break;
+		}
+
+		heatmapAddWaypoints ( local, job->lists[list] );
+
+	}
+
+	pthread_mutex_lock ( &job->lock );
+	mergeHeatmap ( job->result, local );
+	pthread_mutex_unlock ( &job->lock );
+
+	deleteHeatmap ( local );
+
+	return NULL;
+
+}
+
+void runHeatmapJob ( HeatmapJob *job, int numThreads ) {
+
+	if ( numThreads < 1 ) {
+		numThreads = 1;
+	}
+
+	pthread_t *threads = malloc ( sizeof ( pthread_t ) * numThreads );
+	int num_started = 0;
+
+	/* If a thread cannot be started the caller works the queue itself */
+	for ( int i = 0; i < numThreads; i++ ) {
+		if ( pthread_create ( &threads[num_started], NULL, &heatmapWorker_function, job ) == 0 ) {
+			num_started = num_started + 1;
+		} else {
+			heatmapWorker_function ( job );
+		}
+	}
+
+	for ( int i = 0; i < num_started; i++ ) {
+		pthread_join ( threads[i], NULL );
+	}
+
+	free ( threads );
+
+}
+
+/* Counts every route and track point of doc into heatmap, one waypoint list at a time per thread */
+void heatmapAccumulate ( Heatmap *heatmap, const GPXdoc *doc, int numThreads ) {
+
+	if ( heatmap == NULL || doc == NULL ) {
+		return;
+	}
+
+	HeatmapJob job = { 0 };
+
+	job.result = heatmap;
+	job.lists = malloc ( sizeof ( List * ) * ( getNumRoutes ( doc ) + getNumSegments ( doc ) + 1 ) );
+	pthread_mutex_init ( &job.lock, NULL );
+
+	ListIterator route_iter = createIterator ( doc->routes );
+	Route *my_route = nextElement ( &route_iter );
+
+	while ( my_route != NULL ) {
+		job.lists[job.num_lists++] = my_route->waypoints;
+		my_route = nextElement ( &route_iter );
+	}
+
+	ListIterator track_iter = createIterator ( doc->tracks );
+	Track *my_track = nextElement ( &track_iter );
+
+	while ( my_track != NULL ) {
+
+		ListIterator segment_iter = createIterator ( my_track->segments );
+		TrackSegment *my_segment = nextElement ( &segment_iter );
+
+		while ( my_segment != NULL ) {
+			job.lists[job.num_lists++] = my_segment->waypoints;
+			my_segment = nextElement ( &segment_iter );
+		}
+
+		my_track = nextElement ( &track_iter );
+
+	}
+
+	runHeatmapJob ( &job, numThreads );
+
+	pthread_mutex_destroy ( &job.lock );
+	free ( job.lists );
+
+}
+
+Heatmap *heatmapDocument ( const GPXdoc *doc, int zoom, int resolution, int numThreads ) {
+
+	if ( doc == NULL ) {
+		return NULL;
+	}
+
+	Heatmap *my_heatmap = heatmap_function ( zoom, resolution );
+	heatmapAccumulate ( my_heatmap, doc, numThreads );
+
+	return my_heatmap;
+
+}
+
+/* fileNames is the "!" separated list the web app builds. Parsing stays on this thread because
+   createValidGPXdoc tears down the libxml2 globals when it finishes */
+Heatmap *heatmapFiles ( char *fileNames, char *gpxSchemaFile, int zoom, int resolution, int numThreads ) {
+
+	if ( fileNames == NULL ) {
+		return NULL;
+	}
+
+	Heatmap *my_heatmap = heatmap_function ( zoom, resolution );
+
+	char *names = malloc ( strlen ( fileNames ) + 1 );
+	strcpy ( names, fileNames );
+
+	char *save = NULL;
+	char *name = strtok_r ( names, "!", &save );
+
+	while ( name != NULL ) {
+
+		GPXdoc *my_doc = createValidGPXdoc ( name, gpxSchemaFile );
+
+		if ( my_doc != NULL ) {
+			heatmapAccumulate ( my_heatmap, my_doc, numThreads );
+			heatmapIncludeFile ( my_heatmap, name );
+			deleteGPXdoc ( my_doc );
+		}
+
+		name = strtok_r ( NULL, "!", &save );
+
+	}
+
+	free ( names );
+
+	return my_heatmap;
+
+}
+
+bool saveHeatmap ( const Heatmap *heatmap, const char *heatmapFile ) {
+
+	if ( heatmap == NULL || heatmapFile == NULL ) {
+		return false;
+	}
+
+	char *temp_name = malloc ( strlen ( heatmapFile ) + 5 );
+	sprintf ( temp_name, "%s.tmp", heatmapFile );
+
+	FILE *fp = fopen ( temp_name, "wb" );
+
+	if ( fp == NULL ) {
+		free ( temp_name );
+		return false;
+	}
+
+	int pixels = heatmap->resolution * heatmap->resolution;
+
+	fwrite ( "GPXH", 1, 4, fp );
+	fwrite ( &heatmap->zoom, sizeof ( int ), 1, fp );
+	fwrite ( &heatmap->resolution, sizeof ( int ), 1, fp );
+	fwrite ( &heatmap->num_files, sizeof ( int ), 1, fp );
+
+	for ( int i = 0; i < heatmap->num_files; i++ ) {
+		int name_len = strlen ( heatmap->fileNames[i] );
+		fwrite ( &name_len, sizeof ( int ), 1, fp );
+		fwrite ( heatmap->fileNames[i], 1, name_len, fp );
+	}
+
+	fwrite ( &heatmap->num_tiles, sizeof ( int ), 1, fp );
+
+	for ( int i = 0; i < heatmap->capacity; i++ ) {
+		if ( heatmap->tiles[i].counts != NULL ) {
+			fwrite ( &heatmap->tiles[i].x, sizeof ( int ), 1, fp );
+			fwrite ( &heatmap->tiles[i].y, sizeof ( int ), 1, fp );
+			fwrite ( heatmap->tiles[i].counts, sizeof ( uint32_t ), pixels, fp );
+		}
+	}
+
+	bool written = ferror ( fp ) == 0;
+
+	if ( fclose ( fp ) != 0 ) {
+		written = false;
+	}
+
+	if ( written ) {
+		written = rename ( temp_name, heatmapFile ) == 0;
+	} else {
+		remove ( temp_name );
+	}
+
+	free ( temp_name );
+
+	return written;
+
+}
+
+Heatmap *loadHeatmap ( const char *heatmapFile ) {
+
+	FILE *fp = heatmapFile == NULL ? NULL : fopen ( heatmapFile, "rb" );
+
+	if ( fp == NULL ) {
+		return NULL;
+	}
+
+	char magic[4];
+	int zoom = 0;
+	int resolution = 0;
+	int num_files = 0;
+
+	if ( fread ( magic, 1, 4, fp ) != 4 || memcmp ( magic, "GPXH", 4 ) != 0 || fread ( &zoom, sizeof ( int ), 1, fp ) != 1 || fread ( &resolution, sizeof ( int ), 1, fp ) != 1 || fread ( &num_files, sizeof ( int ), 1, fp ) != 1 || zoom < 0 || zoom > 22 || resolution < 1 || resolution > 4096 ) {
+		fclose ( fp );
+		return NULL;
+	}
+
+	Heatmap *my_heatmap = heatmap_function ( zoom, resolution );
+	bool ok = true;
+
+	for ( int i = 0; ok && i < num_files; i++ ) {
+
+		int name_len = 0;
+
+		if ( fread ( &name_len, sizeof ( int ), 1, fp ) != 1 || name_len < 0 || name_len > 4096 ) {
+			ok = false;
+			break;
+		}
+
+		char *name = malloc ( name_len + 1 );
+		ok = fread ( name, 1, name_len, fp ) == (size_t) name_len;
+		name[name_len] = '\0';
+
+		if ( ok ) {
+			heatmapIncludeFile ( my_heatmap, name );
+		}
+
+		free ( name );
+
+	}
+
+	int num_tiles = 0;
+	int pixels = resolution * resolution;
+
+	if ( ok && fread ( &num_tiles, sizeof ( int ), 1, fp ) != 1 ) {
+		ok = false;
+	}
+
+	for ( int i = 0; ok && i < num_tiles; i++ ) {
+
+		int x = 0;
+		int y = 0;
+
+		if ( fread ( &x, sizeof ( int ), 1, fp ) != 1 || fread ( &y, sizeof ( int ), 1, fp ) != 1 ) {
+			ok = false;
+			break;
+		}
+
+		HeatTile *my_tile = heatTile_function ( my_heatmap, x, y );
+		ok = fread ( my_tile->counts, sizeof ( uint32_t ), pixels, fp ) == (size_t) pixels;
+
+	}
+
+	fclose ( fp );
+
+	if ( !ok ) {
+		deleteHeatmap ( my_heatmap );
+		return NULL;
+	}
+
+	return my_heatmap;
+
+}
+
+char *heatmapTileToJSON ( const Heatmap *heatmap, int x, int y ) {
+
+	if ( heatmap == NULL ) {
+		return NULL;
+	}
+
+	const HeatTile *my_tile = findHeatTile ( heatmap, x, y );
+	int pixels = heatmap->resolution * heatmap->resolution;
+
+	char *tmpStr = malloc ( ( my_tile == NULL ? 0 : pixels * 11 ) + 150 );
+	int len = sprintf ( tmpStr, "{\"zoom\":%d,\"x\":%d,\"y\":%d,\"resolution\":%d,\"counts\":[", heatmap->zoom, x, y, heatmap->resolution );
+
+	for ( int i = 0; my_tile != NULL && i < pixels; i++ ) {
+		len = len + sprintf ( tmpStr + len, "%s%u", i == 0 ? "" : ",", my_tile->counts[i] );
+	}
+
+	strcpy ( tmpStr + len, "]}" );
+
+	return tmpStr;
+
+}
+
+int rebuildHeatmap ( char* heatmapFile, char* fileNames, char* gpxSchemaFile, int zoom, int resolution, int numThreads ) {
+
+	Heatmap *my_heatmap = heatmapFiles ( fileNames, gpxSchemaFile, zoom, resolution, numThreads );
+
+	if ( my_heatmap == NULL ) {
+		return -1;
+	}
+
+	bool written = saveHeatmap ( my_heatmap, heatmapFile );
+	deleteHeatmap ( my_heatmap );
+
+	return written ? 1 : -1;
+
+}
+
+/* 1 when fileName was added, 0 when it is already counted or no heatmap of this zoom and resolution is saved (a full rebuild is needed), -1 on error */
+int addFileToHeatmap ( char* heatmapFile, char* fileName, char* gpxSchemaFile, int zoom, int resolution ) {
+
+	Heatmap *my_heatmap = loadHeatmap ( heatmapFile );
+
+	/* Starting a fresh heatmap here would drop every file counted before */
+	if ( my_heatmap == NULL || my_heatmap->zoom != zoom || my_heatmap->resolution != resolution ) {
+		deleteHeatmap ( my_heatmap );
+		return 0;
+	}
+
+	if ( heatmapHasFile ( my_heatmap, fileName ) ) {
+		deleteHeatmap ( my_heatmap );
+		return 0;
+	}
+
+	GPXdoc *my_doc = createValidGPXdoc ( fileName, gpxSchemaFile );
+
+	if ( my_doc == NULL ) {
+		deleteHeatmap ( my_heatmap );
+		return -1;
+	}
+
+	heatmapAddDocument ( my_heatmap, my_doc );
+	heatmapIncludeFile ( my_heatmap, fileName );
+	deleteGPXdoc ( my_doc );
+
+	bool written = saveHeatmap ( my_heatmap, heatmapFile );
+	deleteHeatmap ( my_heatmap );
+
+	return written ? 1 : -1;
+
+}
+
+/* Counts the last route of fileName, the one addRouteToGPX just appended, into the saved heatmap; returns as addFileToHeatmap */
+int addRouteToHeatmap ( char* heatmapFile, char* fileName, char* gpxSchemaFile, int zoom, int resolution ) {
+
+	Heatmap *my_heatmap = loadHeatmap ( heatmapFile );
+
+	if ( my_heatmap == NULL || my_heatmap->zoom != zoom || my_heatmap->resolution != resolution ) {
+		deleteHeatmap ( my_heatmap );
+		return 0;
+	}
+
+	/* A file not counted yet is counted whole, new route included */
+	if ( !heatmapHasFile ( my_heatmap, fileName ) ) {
+		deleteHeatmap ( my_heatmap );
+		return addFileToHeatmap ( heatmapFile, fileName, gpxSchemaFile, zoom, resolution );
+	}
+
+	GPXdoc *my_doc = createValidGPXdoc ( fileName, gpxSchemaFile );
+
+	if ( my_doc == NULL || getLength ( my_doc->routes ) == 0 ) {
+		deleteGPXdoc ( my_doc );
+		deleteHeatmap ( my_heatmap );
+		return -1;
+	}
+
+	Route *my_route = getFromBack ( my_doc->routes );
+
+	heatmapAddWaypoints ( my_heatmap, my_route->waypoints );
+	deleteGPXdoc ( my_doc );
+
+	bool written = saveHeatmap ( my_heatmap, heatmapFile );
+	deleteHeatmap ( my_heatmap );
+
+	return written ? 1 : -1;
+
+}
+
+char *getHeatmapTile ( char* heatmapFile, int x, int y ) {
+
+	Heatmap *my_heatmap = loadHeatmap ( heatmapFile );
+
+	if ( my_heatmap == NULL ) {
+		return NULL;
+	}
+
+	char *JSON_return = heatmapTileToJSON ( my_heatmap, x, y );
+	deleteHeatmap ( my_heatmap );
+
+	return JSON_return;
+
+}
+
+/* Row and column of the geohash precision 5 cell holding the point */
+void geoCell_function ( double latitude, double longitude, int cell[2] ) {
+
+	cell[0] = ( latitude + 90 ) / ( 180.0 / ( 1 << 12 ) );
+	cell[1] = ( longitude + 180 ) / ( 360.0 / ( 1 << 13 ) );
+
+}
+
+double localDistance_function ( double lat1, double lon1, double lat2, double lon2, double scale ) {
+
+	double dx = ( lon1 - lon2 ) * scale;
+	double dy = lat1 - lat2;
+
+	return sqrt ( dx * dx + dy * dy ) * ( 3.1415926536 / 180 ) * 6371000;
+
+}
+
+TrackFingerprint *fingerprintTrack ( const Track *tr, const char *label ) {
+
+	if ( tr == NULL ) {
+		return NULL;
+	}
+
+	PointArray *my_points = trackToPointArray ( tr );
+
+	if ( my_points->length == 0 ) {
+		deletePointArray ( my_points );
+		return NULL;
+	}
+
+	TrackFingerprint *my_print = malloc ( sizeof ( TrackFingerprint ) );
+
+	my_print->label = malloc ( strlen ( label ) + 1 );
+	strcpy ( my_print->label, label );
+	my_print->points = my_points;
+	my_print->length = getTrackLen ( tr );
+	my_print->length_bucket = log ( my_print->length + 1 ) / log ( 1 + DUP_LENGTH_SLACK );
+
+	geoCell_function ( my_points->latitude[0], my_points->longitude[0], my_print->start_cell );
+	geoCell_function ( my_points->latitude[my_points->length - 1], my_points->longitude[my_points->length - 1], my_print->end_cell );
+
+	/* Points at equal fractions of the length; short tracks repeat their last point */
+	PointArray *shape = resamplePoints ( my_points, my_print->length / ( DUP_SHAPE_POINTS - 1 ) + 0.001 );
+
+	for ( int i = 0; i < DUP_SHAPE_POINTS; i++ ) {
+		int index = i < shape->length ? i : shape->length - 1;
+		my_print->shape[i * 2] = shape->latitude[index];
+		my_print->shape[i * 2 + 1] = shape->longitude[index];
+	}
+
+	deletePointArray ( shape );
+
+	return my_print;
+
+}
+
+void deleteTrackFingerprint ( TrackFingerprint *print ) {
+
+	if ( print == NULL ) {
+		return;
+	}
+
+	free ( print->label );
+	deletePointArray ( print->points );
+	free ( print );
+
+}
+
+/* Decision form of the discrete Frechet distance, only walking the reachable band of each row */
+bool frechetWithin ( const PointArray *a, const PointArray *b, double tolerance ) {
+
+	if ( a == NULL || b == NULL || a->length == 0 || b->length == 0 ) {
+		return false;
+	}
+
+	double scale = cos ( a->latitude[0] * ( 3.1415926536 / 180 ) );
+	int m = b->length;
+
+	char *previous = calloc ( m, 1 );
+	char *current = calloc ( m, 1 );
+
+	int lo = 0;
+	int hi = -1;
+
+	/* First row: reachable along b while the first point of a stays close */
+	for ( int j = 0; j < m; j++ ) {
+		if ( localDistance_function ( a->latitude[0], a->longitude[0], b->latitude[j], b->longitude[j], scale ) > tolerance ) {
+			break;
+		}
+		previous[j] = 1;
+		hi = j;
+	}
+
+	for ( int i = 1; i < a->length && hi >= lo; i++ ) {
+
+		int new_lo = -1;
+		int new_hi = -1;
+
+		for ( int j = lo; j < m; j++ ) {
+
+			bool from_above = j <= hi && previous[j];
+			bool from_diagonal = j > lo && j - 1 <= hi && previous[j - 1];
+			bool from_left = j > lo && current[j - 1];
+
+			current[j] = 0;
+
+			if ( !from_above && !from_diagonal && !from_left ) {
+				if ( j > hi ) {
+					break;
+				}
+				continue;
+			}
+
+			if ( localDistance_function ( a->latitude[i], a->longitude[i], b->latitude[j], b->longitude[j], scale ) <= tolerance ) {
+
+				current[j] = 1;
+
+				if ( new_lo == -1 ) {
+					new_lo = j;
+				}
+				new_hi = j;
+
+			} else if ( j > hi ) {
+				break;
+			}
+
+		}
+
+		char *temp = previous;
+		previous = current;
+		current = temp;
+
+		lo = new_lo;
+		hi = new_hi;
+
+		if ( new_lo == -1 ) {
+			break;
+		}
+
+	}
+
+	bool within = hi == m - 1 && previous[m - 1];
+
+	free ( previous );
+	free ( current );
+
+	return within;
+
+}
+
+/* Cheap filters in order of cost: length bucket, endpoint cells, shape points */
+bool duplicateCandidate ( const TrackFingerprint *a, const TrackFingerprint *b, double tolerance ) {
+
+	if ( abs ( a->length_bucket - b->length_bucket ) > 1 ) {
+		return false;
+	}
+
+	if ( abs ( a->start_cell[0] - b->start_cell[0] ) > 1 || abs ( a->start_cell[1] - b->start_cell[1] ) > 1 || abs ( a->end_cell[0] - b->end_cell[0] ) > 1 || abs ( a->end_cell[1] - b->end_cell[1] ) > 1 ) {
+		return false;
+	}
+
+	double scale = cos ( a->shape[0] * ( 3.1415926536 / 180 ) );
+	double slack = tolerance + ( a->length > b->length ? a->length : b->length ) * DUP_LENGTH_SLACK;
+
+	for ( int i = 0; i < DUP_SHAPE_POINTS; i++ ) {
+		if ( localDistance_function ( a->shape[i * 2], a->shape[i * 2 + 1], b->shape[i * 2], b->shape[i * 2 + 1], scale ) > slack ) {
+			return false;
+		}
+	}
+
+	return true;
+
+}
+
+int compareFingerprintLength ( const void *first, const void *second ) {
+
+	const TrackFingerprint *a = *(TrackFingerprint * const *) first;
+	const TrackFingerprint *b = *(TrackFingerprint * const *) second;
+
+	return ( a->length > b->length ) - ( a->length < b->length );
+
+}
+
+/* JSON list of every pair of tracks whose Frechet distance is within tolerance metres */
+char *findDuplicateTracks ( TrackFingerprint **prints, int num_prints, double tolerance ) {
+
+	qsort ( prints, num_prints, sizeof ( TrackFingerprint * ), &compareFingerprintLength );
+
+	int size = 256;
+	int len = 0;
+	char *tmpStr = malloc ( size );
+
+	tmpStr[len++] = '[';
+
+	for ( int i = 0; i < num_prints; i++ ) {
+
+		/* Sorted by length, so only the following tracks within one bucket can match */
+		for ( int j = i + 1; j < num_prints && prints[j]->length_bucket - prints[i]->length_bucket <= 1; j++ ) {
+
+			if ( !duplicateCandidate ( prints[i], prints[j], tolerance ) ) {
+				continue;
+			}
+
+			if ( !frechetWithin ( prints[i]->points, prints[j]->points, tolerance ) ) {
+				continue;
+			}
+
+			const char *first = prints[i]->label;
+			const char *second = prints[j]->label;
+			const char *first_track = strchr ( first, '!' );
+			const char *second_track = strchr ( second, '!' );
+
+			int needed = len + 6 * ( strlen ( first ) + strlen ( second ) ) + 100;
+
+			if ( needed > size ) {
+				size = needed * 2;
+				tmpStr = realloc ( tmpStr, size );
+			}
+
+			char *first_file = strndup ( first, first_track - first );
+			char *second_file = strndup ( second, second_track - second );
+
+			len = len + sprintf ( tmpStr + len, "%s{\"first\":", len > 1 ? "," : "" );
+			len = len + jsonString_function ( tmpStr + len, first_file );
+			len = len + sprintf ( tmpStr + len, ",\"firstTrack\":\"%s\",\"second\":", first_track + 1 );
+			len = len + jsonString_function ( tmpStr + len, second_file );
+			len = len + sprintf ( tmpStr + len, ",\"secondTrack\":\"%s\"}", second_track + 1 );
+
+			free ( first_file );
+			free ( second_file );
+
+		}
+
+	}
+
+	tmpStr[len++] = ']';
+	tmpStr[len] = '\0';
+
+	return tmpStr;
+
+}
+
+char *getDuplicateTracks ( char* fileNames, char* gpxSchemaFile, float tolerance ) {
+
+	if ( fileNames == NULL ) {
+		return NULL;
+	}
+
+	int num_prints = 0;
+	int capacity = 64;
+	TrackFingerprint **prints = malloc ( sizeof ( TrackFingerprint * ) * capacity );
+
+	char *names = malloc ( strlen ( fileNames ) + 1 );
+	strcpy ( names, fileNames );
+
+	char *save = NULL;
+	char *name = strtok_r ( names, "!", &save );
+
+	while ( name != NULL ) {
+
+		GPXdoc *my_doc = createValidGPXdoc ( name, gpxSchemaFile );
+
+		if ( my_doc != NULL ) {
+
+			ListIterator track_iter = createIterator ( my_doc->tracks );
+			Track *my_track = nextElement ( &track_iter );
+
+			for ( int i = 1; my_track != NULL; i++ ) {
+
+				char *label = malloc ( strlen ( name ) + 30 );
+				sprintf ( label, "%s!Track %d", name, i );
+
+				TrackFingerprint *my_print = fingerprintTrack ( my_track, label );
+
+				if ( my_print != NULL ) {
+
+					if ( num_prints == capacity ) {
+						capacity = capacity * 2;
+						prints = realloc ( prints, sizeof ( TrackFingerprint * ) * capacity );
+					}
+
+					prints[num_prints++] = my_print;
+
+				}
+
+				free ( label );
+				my_track = nextElement ( &track_iter );
+
+			}
+
+			deleteGPXdoc ( my_doc );
+
+		}
+
+		name = strtok_r ( NULL, "!", &save );
+
+	}
+
+	char *JSON_return = findDuplicateTracks ( prints, num_prints, tolerance );
+
+	for ( int i = 0; i < num_prints; i++ ) {
+		deleteTrackFingerprint ( prints[i] );
+	}
+
+	free ( prints );
+	free ( names );
+
+	return JSON_return;
+
+}
+
+int graphFind_function ( int *parent, int vertex ) {
+
+	while ( parent[vertex] != vertex ) {
+		parent[vertex] = parent[parent[vertex]];
+		vertex = parent[vertex];
+	}
+
+	return vertex;
+
+}
+
+/* Cell of the ROUTE_SNAP sized 3D grid over unit vectors, packed as 21 bits per axis */
+uint64_t snapCell_function ( const double vector[3], int dx, int dy, int dz ) {
+
+	double cells = 6371000.0 / ROUTE_SNAP;
+
+	uint64_t x = (uint64_t) ( (int64_t) floor ( vector[0] * cells ) + dx + ( 1 << 20 ) ) & 0x1FFFFF;
+	uint64_t y = (uint64_t) ( (int64_t) floor ( vector[1] * cells ) + dy + ( 1 << 20 ) ) & 0x1FFFFF;
+	uint64_t z = (uint64_t) ( (int64_t) floor ( vector[2] * cells ) + dz + ( 1 << 20 ) ) & 0x1FFFFF;
+
+	return ( x << 42 ) | ( y << 21 ) | z;
+
+}
+
+void graphPolyline_function ( RouteGraph *graph, PointArray *points, const char *fileName, const char *type, int number ) {
+
+	if ( points == NULL || points->length == 0 ) {
+		deletePointArray ( points );
+		return;
+	}
+
+	graph->polylines = realloc ( graph->polylines, sizeof ( PointArray * ) * ( graph->num_polylines + 1 ) );
+	graph->labels = realloc ( graph->labels, sizeof ( char * ) * ( graph->num_polylines + 1 ) );
+
+	char *label = malloc ( strlen ( fileName ) + strlen ( type ) + 20 );
+	sprintf ( label, "%s!%s %d", fileName, type, number );
+
+	graph->polylines[graph->num_polylines] = points;
+	graph->labels[graph->num_polylines] = label;
+	graph->num_polylines = graph->num_polylines + 1;
+
+}
+
+int compareRouteSplits ( const void *first, const void *second ) {
+
+	const RouteSplit *a = first;
+	const RouteSplit *b = second;
+
+	if ( a->polyline != b->polyline ) {
+		return a->polyline - b->polyline;
+	}
+
+	if ( a->index != b->index ) {
+		return a->index - b->index;
+	}
+
+	return ( a->offset > b->offset ) - ( a->offset < b->offset );
+
+}
+
+/* Adds each crossing of two different routes or tracks as a point of both, so crossings between sparse vertices still snap into a node */
+void splitRouteCrossings_function ( RouteGraph *graph ) {
+
+	int num_vertices = 0;
+
+	for ( int i = 0; i < graph->num_polylines; i++ ) {
+		num_vertices = num_vertices + graph->polylines[i]->length;
+	}
+
+	/* Only the points, segments and labels are read by the intersection engine */
+	SpatialIndex my_index = { 0 };
+
+	my_index.points = pointArray_function ( num_vertices );
+	my_index.segments = malloc ( sizeof ( SpatialSegment ) * ( graph->num_polylines + 1 ) );
+	my_index.components = graph->labels;
+	my_index.num_components = graph->num_polylines;
+
+	for ( int i = 0; i < graph->num_polylines; i++ ) {
+
+		const PointArray *points = graph->polylines[i];
+
+		my_index.segments[i].start = my_index.points->length;
+		my_index.segments[i].component = i;
+
+		for ( int j = 0; j < points->length; j++ ) {
+			addPoint ( my_index.points, points->latitude[j], points->longitude[j] );
+		}
+
+		my_index.segments[i].end = my_index.points->length;
+		my_index.num_segments = my_index.num_segments + 1;
+
+	}
+
+	int num_found = 0;
+	Intersection *found = findIntersections_function ( &my_index, false, &num_found );
+
+	RouteSplit *splits = malloc ( sizeof ( RouteSplit ) * ( 2 * num_found + 1 ) );
+	int num_splits = 0;
+
+	for ( int k = 0; k < num_found; k++ ) {
+
+		if ( found[k].component_a == found[k].component_b ) {
+			continue;
+		}
+
+		int polyline[2] = { found[k].component_a, found[k].component_b };
+		int index[2] = { found[k].index_a, found[k].index_b };
+
+		for ( int side = 0; side < 2; side++ ) {
+
+			const PointArray *points = graph->polylines[polyline[side]];
+			double d_lat = found[k].latitude - points->latitude[index[side]];
+			double d_lon = found[k].longitude - points->longitude[index[side]];
+
+			splits[num_splits++] = (RouteSplit) { polyline[side], index[side], d_lat * d_lat + d_lon * d_lon, found[k].latitude, found[k].longitude };
+
+		}
+
+	}
+
+	/* Rebuild each crossed polyline with its crossings in order along every edge */
+	qsort ( splits, num_splits, sizeof ( RouteSplit ), compareRouteSplits );
+
+	for ( int start = 0, end = 0; start < num_splits; start = end ) {
+
+		while ( end < num_splits && splits[end].polyline == splits[start].polyline ) {
+			end++;
+		}
+
+		PointArray *points = graph->polylines[splits[start].polyline];
+		PointArray *my_points = pointArray_function ( points->length + end - start );
+		int s = start;
+
+		for ( int j = 0; j < points->length; j++ ) {
+
+			addPoint ( my_points, points->latitude[j], points->longitude[j] );
+
+			while ( s < end && splits[s].index == j ) {
+				addPoint ( my_points, splits[s].latitude, splits[s].longitude );
+				s++;
+			}
+
+		}
+
+		deletePointArray ( points );
+		graph->polylines[splits[start].polyline] = my_points;
+
+	}
+
+	free ( splits );
+	free ( found );
+	free ( my_index.segments );
+	deletePointArray ( my_index.points );
+
+}
+
+/* Nodes are polyline ends plus points where different routes or tracks cross or come within ROUTE_SNAP metres */
+void buildRouteGraphEdges ( RouteGraph *graph ) {
+
+	splitRouteCrossings_function ( graph );
+
+	int num_vertices = 0;
+
+	for ( int i = 0; i < graph->num_polylines; i++ ) {
+		num_vertices = num_vertices + graph->polylines[i]->length;
+	}
+
+	int *owner = malloc ( sizeof ( int ) * ( num_vertices + 1 ) );
+	int *first_vertex = malloc ( sizeof ( int ) * ( graph->num_polylines + 1 ) );
+	double *vectors = malloc ( sizeof ( double ) * 3 * ( num_vertices + 1 ) );
+	int *parent = malloc ( sizeof ( int ) * ( num_vertices + 1 ) );
+	bool *junction = calloc ( num_vertices + 1, sizeof ( bool ) );
+
+	int v = 0;
+
+	for ( int i = 0; i < graph->num_polylines; i++ ) {
+
+		first_vertex[i] = v;
+
+		for ( int j = 0; j < graph->polylines[i]->length; j++, v++ ) {
+			owner[v] = i;
+			parent[v] = v;
+			unitVector_function ( graph->polylines[i]->latitude[j], graph->polylines[i]->longitude[j], &vectors[v * 3] );
+		}
+
+		junction[first_vertex[i]] = true;
+		junction[v - 1] = true;
+
+	}
+
+	first_vertex[graph->num_polylines] = v;
+
+	/* Chain every vertex into an open addressing table of grid cells */
+	int capacity = 16;
+
+	while ( capacity < num_vertices * 2 ) {
+		capacity = capacity * 2;
+	}
+
+	uint64_t *cell_keys = malloc ( sizeof ( uint64_t ) * capacity );
+	int *cell_heads = malloc ( sizeof ( int ) * capacity );
+	int *next_in_cell = malloc ( sizeof ( int ) * ( num_vertices + 1 ) );
+
+	for ( int i = 0; i < capacity; i++ ) {
+		cell_heads[i] = -1;
+	}
+
+	for ( v = 0; v < num_vertices; v++ ) {
+
+		uint64_t key = snapCell_function ( &vectors[v * 3], 0, 0, 0 );
+		uint32_t slot = heatTileHash_function ( key >> 32, key ) & ( capacity - 1 );
+
+		while ( cell_heads[slot] != -1 && cell_keys[slot] != key ) {
+			slot = ( slot + 1 ) & ( capacity - 1 );
+		}
+
+		cell_keys[slot] = key;
+		next_in_cell[v] = cell_heads[slot];
+		cell_heads[slot] = v;
+
+	}
+
+	double snap = ROUTE_SNAP / 6371000.0;
+
+	for ( v = 0; v < num_vertices; v++ ) {
+		for ( int dx = -1; dx <= 1; dx++ ) {
+			for ( int dy = -1; dy <= 1; dy++ ) {
+				for ( int dz = -1; dz <= 1; dz++ ) {
+
+					uint64_t key = snapCell_function ( &vectors[v * 3], dx, dy, dz );
+					uint32_t slot = heatTileHash_function ( key >> 32, key ) & ( capacity - 1 );
+
+					while ( cell_heads[slot] != -1 && cell_keys[slot] != key ) {
+						slot = ( slot + 1 ) & ( capacity - 1 );
+					}
+
+					for ( int u = cell_heads[slot]; u != -1; u = next_in_cell[u] ) {
+
+						if ( u <= v || owner[u] == owner[v] ) {
+							continue;
+						}
+
+						double ex = vectors[u * 3] - vectors[v * 3];
+						double ey = vectors[u * 3 + 1] - vectors[v * 3 + 1];
+						double ez = vectors[u * 3 + 2] - vectors[v * 3 + 2];
+
+						if ( ex * ex + ey * ey + ez * ez <= snap * snap ) {
+							junction[u] = true;
+							junction[v] = true;
+							parent[graphFind_function ( parent, u )] = graphFind_function ( parent, v );
+						}
+
+					}
+
+				}
+			}
+		}
+	}
+
+	/* One node per group of snapped junction vertices */
+	int *node_of = malloc ( sizeof ( int ) * ( num_vertices + 1 ) );
+
+	graph->nodes = malloc ( sizeof ( RouteNode ) * ( num_vertices + 1 ) );
+	graph->num_nodes = 0;
+
+	for ( v = 0; v < num_vertices; v++ ) {
+		node_of[v] = -1;
+	}
+
+	for ( v = 0; v < num_vertices; v++ ) {
+
+		if ( !junction[v] ) {
+			continue;
+		}
+
+		int root = graphFind_function ( parent, v );
+
+		if ( node_of[root] == -1 ) {
+
+			node_of[root] = graph->num_nodes;
+
+			int index = v - first_vertex[owner[v]];
+			graph->nodes[graph->num_nodes].latitude = graph->polylines[owner[v]]->latitude[index];
+			graph->nodes[graph->num_nodes].longitude = graph->polylines[owner[v]]->longitude[index];
+			graph->nodes[graph->num_nodes].num_edges = 0;
+			graph->num_nodes = graph->num_nodes + 1;
+
+		}
+
+		node_of[v] = node_of[root];
+
+	}
+
+	/* Each piece of a polyline between junctions is an edge both ways */
+	RouteEdge *edges = malloc ( sizeof ( RouteEdge ) * 2 * ( num_vertices + 1 ) );
+	int *edge_from = malloc ( sizeof ( int ) * 2 * ( num_vertices + 1 ) );
+	int num_edges = 0;
+
+	for ( int i = 0; i < graph->num_polylines; i++ ) {
+
+		const PointArray *points = graph->polylines[i];
+		int previous = 0;
+		double length = 0;
+
+		for ( int j = 1; j < points->length; j++ ) {
+
+			length = length + kernelDistance_function ( graph->kernel, points->latitude[j - 1], points->longitude[j - 1], points->latitude[j], points->longitude[j] ) * 1000;
+
+			if ( !junction[first_vertex[i] + j] ) {
+				continue;
+			}
+
+			int from = node_of[first_vertex[i] + previous];
+			int to = node_of[first_vertex[i] + j];
+
+			if ( from != to ) {
+
+				edges[num_edges] = (RouteEdge) { to, i, previous, j, length };
+				edge_from[num_edges++] = from;
+
+				edges[num_edges] = (RouteEdge) { from, i, j, previous, length };
+				edge_from[num_edges++] = to;
+
+				graph->nodes[from].num_edges++;
+				graph->nodes[to].num_edges++;
+
+			}
+
+			previous = j;
+			length = 0;
+
+		}
+
+	}
+
+	/* Group edges by their start node */
+	graph->edges = malloc ( sizeof ( RouteEdge ) * ( num_edges + 1 ) );
+	graph->num_edges = num_edges;
+
+	int offset = 0;
+
+	for ( int i = 0; i < graph->num_nodes; i++ ) {
+		graph->nodes[i].first_edge = offset;
+		offset = offset + graph->nodes[i].num_edges;
+		graph->nodes[i].num_edges = 0;
+	}
+
+	for ( int e = 0; e < num_edges; e++ ) {
+		RouteNode *my_node = &graph->nodes[edge_from[e]];
+		graph->edges[my_node->first_edge + my_node->num_edges] = edges[e];
+		my_node->num_edges++;
+	}
+
+	free ( edges );
+	free ( edge_from );
+	free ( node_of );
+	free ( cell_keys );
+	free ( cell_heads );
+	free ( next_in_cell );
+	free ( junction );
+	free ( parent );
+	free ( vectors );
+	free ( first_vertex );
+	free ( owner );
+
+}
+
+/* fileNames is the "!" separated list the web app builds */
+RouteGraph *buildRouteGraph ( char *fileNames, char *gpxSchemaFile ) {
+
+	if ( fileNames == NULL ) {
+		return NULL;
+	}
+
+	RouteGraph *graph = calloc ( 1, sizeof ( RouteGraph ) );
+
+	graph->kernel = distance_kernel;
+
+	char *names = malloc ( strlen ( fileNames ) + 1 );
+	strcpy ( names, fileNames );
+
+	char *save = NULL;
+	char *name = strtok_r ( names, "!", &save );
+
+	while ( name != NULL ) {
+
+		GPXdoc *my_doc = createValidGPXdoc ( name, gpxSchemaFile );
+
+		if ( my_doc != NULL ) {
+
+			ListIterator route_iter = createIterator ( my_doc->routes );
+			Route *my_route = nextElement ( &route_iter );
+
+			for ( int i = 1; my_route != NULL; i++ ) {
+				graphPolyline_function ( graph, routeToPointArray ( my_route ), name, "Route", i );
+				my_route = nextElement ( &route_iter );
+			}
+
+			ListIterator track_iter = createIterator ( my_doc->tracks );
+			Track *my_track = nextElement ( &track_iter );
+
+			for ( int i = 1; my_track != NULL; i++ ) {
+				graphPolyline_function ( graph, trackToPointArray ( my_track ), name, "Track", i );
+				my_track = nextElement ( &track_iter );
+			}
+
+			deleteGPXdoc ( my_doc );
+
+		}
+
+		name = strtok_r ( NULL, "!", &save );
+
+	}
+
+	free ( names );
+
+	buildRouteGraphEdges ( graph );
+
+	return graph;
+
+}
+
+void deleteRouteGraph ( RouteGraph *graph ) {
+
+	if ( graph == NULL ) {
+		return;
+	}
+
+	for ( int i = 0; i < graph->num_polylines; i++ ) {
+		deletePointArray ( graph->polylines[i] );
+		free ( graph->labels[i] );
+	}
+
+	free ( graph->polylines );
+	free ( graph->labels );
+	free ( graph->nodes );
+	free ( graph->edges );
+	free ( graph );
+
+}
+
+int nearestRouteNode ( const RouteGraph *graph, float latitude, float longitude, float delta ) {
+
+	int best = -1;
+	float best_dist = delta;
+
+	for ( int i = 0; i < graph->num_nodes; i++ ) {
+
+		float dist = kernelDistance_function ( graph->kernel, latitude, longitude, graph->nodes[i].latitude, graph->nodes[i].longitude );
+
+		if ( dist <= best_dist ) {
+			best = i;
+			best_dist = dist;
+		}
+
+	}
+
+	return best;
+
+}
+
+/* A* from start to goal with the great-circle distance to goal as the heuristic; fills path_edges goal first */
+int routeGraphSearch ( const RouteGraph *graph, int start, int goal, int *path_edges ) {
+
+	int n = graph->num_nodes;
+
+	double *cost = malloc ( sizeof ( double ) * n );
+	int *via_edge = malloc ( sizeof ( int ) * n );
+	int *via_node = malloc ( sizeof ( int ) * n );
+	bool *closed = calloc ( n, sizeof ( bool ) );
+
+	for ( int i = 0; i < n; i++ ) {
+		cost[i] = HUGE_VAL;
+		via_edge[i] = -1;
+	}
+
+	/* Binary min-heap of (estimate, node) with stale entries skipped when popped */
+	int heap_size = 0;
+	int heap_capacity = 64;
+	double *heap_f = malloc ( sizeof ( double ) * heap_capacity );
+	int *heap_node = malloc ( sizeof ( int ) * heap_capacity );
+
+	cost[start] = 0;
+	heap_f[0] = 0;
+	heap_node[0] = start;
+	heap_size = 1;
+
+	while ( heap_size > 0 ) {
+
+		int node = heap_node[0];
+
+		heap_size = heap_size - 1;
+		double last_f = heap_f[heap_size];
+		int last_node = heap_node[heap_size];
+		int i = 0;
+
+		while ( i * 2 + 1 < heap_size ) {
+
+			int child = i * 2 + 1;
+
+			if ( child + 1 < heap_size && heap_f[child + 1] < heap_f[child] ) {
+				child++;
+			}
+			if ( heap_f[child] >= last_f ) {
+				break;
+			}
+
+			heap_f[i] = heap_f[child];
+			heap_node[i] = heap_node[child];
+			i = child;
+
+		}
+
+		heap_f[i] = last_f;
+		heap_node[i] = last_node;
+
+		if ( closed[node] ) {
+			continue;
+		}
+
+		closed[node] = true;
+
+		if ( node == goal ) {
+			break;
+		}
+
+		const RouteNode *my_node = &graph->nodes[node];
+
+		for ( int e = my_node->first_edge; e < my_node->first_edge + my_node->num_edges; e++ ) {
+
+			const RouteEdge *my_edge = &graph->edges[e];
+			double new_cost = cost[node] + my_edge->length;
+
+			if ( closed[my_edge->to] || new_cost >= cost[my_edge->to] ) {
+				continue;
+			}
+
+			cost[my_edge->to] = new_cost;
+			via_edge[my_edge->to] = e;
+			via_node[my_edge->to] = node;
+
+			double estimate = new_cost + kernelDistance_function ( graph->kernel, graph->nodes[my_edge->to].latitude, graph->nodes[my_edge->to].longitude, graph->nodes[goal].latitude, graph->nodes[goal].longitude ) * 1000;
+
+			if ( heap_size == heap_capacity ) {
+				heap_capacity = heap_capacity * 2;
+				heap_f = realloc ( heap_f, sizeof ( double ) * heap_capacity );
+				heap_node = realloc ( heap_node, sizeof ( int ) * heap_capacity );
+			}
+
+			int j = heap_size++;
+
+			while ( j > 0 && heap_f[( j - 1 ) / 2] > estimate ) {
+				heap_f[j] = heap_f[( j - 1 ) / 2];
+				heap_node[j] = heap_node[( j - 1 ) / 2];
+				j = ( j - 1 ) / 2;
+			}
+
+			heap_f[j] = estimate;
+			heap_node[j] = my_edge->to;
+
+		}
+
+	}
+
+	int num_path = -1;
+
+	if ( closed[goal] ) {
+
+		num_path = 0;
+
+		for ( int node = goal; node != start; node = via_node[node] ) {
+			path_edges[num_path++] = via_edge[node];
+		}
+
+	}
+
+	free ( heap_f );
+	free ( heap_node );
+	free ( closed );
+	free ( via_node );
+	free ( via_edge );
+	free ( cost );
+
+	return num_path;
+
+}
+
+/* JSON with the total length, the legs by route or track, and the points along the way; "" when there is no path */
+char *routeGraphPathToJSON ( const RouteGraph *graph, float start_lat, float start_lon, float end_lat, float end_lon, float delta ) {
+
+	char *JSON_return = NULL;
+
+	int start = nearestRouteNode ( graph, start_lat, start_lon, delta );
+	int goal = nearestRouteNode ( graph, end_lat, end_lon, delta );
+
+	int *path_edges = malloc ( sizeof ( int ) * ( graph->num_nodes + 1 ) );
+	int num_path = start == -1 || goal == -1 ? -1 : routeGraphSearch ( graph, start, goal, path_edges );
+
+	if ( num_path < 0 ) {
+		free ( path_edges );
+		JSON_return = malloc ( 1 );
+		JSON_return[0] = '\0';
+		return JSON_return;
+	}
+
+	double total = 0;
+	PointArray *my_points = pointArray_function ( 64 );
+
+	int size = 256;
+	int len = 0;
+	char *legs = malloc ( size );
+	legs[0] = '\0';
+
+	/* path_edges runs goal to start, so walk it backwards */
+	for ( int p = num_path - 1; p >= 0; p-- ) {
+
+		const RouteEdge *my_edge = &graph->edges[path_edges[p]];
+		const PointArray *points = graph->polylines[my_edge->polyline];
+		int step = my_edge->last > my_edge->first ? 1 : -1;
+
+		for ( int j = my_edge->first; j != my_edge->last + step; j = j + step ) {
+			if ( !( j == my_edge->first && my_points->length > 0 ) ) {
+				addPoint ( my_points, points->latitude[j], points->longitude[j] );
+			}
+		}
+
+		total = total + my_edge->length;
+
+		/* Consecutive edges along the same route or track form one leg */
+		double leg_length = my_edge->length;
+
+		while ( p > 0 && graph->edges[path_edges[p - 1]].polyline == my_edge->polyline ) {
+
+			p = p - 1;
+			my_edge = &graph->edges[path_edges[p]];
+			step = my_edge->last > my_edge->first ? 1 : -1;
+
+			for ( int j = my_edge->first + step; j != my_edge->last + step; j = j + step ) {
+				addPoint ( my_points, points->latitude[j], points->longitude[j] );
+			}
+
+			total = total + my_edge->length;
+			leg_length = leg_length + my_edge->length;
+
+		}
+
+		const char *label = graph->labels[my_edge->polyline];
+		const char *component = strchr ( label, '!' );
+
+		if ( len + strlen ( label ) + 100 > (size_t) size ) {
+			size = ( len + strlen ( label ) + 100 ) * 2;
+			legs = realloc ( legs, size );
+		}
+
+		len = len + sprintf ( legs + len, "%s{\"file\":\"%.*s\",\"component\":\"%s\",\"length\":%.1f}", len == 0 ? "" : ",", (int) ( component - label ), label, component + 1, leg_length );
+
+	}
+
+	char *points = pointArrayToJSON ( my_points );
+
+	JSON_return = malloc ( strlen ( legs ) + strlen ( points ) + 100 );
+	sprintf ( JSON_return, "{\"length\":%.1f,\"legs\":[%s],\"points\":%s}", total, legs, points );
+
+	free ( points );
+	free ( legs );
+	deletePointArray ( my_points );
+	free ( path_edges );
+
+	return JSON_return;
+
+}
+
+/* "name:mtime:size!" for every file, so any upload, edit or removal changes the key */
+char *routeGraphKey ( char *fileNames, char *gpxSchemaFile ) {
+
+	char *names = malloc ( strlen ( fileNames ) + 1 );
+	strcpy ( names, fileNames );
+
+	int size = strlen ( fileNames ) + strlen ( gpxSchemaFile ) + 64;
+	char *key = malloc ( size );
+	int len = sprintf ( key, "%s!", gpxSchemaFile );
+
+	char *save = NULL;
+	char *name = strtok_r ( names, "!", &save );
+
+	while ( name != NULL ) {
+
+		struct stat file_stat;
+
+		if ( stat ( name, &file_stat ) == 0 ) {
+
+			size = size + 64;
+			key = realloc ( key, size );
+			len = len + sprintf ( key + len, "%s:%lld:%lld!", name, (long long) fileStamp_function ( &file_stat ), (long long) file_stat.st_size );
+
+		}
+
+		name = strtok_r ( NULL, "!", &save );
+
+	}
+
+	free ( names );
+
+	return key;
+
+}
+
+/* The graph is rebuilt only when the set of files, any of their mtimes or the default kernel changes */
+char *findRoutePath ( char* fileNames, char* gpxSchemaFile, float start_lat, float start_lon, float end_lat, float end_lon, float delta ) {
+
+	if ( fileNames == NULL || gpxSchemaFile == NULL ) {
+		return NULL;
+	}
+
+	char *key = routeGraphKey ( fileNames, gpxSchemaFile );
+
+	pthread_mutex_lock ( &route_graph_cache.lock );
+
+	if ( route_graph_cache.key == NULL || strcmp ( route_graph_cache.key, key ) != 0 || route_graph_cache.graph->kernel != distance_kernel ) {
+
+		deleteRouteGraph ( route_graph_cache.graph );
+		free ( route_graph_cache.key );
+
+		route_graph_cache.graph = buildRouteGraph ( fileNames, gpxSchemaFile );
+		route_graph_cache.key = key;
+
+	} else {
+		free ( key );
+	}
+
+	char *JSON_return = routeGraphPathToJSON ( route_graph_cache.graph, start_lat, start_lon, end_lat, end_lon, delta );
+
+	pthread_mutex_unlock ( &route_graph_cache.lock );
+
+	return JSON_return;
+
+}
+
+void pathCandidate_function ( PathIndex *index, const char *type, const char *name, int num_points, float length, bool loop, double first_lat, double first_lon, double last_lat, double last_lon ) {
+
+	if ( index->num_candidates == index->capacity ) {
+		index->capacity = index->capacity * 2;
+		index->candidates = realloc ( index->candidates, sizeof ( PathCandidate ) * index->capacity );
+	}
+
+	PathCandidate *my_candidate = &index->candidates[index->num_candidates];
+
+	/* Same text getRoutesBetweenString and getTracksBetweenString print for a match */
+	my_candidate->summary = malloc ( strlen ( name ) + 100 );
+	sprintf ( my_candidate->summary, "%s !%s!%d!%.1f!%s!", type, name, num_points, length, loop ? "true" : "false" );
+
+	my_candidate->first_lat = first_lat;
+	my_candidate->first_lon = first_lon;
+	my_candidate->last_lat = last_lat;
+	my_candidate->last_lon = last_lon;
+
+	index->num_candidates = index->num_candidates + 1;
+
+}
+
+void pathIndexDocument ( PathIndex *index, const GPXdoc *doc ) {
+
+	ListIterator route_iter = createIterator ( doc->routes );
+	Route *my_route = nextElement ( &route_iter );
+
+	while ( my_route != NULL ) {
+
+		if ( getLength ( my_route->waypoints ) != 0 ) {
+
+			Waypoint *first = getFromFront ( my_route->waypoints );
+			Waypoint *last = getFromBack ( my_route->waypoints );
+
+			pathCandidate_function ( index, "Route", my_route->name, getLength ( my_route->waypoints ), round10 ( routeLenKernel ( my_route, index->kernel ) ), isLoopRouteKernel ( my_route, 10, index->kernel ), first->latitude, first->longitude, last->latitude, last->longitude );
+
+		}
+
+		my_route = nextElement ( &route_iter );
+
+	}
+
+	ListIterator track_iter = createIterator ( doc->tracks );
+	Track *my_track = nextElement ( &track_iter );
+
+	while ( my_track != NULL ) {
+
+		PointArray *my_points = trackToPointArray ( my_track );
+
+		if ( my_points->length != 0 ) {
+			pathCandidate_function ( index, "Track", my_track->name, getNumSegmentsWaypoints ( my_track ), round10 ( trackLenKernel ( my_track, index->kernel ) ), isLoopTrackKernel ( my_track, 10, index->kernel ), my_points->latitude[0], my_points->longitude[0], my_points->latitude[my_points->length - 1], my_points->longitude[my_points->length - 1] );
+		}
+
+		deletePointArray ( my_points );
+		my_track = nextElement ( &track_iter );
+
+	}
+
+}
+
+int compareLatitudeKeys ( const void *first, const void *second ) {
+
+	const LatitudeKey *a = first;
+	const LatitudeKey *b = second;
+
+	return ( a->latitude > b->latitude ) - ( a->latitude < b->latitude );
+
+}
+
+/* Every route and track end of every file, sorted by latitude so a query only checks a narrow band */
+PathIndex *buildPathIndex ( char *fileNames, char *gpxSchemaFile ) {
+
+	if ( fileNames == NULL ) {
+		return NULL;
+	}
+
+	PathIndex *index = malloc ( sizeof ( PathIndex ) );
+
+	index->kernel = distance_kernel;
+	index->num_candidates = 0;
+	index->capacity = 64;
+	index->candidates = malloc ( sizeof ( PathCandidate ) * index->capacity );
+
+	char *names = malloc ( strlen ( fileNames ) + 1 );
+	strcpy ( names, fileNames );
+
+	char *save = NULL;
+	char *name = strtok_r ( names, "!", &save );
+
+	while ( name != NULL ) {
+
+		GPXdoc *my_doc = createValidGPXdoc ( name, gpxSchemaFile );
+
+		if ( my_doc != NULL ) {
+			pathIndexDocument ( index, my_doc );
+			deleteGPXdoc ( my_doc );
+		}
+
+		name = strtok_r ( NULL, "!", &save );
+
+	}
+
+	free ( names );
+
+	index->by_first = malloc ( sizeof ( int ) * ( index->num_candidates + 1 ) );
+	index->by_last = malloc ( sizeof ( int ) * ( index->num_candidates + 1 ) );
+
+	LatitudeKey *keys = malloc ( sizeof ( LatitudeKey ) * ( index->num_candidates + 1 ) );
+
+	for ( int i = 0; i < index->num_candidates; i++ ) {
+		keys[i] = (LatitudeKey) { index->candidates[i].first_lat, i };
+	}
+
+	qsort ( keys, index->num_candidates, sizeof ( LatitudeKey ), &compareLatitudeKeys );
+
+	for ( int i = 0; i < index->num_candidates; i++ ) {
+		index->by_first[i] = keys[i].index;
+		keys[i] = (LatitudeKey) { index->candidates[i].last_lat, i };
+	}
+
+	qsort ( keys, index->num_candidates, sizeof ( LatitudeKey ), &compareLatitudeKeys );
+
+	for ( int i = 0; i < index->num_candidates; i++ ) {
+		index->by_last[i] = keys[i].index;
+	}
+
+	free ( keys );
+
+	return index;
+
+}
+
+void deletePathIndex ( PathIndex *index ) {
+
+	if ( index == NULL ) {
+		return;
+	}
+
+	for ( int i = 0; i < index->num_candidates; i++ ) {
+		free ( index->candidates[i].summary );
+	}
+
+	free ( index->candidates );
+	free ( index->by_first );
+	free ( index->by_last );
+	free ( index );
+
+}
+
+/* Marks candidates whose chosen end lies within delta km of the point, scanning only its latitude band */
+void pathIndexNear_function ( const PathIndex *index, bool first, float latitude, float longitude, float delta, bool *matched ) {
+
+	const int *order = first ? index->by_first : index->by_last;
+	double band = delta / 111.19 + 1e-6;
+
+	int lo = 0;
+	int hi = index->num_candidates;
+
+	while ( lo < hi ) {
+
+		int mid = ( lo + hi ) / 2;
+		const PathCandidate *my_candidate = &index->candidates[order[mid]];
+
+		if ( ( first ? my_candidate->first_lat : my_candidate->last_lat ) < latitude - band ) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+
+	}
+
+	for ( int i = lo; i < index->num_candidates; i++ ) {
+
+		const PathCandidate *my_candidate = &index->candidates[order[i]];
+		double lat = first ? my_candidate->first_lat : my_candidate->last_lat;
+		double lon = first ? my_candidate->first_lon : my_candidate->last_lon;
+
+		if ( lat > latitude + band ) {
+			break;
+		}
+
+		float dist = kernelDistance_function ( index->kernel, lat, lon, latitude, longitude );
+
+		if ( dist >= 0 && dist <= delta ) {
+			matched[order[i]] = true;
+		}
+
+	}
+
+}
+
+/* The /find_path result for one query: summaries of matching candidates in file, route, track order */
+char *pathQuery_function ( const PathIndex *index, const PathQuery *query ) {
+
+	bool *matched = calloc ( index->num_candidates + 1, sizeof ( bool ) );
+
+	pathIndexNear_function ( index, true, query->start_lat, query->start_lon, query->delta, matched );
+	pathIndexNear_function ( index, false, query->end_lat, query->end_lon, query->delta, matched );
+
+	int size = 1;
+
+	for ( int i = 0; i < index->num_candidates; i++ ) {
+		if ( matched[i] ) {
+			size = size + strlen ( index->candidates[i].summary );
+		}
+	}
+
+	char *result = malloc ( size );
+	int len = 0;
+
+	for ( int i = 0; i < index->num_candidates; i++ ) {
+		if ( matched[i] ) {
+			strcpy ( result + len, index->candidates[i].summary );
+			len = len + strlen ( index->candidates[i].summary );
+		}
+	}
+
+	result[len] = '\0';
+	free ( matched );
+
+	return result;
+
+}
+
+void *pathQueryWorker_function ( void *arg ) {
+
+	PathQueryJob *job = arg;
+
+	while ( 1 ) {
+
+		pthread_mutex_lock ( &job->lock );
+		int query = job->next_query < job->num_queries ? job->next_query++ : -1;
+		pthread_mutex_unlock ( &job->lock );
+
+		if ( query == -1 ) {
+			break;
+		}
+
+		if ( job->queries[query].valid ) {
+			job->queries[query].result = pathQuery_function ( job->index, &job->queries[query] );
+		}
+
+	}
+
+	return NULL;
+
+}
+
+void runPathQueries ( const PathIndex *index, PathQuery *queries, int num_queries, int numThreads ) {
+
+	PathQueryJob job = { index, queries, num_queries, 0, PTHREAD_MUTEX_INITIALIZER };
+
+	if ( numThreads < 1 ) {
+		numThreads = 1;
+	}
+
+	pthread_t *threads = malloc ( sizeof ( pthread_t ) * numThreads );
+	int num_started = 0;
+
+	/* If a thread cannot be started the caller works the queue itself */
+	for ( int i = 0; i < numThreads; i++ ) {
+		if ( pthread_create ( &threads[num_started], NULL, &pathQueryWorker_function, &job ) == 0 ) {
+			num_started = num_started + 1;
+		} else {
+			pathQueryWorker_function ( &job );
+		}
+	}
+
+	for ( int i = 0; i < num_started; i++ ) {
+		pthread_join ( threads[i], NULL );
+	}
+
+	free ( threads );
+
+}
+
+/* Copies text into out as a quoted JSON string; out needs room for 6 * strlen + 3 bytes */
+int jsonString_function ( char *out, const char *text ) {
+
+	int len = 0;
+
+	out[len++] = '"';
+
+	for ( int i = 0; text[i] != '\0'; i++ ) {
+
+		unsigned char c = text[i];
+
+		if ( c == '"' || c == '\\' ) {
+			out[len++] = '\\';
+			out[len++] = c;
+		} else if ( c == '\n' ) {
+			out[len++] = '\\';
+			out[len++] = 'n';
+		} else if ( c < 0x20 || c == 0x7f ) {
+			len = len + sprintf ( out + len, "\\u%04x", c );
+		} else {
+			out[len++] = c;
+		}
+
+	}
+
+	out[len++] = '"';
+	out[len] = '\0';
+
+	return len;
+
+}
+
+/* queries is "start_lat,start_lon,end_lat,end_lon,delta!" repeated; returns a JSON array with one /find_path string per query */
+char *batchPathFind ( char* fileNames, char* gpxSchemaFile, char* queries, int numThreads ) {
+
+	if ( fileNames == NULL || gpxSchemaFile == NULL || queries == NULL ) {
+		return NULL;
+	}
+
+	char *key = routeGraphKey ( fileNames, gpxSchemaFile );
+
+	pthread_mutex_lock ( &path_index_cache.lock );
+
+	if ( path_index_cache.key == NULL || strcmp ( path_index_cache.key, key ) != 0 || path_index_cache.index->kernel != distance_kernel ) {
+
+		deletePathIndex ( path_index_cache.index );
+		free ( path_index_cache.key );
+
+		path_index_cache.index = buildPathIndex ( fileNames, gpxSchemaFile );
+		path_index_cache.key = key;
+
+	} else {
+		free ( key );
+	}
+
+	int num_queries = 1;
+
+	for ( int i = 0; queries[i] != '\0'; i++ ) {
+		if ( queries[i] == '!' ) {
+			num_queries = num_queries + 1;
+		}
+	}
+
+	PathQuery *my_queries = malloc ( sizeof ( PathQuery ) * num_queries );
+
+	char *text = malloc ( strlen ( queries ) + 1 );
+	strcpy ( text, queries );
+
+	/* Every "!" separated query keeps its slot, so a malformed one answers null instead of shifting the rest */
+	char *query = text;
+	num_queries = 0;
+
+	while ( query != NULL ) {
+
+		char *next = strchr ( query, '!' );
+
+		/* Nothing follows the closing "!" */
+		if ( next == NULL && *query == '\0' ) {
+			break;
+		}
+
+		if ( next != NULL ) {
+			*next = '\0';
+			next = next + 1;
+		}
+
+		PathQuery *my_query = &my_queries[num_queries];
+
+		my_query->valid = sscanf ( query, "%f,%f,%f,%f,%f", &my_query->start_lat, &my_query->start_lon, &my_query->end_lat, &my_query->end_lon, &my_query->delta ) == 5;
+		my_query->result = NULL;
+		num_queries = num_queries + 1;
+
+		query = next;
+
+	}
+
+	runPathQueries ( path_index_cache.index, my_queries, num_queries, numThreads );
+
+	pthread_mutex_unlock ( &path_index_cache.lock );
+
+	int size = 3;
+
+	for ( int i = 0; i < num_queries; i++ ) {
+		size = size + ( my_queries[i].result == NULL ? 4 : strlen ( my_queries[i].result ) * 6 + 3 );
+	}
+
+	char *JSON_return = malloc ( size );
+	int len = 0;
+
+	JSON_return[len++] = '[';
+
+	for ( int i = 0; i < num_queries; i++ ) {
+
+		if ( i != 0 ) {
+			JSON_return[len++] = ',';
+		}
+
+		if ( my_queries[i].result == NULL ) {
+			len = len + sprintf ( JSON_return + len, "null" );
+		} else {
+			len = len + jsonString_function ( JSON_return + len, my_queries[i].result );
+			free ( my_queries[i].result );
+		}
+
+	}
+
+	JSON_return[len++] = ']';
+	JSON_return[len] = '\0';
+
+	free ( text );
+	free ( my_queries );
+
+	return JSON_return;
+
+}
+
+/* The cached index for fileNames, rebuilt when any file changes; call with spatial_index_cache.lock held */
+SpatialIndex *cachedSpatialIndex ( char* fileNames, char* gpxSchemaFile ) {
+
+	char *key = routeGraphKey ( fileNames, gpxSchemaFile );
+
+	if ( spatial_index_cache.key == NULL || strcmp ( spatial_index_cache.key, key ) != 0 ) {
+
+		deleteSpatialIndex ( spatial_index_cache.index );
+		free ( spatial_index_cache.key );
+
+		spatial_index_cache.index = buildSpatialIndex ( fileNames, gpxSchemaFile );
+		spatial_index_cache.key = key;
+
+	} else {
+		free ( key );
+	}
+
+	return spatial_index_cache.index;
+
+}
+
+double chordAngle_function ( const double p[3], const double q[3] ) {
+
+	double dx = p[0] - q[0];
+	double dy = p[1] - q[1];
+	double dz = p[2] - q[2];
+	double half = sqrt ( dx * dx + dy * dy + dz * dz ) / 2;
+
+	return 2 * asin ( half > 1 ? 1 : half );
+
+}
+
+CorridorEdge corridorEdge_function ( double lat1, double lon1, double lat2, double lon2, double distance ) {
+
+	CorridorEdge my_edge;
+
+	unitVector_function ( lat1, lon1, my_edge.a );
+	unitVector_function ( lat2, lon2, my_edge.b );
+
+	my_edge.normal[0] = my_edge.a[1] * my_edge.b[2] - my_edge.a[2] * my_edge.b[1];
+	my_edge.normal[1] = my_edge.a[2] * my_edge.b[0] - my_edge.a[0] * my_edge.b[2];
+	my_edge.normal[2] = my_edge.a[0] * my_edge.b[1] - my_edge.a[1] * my_edge.b[0];
+
+	double norm = sqrt ( my_edge.normal[0] * my_edge.normal[0] + my_edge.normal[1] * my_edge.normal[1] + my_edge.normal[2] * my_edge.normal[2] );
+
+	my_edge.degenerate = norm < 1e-12;
+
+	for ( int i = 0; i < 3 && !my_edge.degenerate; i++ ) {
+		my_edge.normal[i] = my_edge.normal[i] / norm;
+	}
+
+	double low_lat = lat1 < lat2 ? lat1 : lat2;
+	double high_lat = lat1 > lat2 ? lat1 : lat2;
+
+	/* The arc bulges toward the pole; its latitude extremes are where the great circle is closest to each pole, if they lie on the arc */
+	double top[3] = { -my_edge.normal[2] * my_edge.normal[0], -my_edge.normal[2] * my_edge.normal[1], 1 - my_edge.normal[2] * my_edge.normal[2] };
+	double top_norm = sqrt ( top[0] * top[0] + top[1] * top[1] + top[2] * top[2] );
+
+	for ( int side = 0; side < 2 && !my_edge.degenerate && top_norm > 1e-12; side++ ) {
+
+		double sign = side == 0 ? 1 : -1;
+		double p[3] = { sign * top[0] / top_norm, sign * top[1] / top_norm, sign * top[2] / top_norm };
+		const double *a = my_edge.a;
+		const double *b = my_edge.b;
+		const double *n = my_edge.normal;
+
+		double inside_a = ( a[1] * p[2] - a[2] * p[1] ) * n[0] + ( a[2] * p[0] - a[0] * p[2] ) * n[1] + ( a[0] * p[1] - a[1] * p[0] ) * n[2];
+		double inside_b = ( p[1] * b[2] - p[2] * b[1] ) * n[0] + ( p[2] * b[0] - p[0] * b[2] ) * n[1] + ( p[0] * b[1] - p[1] * b[0] ) * n[2];
+
+		if ( inside_a >= 0 && inside_b >= 0 ) {
+
+			double extreme = asin ( p[2] > 1 ? 1 : ( p[2] < -1 ? -1 : p[2] ) ) * ( 180 / 3.1415926536 );
+
+			low_lat = extreme < low_lat ? extreme : low_lat;
+			high_lat = extreme > high_lat ? extreme : high_lat;
+
+		}
+
+	}
+
+	/* Box of the arc grown by distance; the widest latitude sets how far a metre reaches in longitude */
+	double dlat = distance / 111195.0;
+	double widest = fabs ( low_lat ) > fabs ( high_lat ) ? fabs ( low_lat ) : fabs ( high_lat );
+	double scale = cos ( ( widest + dlat ) * ( 3.1415926536 / 180 ) );
+	double dlon = dlat / ( scale < 0.01 ? 0.01 : scale );
+
+	my_edge.box.min_lat = low_lat - dlat;
+	my_edge.box.max_lat = high_lat + dlat;
+	my_edge.box.min_lon = ( lon1 < lon2 ? lon1 : lon2 ) - dlon;
+	my_edge.box.max_lon = ( lon1 > lon2 ? lon1 : lon2 ) + dlon;
+
+	return my_edge;
+
+}
+
+/* Great-circle distance in metres from p to the arc a-b: cross-track when p projects inside the arc, else the nearer end */
+double pointSegmentDistance ( const double p[3], const CorridorEdge *edge ) {
+
+	if ( !edge->degenerate ) {
+
+		const double *a = edge->a;
+		const double *b = edge->b;
+		const double *n = edge->normal;
+
+		double inside_a = ( a[1] * p[2] - a[2] * p[1] ) * n[0] + ( a[2] * p[0] - a[0] * p[2] ) * n[1] + ( a[0] * p[1] - a[1] * p[0] ) * n[2];
+		double inside_b = ( p[1] * b[2] - p[2] * b[1] ) * n[0] + ( p[2] * b[0] - p[0] * b[2] ) * n[1] + ( p[0] * b[1] - p[1] * b[0] ) * n[2];
+
+		if ( inside_a >= 0 && inside_b >= 0 ) {
+			double s = p[0] * n[0] + p[1] * n[1] + p[2] * n[2];
+			return fabs ( asin ( s > 1 ? 1 : ( s < -1 ? -1 : s ) ) ) * 6371000;
+		}
+
+	}
+
+	double to_a = chordAngle_function ( p, edge->a );
+	double to_b = chordAngle_function ( p, edge->b );
+
+	return ( to_a < to_b ? to_a : to_b ) * 6371000;
+
+}
+
+/* Marks hit[component] for every route or track with a point within distance metres of the corridor polyline */
+int corridorQuery ( const SpatialIndex *index, const PointArray *corridor, double distance, bool *hit ) {
+
+	if ( index == NULL || corridor == NULL || corridor->length == 0 || hit == NULL ) {
+		return 0;
+	}
+
+	int num_edges = corridor->length > 1 ? corridor->length - 1 : 1;
+	CorridorEdge *edges = malloc ( sizeof ( CorridorEdge ) * num_edges );
+	BoundingBox whole = { HUGE_VAL, -HUGE_VAL, HUGE_VAL, -HUGE_VAL };
+
+	for ( int i = 0; i < num_edges; i++ ) {
+
+		int next = corridor->length > 1 ? i + 1 : i;
+
+		edges[i] = corridorEdge_function ( corridor->latitude[i], corridor->longitude[i], corridor->latitude[next], corridor->longitude[next], distance );
+
+		boxInclude_function ( &whole, edges[i].box.min_lat, edges[i].box.min_lon );
+		boxInclude_function ( &whole, edges[i].box.max_lat, edges[i].box.max_lon );
+
+	}
+
+	int *near_edges = malloc ( sizeof ( int ) * num_edges );
+	int num_hits = 0;
+
+	for ( int s = 0; s < index->num_segments; s++ ) {
+
+		const SpatialSegment *my_segment = &index->segments[s];
+
+		if ( hit[my_segment->component] || !boxOverlap_function ( &my_segment->box, &whole ) ) {
+			continue;
+		}
+
+		for ( int start = my_segment->start, c = my_segment->first_chunk; start < my_segment->end && !hit[my_segment->component]; start = start + BBOX_CHUNK, c++ ) {
+
+			/* Only the corridor edges whose grown box meets this chunk can be close to its points */
+			int num_near = 0;
+
+			for ( int e = 0; e < num_edges; e++ ) {
+				if ( boxOverlap_function ( &edges[e].box, &index->chunks[c] ) ) {
+					near_edges[num_near++] = e;
+				}
+			}
+
+			int end = start + BBOX_CHUNK < my_segment->end ? start + BBOX_CHUNK : my_segment->end;
+
+			for ( int i = start; i < end && num_near > 0; i++ ) {
+
+				double p[3];
+				unitVector_function ( index->points->latitude[i], index->points->longitude[i], p );
+
+				for ( int e = 0; e < num_near; e++ ) {
+
+					if ( !boxContains_function ( &edges[near_edges[e]].box, index->points->latitude[i], index->points->longitude[i] ) ) {
+						continue;
+					}
+
+					if ( pointSegmentDistance ( p, &edges[near_edges[e]] ) <= distance ) {
+						hit[my_segment->component] = true;
+						num_hits = num_hits + 1;
+						break;
+					}
+
+				}
+
+				if ( hit[my_segment->component] ) {
+					break;
+				}
+
+			}
+
+		}
+
+	}
+
+	free ( near_edges );
+	free ( edges );
+
+	return num_hits;
+
+}
+
+/* corridor is "lat,lon!lat,lon!..." and distance is in metres */
+char *getCorridorComponents ( char* fileNames, char* gpxSchemaFile, char* corridor, float distance ) {
+
+	if ( fileNames == NULL || gpxSchemaFile == NULL || corridor == NULL ) {
+		return NULL;
+	}
+
+	PointArray *my_corridor = pointArray_function ( 16 );
+
+	char *text = malloc ( strlen ( corridor ) + 1 );
+	strcpy ( text, corridor );
+
+	char *save = NULL;
+	char *point = strtok_r ( text, "!", &save );
+
+	while ( point != NULL ) {
+
+		double latitude = 0;
+		double longitude = 0;
+
+		if ( sscanf ( point, "%lf,%lf", &latitude, &longitude ) == 2 ) {
+			addPoint ( my_corridor, latitude, longitude );
+		}
+
+		point = strtok_r ( NULL, "!", &save );
+
+	}
+
+	free ( text );
+
+	pthread_mutex_lock ( &spatial_index_cache.lock );
+
+	const SpatialIndex *my_index = cachedSpatialIndex ( fileNames, gpxSchemaFile );
+	bool *hit = calloc ( my_index->num_components + 1, sizeof ( bool ) );
+
+	corridorQuery ( my_index, my_corridor, distance, hit );
+
+	int size = 3;
+
+	for ( int i = 0; i < my_index->num_components; i++ ) {
+		if ( hit[i] ) {
+			size = size + 6 * strlen ( my_index->components[i] ) + 40;
+		}
+	}
+
+	char *JSON_return = malloc ( size );
+	int len = 0;
+
+	JSON_return[len++] = '[';
+
+	for ( int i = 0; i < my_index->num_components; i++ ) {
+
+		if ( !hit[i] ) {
+			continue;
+		}
+
+		const char *label = my_index->components[i];
+		const char *component = strchr ( label, '!' );
+		char *file = strndup ( label, component - label );
+
+		len = len + sprintf ( JSON_return + len, "%s{\"file\":", len > 1 ? "," : "" );
+		len = len + jsonString_function ( JSON_return + len, file );
+		len = len + sprintf ( JSON_return + len, ",\"component\":\"%s\"}", component + 1 );
+
+		free ( file );
+
+	}
+
+	pthread_mutex_unlock ( &spatial_index_cache.lock );
+
+	JSON_return[len++] = ']';
+	JSON_return[len] = '\0';
+
+	free ( hit );
+	deletePointArray ( my_corridor );
+
+	return JSON_return;
+
+}
+
+int compareGridEntries ( const void *first, const void *second ) {
+
+	const GridEntry *a = first;
+	const GridEntry *b = second;
+
+	if ( a->cell != b->cell ) {
+		return a->cell < b->cell ? -1 : 1;
+	}
+
+	return a->edge - b->edge;
+
+}
+
+int compareIntersections ( const void *first, const void *second ) {
+
+	const Intersection *a = first;
+	const Intersection *b = second;
+
+	if ( a->component_a != b->component_a ) {
+		return a->component_a - b->component_a;
+	}
+
+	if ( a->index_a != b->index_a ) {
+		return a->index_a - b->index_a;
+	}
+
+	if ( a->component_b != b->component_b ) {
+		return a->component_b - b->component_b;
+	}
+
+	return a->index_b - b->index_b;
+
+}
+
+long long gridCell_function ( double x, double y, double cell ) {
+
+	long long cx = (long long) floor ( x / cell ) + 0x40000000LL;
+	long long cy = (long long) floor ( y / cell ) + 0x40000000LL;
+
+	return ( cx << 32 ) | cy;
+
+}
+
+/* Tests edges e and f of the engine; a crossing is kept only when it lies in cell, so a pair sharing several cells is reported once */
+void intersectEdges_function ( IntersectionEngine *engine, int e, int f, long long cell ) {
+
+	int i = engine->edges[e];
+	int j = engine->edges[f];
+
+	/* Neighbouring edges of the same run always meet at their shared point */
+	if ( engine->edge_segment[e] == engine->edge_segment[f] && ( i == j + 1 || j == i + 1 ) ) {
+		return;
+	}
+
+	const double *x = engine->x;
+	const double *y = engine->y;
+
+	double rx = x[i + 1] - x[i];
+	double ry = y[i + 1] - y[i];
+	double sx = x[j + 1] - x[j];
+	double sy = y[j + 1] - y[j];
+	double denom = rx * sy - ry * sx;
+
+	/* Parallel and collinear overlaps are not crossings */
+	if ( fabs ( denom ) < 1e-18 ) {
+		return;
+	}
+
+	double qx = x[j] - x[i];
+	double qy = y[j] - y[i];
+	double t = ( qx * sy - qy * sx ) / denom;
+	double u = ( qx * ry - qy * rx ) / denom;
+
+	/* Half-open so a crossing through a shared point is reported by one edge pair only */
+	if ( t < 0 || t >= 1 || u < 0 || u >= 1 ) {
+		return;
+	}
+
+	double px = x[i] + t * rx;
+	double py = y[i] + t * ry;
+
+	if ( cell != -1 ) {
+
+		/* Clamp into both edge boxes so rounding cannot move the point into a cell only one edge covers */
+		double low_x = fmax ( fmin ( x[i], x[i + 1] ), fmin ( x[j], x[j + 1] ) );
+		double high_x = fmin ( fmax ( x[i], x[i + 1] ), fmax ( x[j], x[j + 1] ) );
+		double low_y = fmax ( fmin ( y[i], y[i + 1] ), fmin ( y[j], y[j + 1] ) );
+		double high_y = fmin ( fmax ( y[i], y[i + 1] ), fmax ( y[j], y[j + 1] ) );
+
+		if ( gridCell_function ( fmin ( fmax ( px, low_x ), high_x ), fmin ( fmax ( py, low_y ), high_y ), engine->cell ) != cell ) {
+			return;
+		}
+
+	}
+
+	if ( engine->num_found == engine->found_capacity ) {
+		engine->found_capacity = engine->found_capacity * 2;
+		engine->found = realloc ( engine->found, sizeof ( Intersection ) * engine->found_capacity );
+	}
+
+	const PointArray *points = engine->index->points;
+	int component_i = engine->index->segments[engine->edge_segment[e]].component;
+	int component_j = engine->index->segments[engine->edge_segment[f]].component;
+
+	Intersection *my_intersection = &engine->found[engine->num_found];
+
+	my_intersection->latitude = points->latitude[i] + t * ( points->latitude[i + 1] - points->latitude[i] );
+	my_intersection->longitude = points->longitude[i] + t * ( points->longitude[i + 1] - points->longitude[i] );
+
+	/* Order the pair so each crossing has one spelling */
+	if ( component_i < component_j || ( component_i == component_j && i < j ) ) {
+		my_intersection->component_a = component_i;
+		my_intersection->index_a = i - engine->component_start[component_i];
+		my_intersection->component_b = component_j;
+		my_intersection->index_b = j - engine->component_start[component_j];
+	} else {
+		my_intersection->component_a = component_j;
+		my_intersection->index_a = j - engine->component_start[component_j];
+		my_intersection->component_b = component_i;
+		my_intersection->index_b = i - engine->component_start[component_i];
+	}
+
+	engine->num_found = engine->num_found + 1;
+
+}
+
+/* Every crossing between track edges of the index, including a track with itself; index values count points from the start of the track */
+Intersection *findTrackIntersections ( const SpatialIndex *index, int *num_found ) {
+
+	return findIntersections_function ( index, true, num_found );
+
+}
+
+/* Crossings between edges of the index, of tracks only or of every route and track */
+Intersection *findIntersections_function ( const SpatialIndex *index, bool tracksOnly, int *num_found ) {
+
+	*num_found = 0;
+
+	if ( index == NULL ) {
+		return NULL;
+	}
+
+	IntersectionEngine engine;
+
+	engine.index = index;
+	engine.num_found = 0;
+	engine.found_capacity = 16;
+	engine.found = malloc ( sizeof ( Intersection ) * engine.found_capacity );
+	engine.component_start = malloc ( sizeof ( int ) * ( index->num_components + 1 ) );
+
+	for ( int c = 0; c < index->num_components; c++ ) {
+		engine.component_start[c] = -1;
+	}
+
+	/* Planar coordinates with longitude scaled at the mean latitude; fine at the scale where tracks cross */
+	int num_points = index->points->length;
+	double mean_lat = 0;
+
+	for ( int i = 0; i < num_points; i++ ) {
+		mean_lat = mean_lat + index->points->latitude[i];
+	}
+
+	double scale = cos ( ( num_points > 0 ? mean_lat / num_points : 0 ) * ( 3.1415926536 / 180 ) );
+
+	engine.x = malloc ( sizeof ( double ) * ( num_points + 1 ) );
+	engine.y = malloc ( sizeof ( double ) * ( num_points + 1 ) );
+
+	for ( int i = 0; i < num_points; i++ ) {
+		engine.x[i] = index->points->longitude[i] * scale;
+		engine.y[i] = index->points->latitude[i];
+	}
+
+	engine.edges = malloc ( sizeof ( int ) * ( num_points + 1 ) );
+	engine.edge_segment = malloc ( sizeof ( int ) * ( num_points + 1 ) );
+
+	int num_edges = 0;
+	double total_extent = 0;
+
+	for ( int s = 0; s < index->num_segments; s++ ) {
+
+		const SpatialSegment *my_segment = &index->segments[s];
+
+		if ( tracksOnly && strstr ( index->components[my_segment->component], "!Track " ) == NULL ) {
+			continue;
+		}
+
+		if ( engine.component_start[my_segment->component] == -1 ) {
+			engine.component_start[my_segment->component] = my_segment->start;
+		}
+
+		for ( int i = my_segment->start; i + 1 < my_segment->end; i++ ) {
+
+			engine.edges[num_edges] = i;
+			engine.edge_segment[num_edges] = s;
+			num_edges = num_edges + 1;
+
+			total_extent = total_extent + fmax ( fabs ( engine.x[i + 1] - engine.x[i] ), fabs ( engine.y[i + 1] - engine.y[i] ) );
+
+		}
+
+	}
+
+	/* Cells about twice the mean edge, so a typical edge touches a handful of cells */
+	engine.cell = num_edges > 0 ? 2 * total_extent / num_edges : 1;
+
+	if ( engine.cell < 1e-7 ) {
+		engine.cell = 1e-7;
+	}
+
+	int entry_capacity = num_edges * 4 + 16;
+	int num_entries = 0;
+	GridEntry *entries = malloc ( sizeof ( GridEntry ) * entry_capacity );
+
+	int *long_edges = malloc ( sizeof ( int ) * ( num_edges + 1 ) );
+	bool *is_long = calloc ( num_edges + 1, sizeof ( bool ) );
+	int num_long = 0;
+
+	for ( int e = 0; e < num_edges; e++ ) {
+
+		int i = engine.edges[e];
+
+		long long low_x = (long long) floor ( fmin ( engine.x[i], engine.x[i + 1] ) / engine.cell );
+		long long high_x = (long long) floor ( fmax ( engine.x[i], engine.x[i + 1] ) / engine.cell );
+		long long low_y = (long long) floor ( fmin ( engine.y[i], engine.y[i + 1] ) / engine.cell );
+		long long high_y = (long long) floor ( fmax ( engine.y[i], engine.y[i + 1] ) / engine.cell );
+
+		/* GPS jumps spanning many cells are checked directly instead of flooding the grid */
+		if ( ( high_x - low_x + 1 ) * ( high_y - low_y + 1 ) > INTERSECT_MAX_CELLS ) {
+			long_edges[num_long++] = e;
+			is_long[e] = true;
+			continue;
+		}
+
+		for ( long long cx = low_x; cx <= high_x; cx++ ) {
+
+			for ( long long cy = low_y; cy <= high_y; cy++ ) {
+
+				if ( num_entries == entry_capacity ) {
+					entry_capacity = entry_capacity * 2;
+					entries = realloc ( entries, sizeof ( GridEntry ) * entry_capacity );
+				}
+
+				entries[num_entries].cell = ( ( cx + 0x40000000LL ) << 32 ) | ( cy + 0x40000000LL );
+				entries[num_entries].edge = e;
+				num_entries = num_entries + 1;
+
+			}
+
+		}
+
+	}
+
+	qsort ( entries, num_entries, sizeof ( GridEntry ), compareGridEntries );
+
+	for ( int start = 0, end = 0; start < num_entries; start = end ) {
+
+		while ( end < num_entries && entries[end].cell == entries[start].cell ) {
+			end++;
+		}
+
+		for ( int a = start; a < end; a++ ) {
+
+			int i = engine.edges[entries[a].edge];
+
+			for ( int b = a + 1; b < end; b++ ) {
+
+				int j = engine.edges[entries[b].edge];
+
+				if ( fmax ( engine.x[i], engine.x[i + 1] ) < fmin ( engine.x[j], engine.x[j + 1] ) || fmax ( engine.x[j], engine.x[j + 1] ) < fmin ( engine.x[i], engine.x[i + 1] ) ||
+				     fmax ( engine.y[i], engine.y[i + 1] ) < fmin ( engine.y[j], engine.y[j + 1] ) || fmax ( engine.y[j], engine.y[j + 1] ) < fmin ( engine.y[i], engine.y[i + 1] ) ) {
+					continue;
+				}
+
+				intersectEdges_function ( &engine, entries[a].edge, entries[b].edge, entries[start].cell );
+
+			}
+
+		}
+
+	}
+
+	/* Long edges against every other edge; pairs of long edges once */
+	for ( int l = 0; l < num_long; l++ ) {
+
+		int e = long_edges[l];
+
+		for ( int f = 0; f < num_edges; f++ ) {
+
+			if ( f == e ) {
+				continue;
+			}
+
+			int i = engine.edges[e];
+			int j = engine.edges[f];
+
+			if ( is_long[f] && f < e ) {
+				continue;
+			}
+
+			if ( fmax ( engine.x[i], engine.x[i + 1] ) < fmin ( engine.x[j], engine.x[j + 1] ) || fmax ( engine.x[j], engine.x[j + 1] ) < fmin ( engine.x[i], engine.x[i + 1] ) ||
+			     fmax ( engine.y[i], engine.y[i + 1] ) < fmin ( engine.y[j], engine.y[j + 1] ) || fmax ( engine.y[j], engine.y[j + 1] ) < fmin ( engine.y[i], engine.y[i + 1] ) ) {
+				continue;
+			}
+
+			intersectEdges_function ( &engine, e, f, -1 );
+
+		}
+
+	}
+
+	qsort ( engine.found, engine.num_found, sizeof ( Intersection ), compareIntersections );
+
+	free ( is_long );
+	free ( long_edges );
+	free ( entries );
+	free ( engine.edge_segment );
+	free ( engine.edges );
+	free ( engine.y );
+	free ( engine.x );
+	free ( engine.component_start );
+
+	*num_found = engine.num_found;
+
+	return engine.found;
+
+}
+
+char *getTrackIntersections ( char* fileNames, char* gpxSchemaFile ) {
+
+	if ( fileNames == NULL || gpxSchemaFile == NULL ) {
+		return NULL;
+	}
+
+	pthread_mutex_lock ( &spatial_index_cache.lock );
+
+	const SpatialIndex *my_index = cachedSpatialIndex ( fileNames, gpxSchemaFile );
+
+	int num_found = 0;
+	Intersection *found = findTrackIntersections ( my_index, &num_found );
+
+	int size = 3;
+
+	for ( int i = 0; i < num_found; i++ ) {
+		size = size + 6 * ( strlen ( my_index->components[found[i].component_a] ) + strlen ( my_index->components[found[i].component_b] ) ) + 140;
+	}
+
+	char *JSON_return = malloc ( size );
+	int len = 0;
+
+	JSON_return[len++] = '[';
+
+	for ( int i = 0; i < num_found; i++ ) {
+
+		const char *label_a = my_index->components[found[i].component_a];
+		const char *label_b = my_index->components[found[i].component_b];
+		const char *track_a = strchr ( label_a, '!' );
+		const char *track_b = strchr ( label_b, '!' );
+
+		char *file_a = strndup ( label_a, track_a - label_a );
+		char *file_b = strndup ( label_b, track_b - label_b );
+
+		len = len + sprintf ( JSON_return + len, "%s{\"file_a\":", len > 1 ? "," : "" );
+		len = len + jsonString_function ( JSON_return + len, file_a );
+		len = len + sprintf ( JSON_return + len, ",\"track_a\":\"%s\",\"index_a\":%d,\"file_b\":", track_a + 1, found[i].index_a );
+		len = len + jsonString_function ( JSON_return + len, file_b );
+		len = len + sprintf ( JSON_return + len, ",\"track_b\":\"%s\",\"index_b\":%d,\"lat\":%.7f,\"lon\":%.7f}", track_b + 1, found[i].index_b, found[i].latitude, found[i].longitude );
+
+		free ( file_a );
+		free ( file_b );
+
+	}
+
+	pthread_mutex_unlock ( &spatial_index_cache.lock );
+
+	JSON_return[len++] = ']';
+	JSON_return[len] = '\0';
+
+	free ( found );
+
+	return JSON_return;
+
+}
+
+/* ISO 8601 as GPX writes it, e.g. 2021-03-11T10:42:07Z or 2021-03-11T10:42:07.250-05:00, to seconds since the epoch */
+bool parseTime_function ( const char *text, double *seconds ) {
+
+	if ( text == NULL || seconds == NULL ) {
+		return false;
+	}
+
+	struct tm my_time;
+	memset ( &my_time, 0, sizeof ( struct tm ) );
+
+	int used = 0;
+
+	if ( sscanf ( text, "%d-%d-%dT%d:%d:%d%n", &my_time.tm_year, &my_time.tm_mon, &my_time.tm_mday, &my_time.tm_hour, &my_time.tm_min, &my_time.tm_sec, &used ) != 6 ) {
+		return false;
+	}
+
+	my_time.tm_year = my_time.tm_year - 1900;
+	my_time.tm_mon = my_time.tm_mon - 1;
+
+	double fraction = 0;
+	const char *rest = text + used;
+
+	if ( *rest == '.' ) {
+
+		char *end = NULL;
+		fraction = strtod ( rest, &end );
+		rest = end;
+
+	}
+
+	int offset = 0;
+
+	if ( *rest == '+' || *rest == '-' ) {
+
+		int hours = 0;
+		int minutes = 0;
+
+		if ( sscanf ( rest + 1, "%d:%d", &hours, &minutes ) < 1 ) {
+			return false;
+		}
+
+		offset = ( *rest == '+' ? 1 : -1 ) * ( hours * 3600 + minutes * 60 );
+
+	}
+
+	*seconds = (double) timegm ( &my_time ) + fraction - offset;
+
+	return true;
+
+}
+
+/* Value of the <time> child of a waypoint, or NULL */
+const char *waypointTime_function ( const Waypoint *wpt ) {
+
+	if ( wpt == NULL || wpt->otherData == NULL ) {
+		return NULL;
+	}
+
+	ListIterator data_iter = createIterator ( wpt->otherData );
+	void *my_data = nextElement ( &data_iter );
+
+	while ( my_data != NULL ) {
+
+		if ( strcmp ( gpxDataName ( wpt->otherData, my_data ), "time" ) == 0 ) {
+			return gpxDataValue ( wpt->otherData, my_data );
+		}
+
+		my_data = nextElement ( &data_iter );
+
+	}
+
+	return NULL;
+
+}
+
+/* Cumulative metres along the track, joining segments the way getTrackLen does, and the timed points in time order */
+TrackTimeline *buildTrackTimeline ( const Track *tr ) {
+
+	if ( tr == NULL ) {
+		return NULL;
+	}
+
+	int num_points = getNumSegmentsWaypoints ( tr );
+
+	TrackTimeline *timeline = malloc ( sizeof ( TrackTimeline ) );
+
+	timeline->points = pointArray_function ( num_points );
+	timeline->distance = malloc ( sizeof ( double ) * ( num_points + 1 ) );
+	timeline->times = malloc ( sizeof ( double ) * ( num_points + 1 ) );
+	timeline->timed = malloc ( sizeof ( int ) * ( num_points + 1 ) );
+	timeline->num_timed = 0;
+
+	ListIterator segment_iter = createIterator ( tr->segments );
+	TrackSegment *my_segment = nextElement ( &segment_iter );
+
+	while ( my_segment != NULL ) {
+
+		ListIterator waypoint_iter = createIterator ( my_segment->waypoints );
+		Waypoint *my_waypoint = nextElement ( &waypoint_iter );
+
+		while ( my_waypoint != NULL ) {
+
+			int i = timeline->points->length;
+
+			addPoint ( timeline->points, my_waypoint->latitude, my_waypoint->longitude );
+
+			timeline->distance[i] = i == 0 ? 0 : timeline->distance[i - 1] + distance_function ( timeline->points->latitude[i - 1], timeline->points->longitude[i - 1], my_waypoint->latitude, my_waypoint->longitude ) * 1000;
+
+			/* Points without a time, or that step back in time, are still passed through by distance */
+			double seconds = 0;
+
+			if ( parseTime_function ( waypointTime_function ( my_waypoint ), &seconds ) && ( timeline->num_timed == 0 || seconds >= timeline->times[timeline->num_timed - 1] ) ) {
+
+				timeline->times[timeline->num_timed] = seconds;
+				timeline->timed[timeline->num_timed] = i;
+				timeline->num_timed = timeline->num_timed + 1;
+
+			}
+
+			my_waypoint = nextElement ( &waypoint_iter );
+
+		}
+
+		my_segment = nextElement ( &segment_iter );
+
+	}
+
+	return timeline;
+
+}
+
+void deleteTrackTimeline ( TrackTimeline *timeline ) {
+
+	if ( timeline == NULL ) {
+		return;
+	}
+
+	deletePointArray ( timeline->points );
+	free ( timeline->distance );
+	free ( timeline->times );
+	free ( timeline->timed );
+	free ( timeline );
+
+}
+
+/* Position metres along the track, interpolated between the two points either side */
+bool positionAtDistance ( const TrackTimeline *timeline, double metres, double *latitude, double *longitude ) {
+
+	if ( timeline == NULL || timeline->points->length == 0 ) {
+		return false;
+	}
+
+	int last = timeline->points->length - 1;
+
+	if ( metres < 0 || metres > timeline->distance[last] ) {
+		return false;
+	}
+
+	/* Last point at or before metres */
+	int low = 0;
+	int high = last;
+
+	while ( low < high ) {
+
+		int middle = ( low + high + 1 ) / 2;
+
+		if ( timeline->distance[middle] <= metres ) {
+			low = middle;
+		} else {
+			high = middle - 1;
+		}
+
+	}
+
+	const double *lat = timeline->points->latitude;
+	const double *lon = timeline->points->longitude;
+
+	if ( low == last || timeline->distance[low + 1] == timeline->distance[low] ) {
+		*latitude = lat[low];
+		*longitude = lon[low];
+		return true;
+	}
+
+	double fraction = ( metres - timeline->distance[low] ) / ( timeline->distance[low + 1] - timeline->distance[low] );
+
+	*latitude = lat[low] + fraction * ( lat[low + 1] - lat[low] );
+	*longitude = lon[low] + fraction * ( lon[low + 1] - lon[low] );
+
+	return true;
+
+}
+
+/* Position at seconds since the epoch; between two timed points the track is followed at constant speed */
+bool positionAtTime ( const TrackTimeline *timeline, double seconds, double *latitude, double *longitude ) {
+
+	if ( timeline == NULL || timeline->num_timed == 0 ) {
+		return false;
+	}
+
+	int last = timeline->num_timed - 1;
+
+	if ( seconds < timeline->times[0] || seconds > timeline->times[last] ) {
+		return false;
+	}
+
+	int low = 0;
+	int high = last;
+
+	while ( low < high ) {
+
+		int middle = ( low + high + 1 ) / 2;
+
+		if ( timeline->times[middle] <= seconds ) {
+			low = middle;
+		} else {
+			high = middle - 1;
+		}
+
+	}
+
+	double metres = timeline->distance[timeline->timed[low]];
+
+	if ( low < last && timeline->times[low + 1] > timeline->times[low] ) {
+
+		double fraction = ( seconds - timeline->times[low] ) / ( timeline->times[low + 1] - timeline->times[low] );
+		metres = metres + fraction * ( timeline->distance[timeline->timed[low + 1]] - metres );
+
+	}
+
+	return positionAtDistance ( timeline, metres, latitude, longitude );
+
+}
+
+/* mode is "distance" with values in metres or "time" with ISO 8601 values, separated by "!"; a lookup off the track is null */
+char *getTrackPositions ( char* fileName, char* gpxSchemaFile, char* componentName, char* mode, char* values ) {
+
+	if ( componentName == NULL || mode == NULL || values == NULL || strncmp ( componentName, "Track", 5 ) != 0 ) {
+		return NULL;
+	}
+
+	GPXdoc *my_doc = createValidGPXdoc ( fileName, gpxSchemaFile );
+
+	if ( my_doc == NULL ) {
+		return NULL;
+	}
+
+	int value = strlen ( componentName ) > 6 ? atoi ( componentName + 6 ) : 0;
+
+	ListIterator track_iter = createIterator ( my_doc->tracks );
+	Track *my_track = nextElement ( &track_iter );
+
+	for ( int i = 1; i < value && my_track != NULL; i++ ) {
+		my_track = nextElement ( &track_iter );
+	}
+
+	TrackTimeline *timeline = buildTrackTimeline ( my_track );
+
+	if ( timeline == NULL ) {
+		deleteGPXdoc ( my_doc );
+		return NULL;
+	}
+
+	bool by_time = strcmp ( mode, "time" ) == 0;
+
+	char *JSON_return = malloc ( strlen ( values ) * 2 + 16 );
+	int capacity = strlen ( values ) * 2 + 16;
+	int len = 0;
+
+	JSON_return[len++] = '[';
+
+	char *text = malloc ( strlen ( values ) + 1 );
+	strcpy ( text, values );
+
+	char *save = NULL;
+	char *token = strtok_r ( text, "!", &save );
+
+	while ( token != NULL ) {
+
+		if ( len + 64 > capacity ) {
+			capacity = capacity * 2 + 64;
+			JSON_return = realloc ( JSON_return, capacity );
+		}
+
+		double latitude = 0;
+		double longitude = 0;
+		double seconds = 0;
+		bool found = false;
+
+		if ( by_time ) {
+			found = parseTime_function ( token, &seconds ) && positionAtTime ( timeline, seconds, &latitude, &longitude );
+		} else {
+			found = positionAtDistance ( timeline, atof ( token ), &latitude, &longitude );
+		}
+
+		if ( len > 1 ) {
+			JSON_return[len++] = ',';
+		}
+
+		if ( found ) {
+			len = len + sprintf ( JSON_return + len, "{\"lat\":%.7f,\"lon\":%.7f}", latitude, longitude );
+		} else {
+			len = len + sprintf ( JSON_return + len, "null" );
+		}
+
+		token = strtok_r ( NULL, "!", &save );
+
+	}
+
+	JSON_return[len++] = ']';
+	JSON_return[len] = '\0';
+
+	free ( text );
+	deleteTrackTimeline ( timeline );
+	deleteGPXdoc ( my_doc );
+
+	return JSON_return;
+
+}
+
+Series *series_function ( int capacity ) {
+
+	Series *my_series = malloc ( sizeof ( Series ) );
+
+	my_series->length = 0;
+	my_series->x = malloc ( sizeof ( double ) * ( capacity + 1 ) );
+	my_series->y = malloc ( sizeof ( double ) * ( capacity + 1 ) );
+
+	return my_series;
+
+}
+
+void deleteSeries ( Series *series ) {
+
+	if ( series == NULL ) {
+		return;
+	}
+
+	free ( series->x );
+	free ( series->y );
+	free ( series );
+
+}
+
+/* Metres along the track against <ele> for every point that has one */
+Series *elevationSeries ( const Track *tr, const TrackTimeline *timeline ) {
+
+	if ( tr == NULL || timeline == NULL ) {
+		return NULL;
+	}
+
+	Series *my_series = series_function ( timeline->points->length );
+
+	ListIterator segment_iter = createIterator ( tr->segments );
+	TrackSegment *my_segment = nextElement ( &segment_iter );
+
+	for ( int i = 0; my_segment != NULL; my_segment = nextElement ( &segment_iter ) ) {
+
+		ListIterator waypoint_iter = createIterator ( my_segment->waypoints );
+		Waypoint *my_waypoint = nextElement ( &waypoint_iter );
+
+		for ( ; my_waypoint != NULL; i++, my_waypoint = nextElement ( &waypoint_iter ) ) {
+
+			ListIterator data_iter = createIterator ( my_waypoint->otherData );
+			void *my_data = nextElement ( &data_iter );
+
+			while ( my_data != NULL && strcmp ( gpxDataName ( my_waypoint->otherData, my_data ), "ele" ) != 0 ) {
+				my_data = nextElement ( &data_iter );
+			}
+
+			if ( my_data != NULL ) {
+				my_series->x[my_series->length] = timeline->distance[i];
+				my_series->y[my_series->length] = atof ( gpxDataValue ( my_waypoint->otherData, my_data ) );
+				my_series->length = my_series->length + 1;
+			}
+
+		}
+
+	}
+
+	return my_series;
+
+}
+
+/* Seconds from the first timed point against metres per second, one value per step between timed points */
+Series *speedSeries ( const TrackTimeline *timeline ) {
+
+	if ( timeline == NULL ) {
+		return NULL;
+	}
+
+	Series *my_series = series_function ( timeline->num_timed );
+
+	for ( int k = 1; k < timeline->num_timed; k++ ) {
+
+		double seconds = timeline->times[k] - timeline->times[k - 1];
+
+		if ( seconds <= 0 ) {
+			continue;
+		}
+
+		my_series->x[my_series->length] = ( timeline->times[k] + timeline->times[k - 1] ) / 2 - timeline->times[0];
+		my_series->y[my_series->length] = ( timeline->distance[timeline->timed[k]] - timeline->distance[timeline->timed[k - 1]] ) / seconds;
+		my_series->length = my_series->length + 1;
+
+	}
+
+	return my_series;
+
+}
+
+/* Largest-Triangle-Three-Buckets: keeps both ends and, from each of threshold - 2 buckets, the point making the largest triangle with the last kept point and the next bucket's mean; below 3 only the ends are kept */
+Series *largestTriangleThreeBuckets ( const Series *series, int threshold ) {
+
+	if ( series == NULL ) {
+		return NULL;
+	}
+
+	int n = series->length;
+
+	if ( threshold < 3 && n > 2 ) {
+
+		Series *my_ends = series_function ( 2 );
+
+		my_ends->x[0] = series->x[0];
+		my_ends->y[0] = series->y[0];
+		my_ends->x[1] = series->x[n - 1];
+		my_ends->y[1] = series->y[n - 1];
+		my_ends->length = 2;
+
+		return my_ends;
+
+	}
+
+	if ( threshold >= n || threshold < 3 ) {
+
+		Series *my_copy = series_function ( n );
+
+		memcpy ( my_copy->x, series->x, sizeof ( double ) * n );
+		memcpy ( my_copy->y, series->y, sizeof ( double ) * n );
+		my_copy->length = n;
+
+		return my_copy;
+
+	}
+
+	Series *sampled = series_function ( threshold );
+	double every = (double) ( n - 2 ) / ( threshold - 2 );
+	int a = 0;
+
+	sampled->x[0] = series->x[0];
+	sampled->y[0] = series->y[0];
+	sampled->length = 1;
+
+	for ( int b = 0; b < threshold - 2; b++ ) {
+
+		int next_start = (int) ( ( b + 1 ) * every ) + 1;
+		int next_end = (int) ( ( b + 2 ) * every ) + 1;
+
+		if ( next_end > n ) {
+			next_end = n;
+		}
+
+		double mean_x = 0;
+		double mean_y = 0;
+
+		for ( int i = next_start; i < next_end; i++ ) {
+			mean_x = mean_x + series->x[i];
+			mean_y = mean_y + series->y[i];
+		}
+
+		mean_x = mean_x / ( next_end - next_start );
+		mean_y = mean_y / ( next_end - next_start );
+
+		int start = (int) ( b * every ) + 1;
+		int end = next_start;
+		int chosen = start;
+		double best = -1;
+
+		for ( int i = start; i < end; i++ ) {
+
+			double area = fabs ( ( series->x[a] - mean_x ) * ( series->y[i] - series->y[a] ) - ( series->x[a] - series->x[i] ) * ( mean_y - series->y[a] ) );
+
+			if ( area > best ) {
+				best = area;
+				chosen = i;
+			}
+
+		}
+
+		sampled->x[sampled->length] = series->x[chosen];
+		sampled->y[sampled->length] = series->y[chosen];
+		sampled->length = sampled->length + 1;
+
+		a = chosen;
+
+	}
+
+	sampled->x[sampled->length] = series->x[n - 1];
+	sampled->y[sampled->length] = series->y[n - 1];
+	sampled->length = sampled->length + 1;
+
+	return sampled;
+
+}
+
+char *seriesToJSON ( const Series *series ) {
+
+	if ( series == NULL ) {
+		return NULL;
+	}
+
+	int size = series->length * 32 + 3;
+	int len = 0;
+	char *JSON_return = malloc ( size );
+
+	JSON_return[len++] = '[';
+
+	/* %.2f has no width limit, so a huge ele value is measured first and the buffer grown to fit */
+	for ( int i = 0; i < series->length; i++ ) {
+
+		int needed = snprintf ( NULL, 0, "%s[%.2f,%.2f]", i > 0 ? "," : "", series->x[i], series->y[i] );
+
+		if ( len + needed + 2 > size ) {
+			size = ( len + needed + 2 ) * 2;
+			JSON_return = realloc ( JSON_return, size );
+		}
+
+		len = len + sprintf ( JSON_return + len, "%s[%.2f,%.2f]", i > 0 ? "," : "", series->x[i], series->y[i] );
+
+	}
+
+	JSON_return[len++] = ']';
+	JSON_return[len] = '\0';
+
+	return JSON_return;
+
+}
+
+/* kind is "elevation" (metres along against ele) or "speed" (seconds in against m/s), reduced to at most numPoints */
+char *getTrackProfile ( char* fileName, char* gpxSchemaFile, char* componentName, char* kind, int numPoints ) {
+
+	if ( componentName == NULL || kind == NULL || strncmp ( componentName, "Track", 5 ) != 0 ) {
+		return NULL;
+	}
+
+	GPXdoc *my_doc = createValidGPXdoc ( fileName, gpxSchemaFile );
+
+	if ( my_doc == NULL ) {
+		return NULL;
+	}
+
+	int value = strlen ( componentName ) > 6 ? atoi ( componentName + 6 ) : 0;
+
+	ListIterator track_iter = createIterator ( my_doc->tracks );
+	Track *my_track = nextElement ( &track_iter );
+
+	for ( int i = 1; i < value && my_track != NULL; i++ ) {
+		my_track = nextElement ( &track_iter );
+	}
+
+	TrackTimeline *timeline = buildTrackTimeline ( my_track );
+	Series *my_series = strcmp ( kind, "speed" ) == 0 ? speedSeries ( timeline ) : elevationSeries ( my_track, timeline );
+	Series *sampled = largestTriangleThreeBuckets ( my_series, numPoints );
+
+	char *JSON_return = seriesToJSON ( sampled );
+
+	deleteSeries ( sampled );
+	deleteSeries ( my_series );
+	deleteTrackTimeline ( timeline );
+	deleteGPXdoc ( my_doc );
+
+	return JSON_return;
+
+}
+
+int endVectorSlot_function ( const void *component, int capacity ) {
+
+	uint64_t key = (uint64_t) (uintptr_t) component;
+
+	key = ( key >> 4 ) * 0x9E3779B97F4A7C15ULL;
+
+	return (int) ( key >> 32 ) & ( capacity - 1 );
+
+}
+
+/* Call with end_vectors.lock held */
+void endVectorInsert_function ( const void *component, const Waypoint *first, const Waypoint *last ) {
+
+	if ( ( end_vectors.count + 1 ) * 2 > end_vectors.capacity ) {
+
+		EndVectors *old_slots = end_vectors.slots;
+		int old_capacity = end_vectors.capacity;
+
+		end_vectors.capacity = old_capacity == 0 ? 64 : old_capacity * 2;
+		end_vectors.slots = calloc ( end_vectors.capacity, sizeof ( EndVectors ) );
+		end_vectors.count = 0;
+
+		for ( int i = 0; i < old_capacity; i++ ) {
+
+			if ( old_slots[i].component != NULL ) {
+
+				int slot = endVectorSlot_function ( old_slots[i].component, end_vectors.capacity );
+
+				while ( end_vectors.slots[slot].component != NULL ) {
+					slot = ( slot + 1 ) & ( end_vectors.capacity - 1 );
+				}
+
+				end_vectors.slots[slot] = old_slots[i];
+				end_vectors.count = end_vectors.count + 1;
+
+			}
+
+		}
+
+		free ( old_slots );
+
+	}
+
+	int slot = endVectorSlot_function ( component, end_vectors.capacity );
+
+	while ( end_vectors.slots[slot].component != NULL && end_vectors.slots[slot].component != component ) {
+		slot = ( slot + 1 ) & ( end_vectors.capacity - 1 );
+	}
+
+	if ( end_vectors.slots[slot].component == NULL ) {
+		end_vectors.count = end_vectors.count + 1;
+	}
+
+	end_vectors.slots[slot].component = component;
+	unitVector_function ( first->latitude, first->longitude, end_vectors.slots[slot].first );
+	unitVector_function ( last->latitude, last->longitude, end_vectors.slots[slot].last );
+
+}
+
+/* Call with end_vectors.lock held; shifts the rest of the probe run back so lookups never need tombstones */
+void endVectorRemove_function ( const void *component ) {
+
+	if ( end_vectors.count == 0 ) {
+		return;
+	}
+
+	int mask = end_vectors.capacity - 1;
+	int slot = endVectorSlot_function ( component, end_vectors.capacity );
+
+	while ( end_vectors.slots[slot].component != component ) {
+
+		if ( end_vectors.slots[slot].component == NULL ) {
+			return;
+		}
+
+		slot = ( slot + 1 ) & mask;
+
+	}
+
+	int hole = slot;
+
+	for ( int next = ( hole + 1 ) & mask; end_vectors.slots[next].component != NULL; next = ( next + 1 ) & mask ) {
+
+		int home = endVectorSlot_function ( end_vectors.slots[next].component, end_vectors.capacity );
+
+		/* Move it back unless its home lies cyclically in ( hole, next ] */
+		if ( ( ( next - home ) & mask ) >= ( ( next - hole ) & mask ) ) {
+			end_vectors.slots[hole] = end_vectors.slots[next];
+			hole = next;
+		}
+
+	}
+
+	end_vectors.slots[hole].component = NULL;
+	end_vectors.count = end_vectors.count - 1;
+
+}
+
+/* Caches the unit vectors of the two points the endpoint and loop tests read for every route and track of doc */
+void attachEndVectors ( const GPXdoc *doc ) {
+
+	if ( doc == NULL ) {
+		return;
+	}
+
+	pthread_mutex_lock ( &end_vectors.lock );
+
+	ListIterator route_iter = createIterator ( doc->routes );
+	Route *my_route = nextElement ( &route_iter );
+
+	while ( my_route != NULL ) {
+
+		if ( getLength ( my_route->waypoints ) != 0 ) {
+			endVectorInsert_function ( my_route, getFromFront ( my_route->waypoints ), getFromBack ( my_route->waypoints ) );
+		}
+
+		my_route = nextElement ( &route_iter );
+
+	}
+
+	ListIterator track_iter = createIterator ( doc->tracks );
+	Track *my_track = nextElement ( &track_iter );
+
+	while ( my_track != NULL ) {
+
+		/* The far end is the back of the last segment with any points, as getTracksBetween and isLoopTrack take it */
+		Waypoint *first = NULL;
+		Waypoint *last = NULL;
+
+		if ( getLength ( my_track->segments ) != 0 ) {
+
+			TrackSegment *first_segment = getFromFront ( my_track->segments );
+			first = getLength ( first_segment->waypoints ) != 0 ? getFromFront ( first_segment->waypoints ) : NULL;
+
+			ListIterator segment_iter = createIterator ( my_track->segments );
+			TrackSegment *my_segment = nextElement ( &segment_iter );
+
+			while ( my_segment != NULL ) {
+
+				if ( getLength ( my_segment->waypoints ) != 0 ) {
+					last = getFromBack ( my_segment->waypoints );
+				}
+
+				my_segment = nextElement ( &segment_iter );
+
+			}
+
+		}
+
+		if ( first != NULL && last != NULL ) {
+			endVectorInsert_function ( my_track, first, last );
+		}
+
+		my_track = nextElement ( &track_iter );
+
+	}
+
+	pthread_mutex_unlock ( &end_vectors.lock );
+
+}
+
+void detachEndVectors ( const GPXdoc *doc ) {
+
+	if ( doc == NULL ) {
+		return;
+	}
+
+	pthread_mutex_lock ( &end_vectors.lock );
+
+	if ( end_vectors.count == 0 ) {
+		pthread_mutex_unlock ( &end_vectors.lock );
+		return;
+	}
+
+	ListIterator route_iter = createIterator ( doc->routes );
+	Route *my_route = nextElement ( &route_iter );
+
+	while ( my_route != NULL ) {
+		endVectorRemove_function ( my_route );
+		my_route = nextElement ( &route_iter );
+	}
+
+	ListIterator track_iter = createIterator ( doc->tracks );
+	Track *my_track = nextElement ( &track_iter );
+
+	while ( my_track != NULL ) {
+		endVectorRemove_function ( my_track );
+		my_track = nextElement ( &track_iter );
+	}
+
+	pthread_mutex_unlock ( &end_vectors.lock );
+
+}
+
+void dropEndVectors ( const void *component ) {
+
+	if ( component == NULL ) {
+		return;
+	}
+
+	pthread_mutex_lock ( &end_vectors.lock );
+	endVectorRemove_function ( component );
+	pthread_mutex_unlock ( &end_vectors.lock );
+
+}
+
+/* The cached end vectors stand in only for the chord kernel, a sphere measure like theirs */
+bool endVectorsActive_function ( DistanceKernel kernel ) {
+
+	if ( kernel != &chordDistance ) {
+		return false;
+	}
+
+	/* count changes under the lock as documents are loaded and freed on other threads */
+	pthread_mutex_lock ( &end_vectors.lock );
+	bool active = end_vectors.count > 0;
+	pthread_mutex_unlock ( &end_vectors.lock );
+
+	return active;
+
+}
+
+bool endVectors_function ( const void *component, double first[3], double last[3] ) {
+
+	pthread_mutex_lock ( &end_vectors.lock );
+
+	bool found = false;
+
+	if ( end_vectors.count > 0 ) {
+
+		int slot = endVectorSlot_function ( component, end_vectors.capacity );
+
+		while ( end_vectors.slots[slot].component != NULL && end_vectors.slots[slot].component != component ) {
+			slot = ( slot + 1 ) & ( end_vectors.capacity - 1 );
+		}
+
+		if ( end_vectors.slots[slot].component == component ) {
+			memcpy ( first, end_vectors.slots[slot].first, sizeof ( double ) * 3 );
+			memcpy ( last, end_vectors.slots[slot].last, sizeof ( double ) * 3 );
+			found = true;
+		}
+
+	}
+
+	pthread_mutex_unlock ( &end_vectors.lock );
+
+	return found;
+
+}
+
+/* Squared straight-line distance between two unit vectors for points delta km apart on the 6371 km sphere; -1 when nothing can match */
+double chordLimit_function ( double delta ) {
+
+	if ( delta < 0 ) {
+		return -1;
+	}
+
+	double chord = 2 * sin ( fmin ( delta / 6371, 3.1415926536 ) / 2 );
+
+	return chord * chord;
+
+}
+
+double chordSquared_function ( const double a[3], const double b[3] ) {
+
+	double dx = a[0] - b[0];
+	double dy = a[1] - b[1];
+	double dz = a[2] - b[2];
+
+	return dx * dx + dy * dy + dz * dz;
+
+}
+
+int compareLengthEntries ( const void *first, const void *second ) {
+
+	const LengthEntry *a = first;
+	const LengthEntry *b = second;
+
+	if ( a->length != b->length ) {
+		return a->length < b->length ? -1 : 1;
+	}
+
+	if ( a->label != NULL && b->label != NULL ) {
+		return strcmp ( a->label, b->label );
+	}
+
+	return a->number - b->number;
+
+}
+
+/* Lengths of every route (or track) in list, sorted; number is the 1-based position in the list */
+LengthEntry *lengthEntries_function ( List *list, bool routes, int *count ) {
+
+	*count = getLength ( list );
+
+	LengthEntry *entries = malloc ( sizeof ( LengthEntry ) * ( *count + 1 ) );
+
+	ListIterator iter = createIterator ( list );
+	void *my_component = nextElement ( &iter );
+
+	for ( int i = 0; my_component != NULL; i++ ) {
+
+		entries[i].length = routes ? getRouteLen ( my_component ) : getTrackLen ( my_component );
+		entries[i].component = my_component;
+		entries[i].label = NULL;
+		entries[i].number = i + 1;
+
+		my_component = nextElement ( &iter );
+
+	}
+
+	qsort ( entries, *count, sizeof ( LengthEntry ), &compareLengthEntries );
+
+	return entries;
+
+}
+
+LengthIndex *buildLengthIndex ( const GPXdoc *doc ) {
+
+	if ( doc == NULL ) {
+		return NULL;
+	}
+
+	LengthIndex *index = malloc ( sizeof ( LengthIndex ) );
+
+	index->doc = doc;
+	index->kernel = distance_kernel;
+	index->routes = lengthEntries_function ( doc->routes, true, &index->num_routes );
+	index->tracks = lengthEntries_function ( doc->tracks, false, &index->num_tracks );
+
+	return index;
+
+}
+
+void deleteLengthIndex ( LengthIndex *index ) {
+
+	if ( index == NULL ) {
+		return;
+	}
+
+	free ( index->routes );
+	free ( index->tracks );
+	free ( index );
+
+}
+
+/* Entries whose length L passes numRoutesWithLength's own float test, len >= L - delta && len <= L + delta; both sides are monotone in L */
+int lengthRange_function ( const LengthEntry *entries, int count, float len, float delta, int *first ) {
+
+	int lo = 0;
+	int hi = count;
+
+	while ( lo < hi ) {
+
+		int mid = ( lo + hi ) / 2;
+
+		if ( len <= ( entries[mid].length + delta ) ) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+
+	}
+
+	*first = lo;
+	hi = count;
+
+	while ( lo < hi ) {
+
+		int mid = ( lo + hi ) / 2;
+
+		if ( len >= ( entries[mid].length - delta ) ) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+
+	}
+
+	return lo - *first;
+
+}
+
+/* The routes (or tracks) of the index within delta of len, shortest first; the list does not own them */
+List *lengthIndexItems ( const LengthIndex *index, bool routes, float len, float delta ) {
+
+	if ( index == NULL || len < 0 || delta < 0 ) {
+		return NULL;
+	}
+
+	List *my_items = routes ? initializeList ( &routeToString, &tempDelete, &compareRoutes ) : initializeList ( &trackToString, &tempDelete, &compareTracks );
+
+	const LengthEntry *entries = routes ? index->routes : index->tracks;
+	int first = 0;
+	int count = lengthRange_function ( entries, routes ? index->num_routes : index->num_tracks, len, delta, &first );
+
+	for ( int i = first; i < first + count; i++ ) {
+		insertBack ( my_items, (void *) entries[i].component );
+	}
+
+	return my_items;
+
+}
+
+/* Builds doc's length index and lets numRoutesWithLength and numTracksWithLength use it until the document changes */
+void attachLengthIndex ( const GPXdoc *doc ) {
+
+	if ( doc == NULL ) {
+		return;
+	}
+
+	detachLengthIndex ( doc );
+
+	LengthIndex *index = buildLengthIndex ( doc );
+
+	pthread_mutex_lock ( &length_indexes.lock );
+
+	if ( length_indexes.num_indexes == length_indexes.capacity ) {
+		length_indexes.capacity = length_indexes.capacity == 0 ? 8 : length_indexes.capacity * 2;
+		length_indexes.indexes = realloc ( length_indexes.indexes, sizeof ( LengthIndex * ) * length_indexes.capacity );
+	}
+
+	length_indexes.indexes[length_indexes.num_indexes] = index;
+	length_indexes.num_indexes = length_indexes.num_indexes + 1;
+
+	pthread_mutex_unlock ( &length_indexes.lock );
+
+}
+
+void detachLengthIndex ( const GPXdoc *doc ) {
+
+	if ( doc == NULL ) {
+		return;
+	}
+
+	pthread_mutex_lock ( &length_indexes.lock );
+
+	for ( int i = 0; i < length_indexes.num_indexes; i++ ) {
+
+		if ( length_indexes.indexes[i]->doc == doc ) {
+
+			deleteLengthIndex ( length_indexes.indexes[i] );
+
+			length_indexes.num_indexes = length_indexes.num_indexes - 1;
+			length_indexes.indexes[i] = length_indexes.indexes[length_indexes.num_indexes];
+
+			break;
+
+		}
+
+	}
+
+	pthread_mutex_unlock ( &length_indexes.lock );
+
+}
+
+/* Drops the index of whichever attached document holds the route or track, whose length is about to change or which is being freed */
+void dropLengthIndexOf ( const void *component ) {
+
+	if ( component == NULL ) {
+		return;
+	}
+
+	const GPXdoc *owner = NULL;
+
+	pthread_mutex_lock ( &length_indexes.lock );
+
+	for ( int i = 0; i < length_indexes.num_indexes && owner == NULL; i++ ) {
+
+		const LengthIndex *index = length_indexes.indexes[i];
+
+		for ( int j = 0; j < index->num_routes + index->num_tracks; j++ ) {
+
+			if ( ( j < index->num_routes ? index->routes[j] : index->tracks[j - index->num_routes] ).component == component ) {
+				owner = index->doc;
+				break;
+			}
+
+		}
+
+	}
+
+	pthread_mutex_unlock ( &length_indexes.lock );
+
+	detachLengthIndex ( owner );
+
+}
+
+/* Count from doc's attached index, or -1 when it has none built under the current kernel */
+int lengthIndexCount_function ( const GPXdoc *doc, bool routes, float len, float delta ) {
+
+	int count = -1;
+
+	pthread_mutex_lock ( &length_indexes.lock );
+
+	for ( int i = 0; i < length_indexes.num_indexes; i++ ) {
+
+		const LengthIndex *index = length_indexes.indexes[i];
+
+		if ( index->doc == doc && index->kernel == distance_kernel ) {
+
+			int first = 0;
+			count = lengthRange_function ( routes ? index->routes : index->tracks, routes ? index->num_routes : index->num_tracks, len, delta, &first );
+			break;
+
+		}
+
+	}
+
+	pthread_mutex_unlock ( &length_indexes.lock );
+
+	return count;
+
+}
+
+/* Every route and track of every file, labelled "<file>!<Route|Track> <n>" and sorted by length */
+LengthEntry *buildCorpusLengths ( char *fileNames, char *gpxSchemaFile, int *count ) {
+
+	*count = 0;
+
+	int capacity = 64;
+	LengthEntry *entries = malloc ( sizeof ( LengthEntry ) * capacity );
+
+	char *names = malloc ( strlen ( fileNames ) + 1 );
+	strcpy ( names, fileNames );
+
+	char *save = NULL;
+	char *name = strtok_r ( names, "!", &save );
+
+	while ( name != NULL ) {
+
+		GPXdoc *my_doc = createValidGPXdoc ( name, gpxSchemaFile );
+
+		if ( my_doc != NULL ) {
+
+			LengthIndex *index = buildLengthIndex ( my_doc );
+
+			for ( int k = 0; k < index->num_routes + index->num_tracks; k++ ) {
+
+				bool route = k < index->num_routes;
+				const LengthEntry *my_entry = route ? &index->routes[k] : &index->tracks[k - index->num_routes];
+
+				if ( *count == capacity ) {
+					capacity = capacity * 2;
+					entries = realloc ( entries, sizeof ( LengthEntry ) * capacity );
+				}
+
+				entries[*count].length = my_entry->length;
+				entries[*count].component = NULL;
+				entries[*count].number = my_entry->number;
+				entries[*count].label = malloc ( strlen ( name ) + 20 );
+				sprintf ( entries[*count].label, "%s!%s %d", name, route ? "Route" : "Track", my_entry->number );
+
+				*count = *count + 1;
+
+			}
+
+			deleteLengthIndex ( index );
+			deleteGPXdoc ( my_doc );
+
+		}
+
+		name = strtok_r ( NULL, "!", &save );
+
+	}
+
+	free ( names );
+
+	qsort ( entries, *count, sizeof ( LengthEntry ), &compareLengthEntries );
+
+	return entries;
+
+}
+
+/* Routes and tracks across the files whose length is within delta metres of len, shortest first */
+char *getComponentsWithLength ( char* fileNames, char* gpxSchemaFile, float len, float delta ) {
+
+	if ( fileNames == NULL || gpxSchemaFile == NULL || len < 0 || delta < 0 ) {
+		return NULL;
+	}
+
+	char *key = routeGraphKey ( fileNames, gpxSchemaFile );
+
+	pthread_mutex_lock ( &corpus_lengths.lock );
+
+	if ( corpus_lengths.key == NULL || strcmp ( corpus_lengths.key, key ) != 0 || corpus_lengths.kernel != distance_kernel ) {
+
+		for ( int i = 0; i < corpus_lengths.num_entries; i++ ) {
+			free ( corpus_lengths.entries[i].label );
+		}
+
+		free ( corpus_lengths.entries );
+		free ( corpus_lengths.key );
+
+		corpus_lengths.entries = buildCorpusLengths ( fileNames, gpxSchemaFile, &corpus_lengths.num_entries );
+		corpus_lengths.kernel = distance_kernel;
+		corpus_lengths.key = key;
+
+	} else {
+		free ( key );
+	}
+
+	int first = 0;
+	int count = lengthRange_function ( corpus_lengths.entries, corpus_lengths.num_entries, len, delta, &first );
+
+	int size = 3;
+
+	for ( int i = first; i < first + count; i++ ) {
+		size = size + 6 * strlen ( corpus_lengths.entries[i].label ) + 60;
+	}
+
+	char *JSON_return = malloc ( size );
+	int used = 0;
+
+	JSON_return[used++] = '[';
+
+	for ( int i = first; i < first + count; i++ ) {
+
+		const char *label = corpus_lengths.entries[i].label;
+		const char *component = strrchr ( label, '!' );
+		char *file = strndup ( label, component - label );
+
+		used = used + sprintf ( JSON_return + used, "%s{\"file\":", i > first ? "," : "" );
+		used = used + jsonString_function ( JSON_return + used, file );
+		used = used + sprintf ( JSON_return + used, ",\"component\":\"%s\",\"length\":%.1f}", component + 1, corpus_lengths.entries[i].length );
+
+		free ( file );
+
+	}
+
+	pthread_mutex_unlock ( &corpus_lengths.lock );
+
+	JSON_return[used++] = ']';
+	JSON_return[used] = '\0';
+
+	return JSON_return;
+
+}
+
+/* The header of a stats file: magic and the totals, so the totals can be read without the entries */
+bool readCorpusTotals_function ( FILE *fp, CorpusTotals *totals ) {
+
+	char magic[4];
+
+	return fread ( magic, 1, 4, fp ) == 4 && memcmp ( magic, "GPXS", 4 ) == 0 && fread ( &totals->files, sizeof ( int ), 1, fp ) == 1 && fread ( &totals->waypoints, sizeof ( int64_t ), 1, fp ) == 1 && fread ( &totals->routes, sizeof ( int64_t ), 1, fp ) == 1 && fread ( &totals->tracks, sizeof ( int64_t ), 1, fp ) == 1 && fread ( &totals->distance, sizeof ( double ), 1, fp ) == 1;
+
+}
+
+void corpusTotals_function ( CorpusStats *stats ) {
+
+	memset ( &stats->totals, 0, sizeof ( CorpusTotals ) );
+
+	for ( int i = 0; i < stats->num_entries; i++ ) {
+		corpusStatsAdd_function ( &stats->totals, &stats->entries[i], 1 );
+	}
+
+}
+
+/* Adds (sign 1) or subtracts (sign -1) one file's contribution */
+void corpusStatsAdd_function ( CorpusTotals *totals, const CorpusStatsEntry *entry, int sign ) {
+
+	totals->files = totals->files + sign;
+	totals->waypoints = totals->waypoints + sign * entry->waypoints;
+	totals->routes = totals->routes + sign * entry->routes;
+	totals->tracks = totals->tracks + sign * entry->tracks;
+	totals->distance = totals->distance + sign * entry->distance;
+
+}
+
+CorpusStats *loadCorpusStats ( const char *statsFile ) {
+
+	CorpusStats *stats = calloc ( 1, sizeof ( CorpusStats ) );
+
+	stats->capacity = 16;
+	stats->entries = malloc ( sizeof ( CorpusStatsEntry ) * stats->capacity );
+
+	FILE *fp = statsFile == NULL ? NULL : fopen ( statsFile, "rb" );
+
+	if ( fp == NULL ) {
+		return stats;
+	}
+
+	int count = 0;
+
+	if ( !readCorpusTotals_function ( fp, &stats->totals ) || fread ( &count, sizeof ( int ), 1, fp ) != 1 ) {
+		memset ( &stats->totals, 0, sizeof ( CorpusTotals ) );
+		fclose ( fp );
+		return stats;
+	}
+
+	for ( int i = 0; i < count; i++ ) {
+
+		CorpusStatsEntry my_entry;
+		int name_len = 0;
+
+		if ( fread ( &name_len, sizeof ( int ), 1, fp ) != 1 || name_len < 0 || name_len > 4096 ) {
+			break;
+		}
+
+		my_entry.fileName = malloc ( name_len + 1 );
+
+		if ( fread ( my_entry.fileName, 1, name_len, fp ) != (size_t) name_len || fread ( &my_entry.waypoints, sizeof ( int ), 1, fp ) != 1 || fread ( &my_entry.routes, sizeof ( int ), 1, fp ) != 1 || fread ( &my_entry.tracks, sizeof ( int ), 1, fp ) != 1 || fread ( &my_entry.distance, sizeof ( double ), 1, fp ) != 1 ) {
+			free ( my_entry.fileName );
+			break;
+		}
+
+		my_entry.fileName[name_len] = '\0';
+
+		if ( stats->num_entries == stats->capacity ) {
+			stats->capacity = stats->capacity * 2;
+			stats->entries = realloc ( stats->entries, sizeof ( CorpusStatsEntry ) * stats->capacity );
+		}
+
+		stats->entries[stats->num_entries] = my_entry;
+		stats->num_entries = stats->num_entries + 1;
+
+	}
+
+	fclose ( fp );
+
+	/* A truncated file loses entries the totals still count, so the totals are summed again from what was read */
+	if ( stats->num_entries != count ) {
+		corpusTotals_function ( stats );
+	}
+
+	return stats;
+
+}
+
+bool saveCorpusStats ( const CorpusStats *stats, const char *statsFile ) {
+
+	if ( stats == NULL || statsFile == NULL ) {
+		return false;
+	}
+
+	char *temp_name = malloc ( strlen ( statsFile ) + 5 );
+	sprintf ( temp_name, "%s.tmp", statsFile );
+
+	FILE *fp = fopen ( temp_name, "wb" );
+
+	if ( fp == NULL ) {
+		free ( temp_name );
+		return false;
+	}
+
+	fwrite ( "GPXS", 1, 4, fp );
+	fwrite ( &stats->totals.files, sizeof ( int ), 1, fp );
+	fwrite ( &stats->totals.waypoints, sizeof ( int64_t ), 1, fp );
+	fwrite ( &stats->totals.routes, sizeof ( int64_t ), 1, fp );
+	fwrite ( &stats->totals.tracks, sizeof ( int64_t ), 1, fp );
+	fwrite ( &stats->totals.distance, sizeof ( double ), 1, fp );
+	fwrite ( &stats->num_entries, sizeof ( int ), 1, fp );
+
+	for ( int i = 0; i < stats->num_entries; i++ ) {
+
+		const CorpusStatsEntry *my_entry = &stats->entries[i];
+		int name_len = strlen ( my_entry->fileName );
+
+		fwrite ( &name_len, sizeof ( int ), 1, fp );
+		fwrite ( my_entry->fileName, 1, name_len, fp );
+		fwrite ( &my_entry->waypoints, sizeof ( int ), 1, fp );
+		fwrite ( &my_entry->routes, sizeof ( int ), 1, fp );
+		fwrite ( &my_entry->tracks, sizeof ( int ), 1, fp );
+		fwrite ( &my_entry->distance, sizeof ( double ), 1, fp );
+
+	}
+
+	bool written = ferror ( fp ) == 0;
+
+	if ( fclose ( fp ) != 0 ) {
+		written = false;
+	}
+
+	if ( written ) {
+		written = rename ( temp_name, statsFile ) == 0;
+	} else {
+		remove ( temp_name );
+	}
+
+	free ( temp_name );
+
+	return written;
+
+}
+
+void deleteCorpusStats ( CorpusStats *stats ) {
+
+	if ( stats == NULL ) {
+		return;
+	}
+
+	for ( int i = 0; i < stats->num_entries; i++ ) {
+		free ( stats->entries[i].fileName );
+	}
+
+	free ( stats->entries );
+	free ( stats );
+
+}
+
+/* Takes fileName's contribution out of the totals; true when it was counted */
+bool corpusStatsRemove_function ( CorpusStats *stats, const char *fileName ) {
+
+	for ( int i = 0; i < stats->num_entries; i++ ) {
+
+		if ( strcmp ( stats->entries[i].fileName, fileName ) == 0 ) {
+
+			corpusStatsAdd_function ( &stats->totals, &stats->entries[i], -1 );
+			free ( stats->entries[i].fileName );
+
+			stats->num_entries = stats->num_entries - 1;
+			stats->entries[i] = stats->entries[stats->num_entries];
+
+			return true;
+
+		}
+
+	}
+
+	return false;
+
+}
+
+/* Counts fileName as it is now on disk in place of what it added before; a missing or invalid file simply drops out of the totals */
+void corpusStatsInclude_function ( CorpusStats *stats, char *fileName, char *gpxSchemaFile ) {
+
+	corpusStatsRemove_function ( stats, fileName );
+
+	GPXdoc *my_doc = createValidGPXdoc ( fileName, gpxSchemaFile );
+
+	if ( my_doc == NULL ) {
+		return;
+	}
+
+	CorpusStatsEntry my_entry;
+
+	my_entry.fileName = malloc ( strlen ( fileName ) + 1 );
+	strcpy ( my_entry.fileName, fileName );
+	my_entry.waypoints = getNumWaypoints ( my_doc );
+	my_entry.routes = getNumRoutes ( my_doc );
+	my_entry.tracks = getNumTracks ( my_doc );
+	my_entry.distance = 0;
+
+	ListIterator route_iterator = createIterator ( my_doc->routes );
+	Route *my_route = nextElement ( &route_iterator );
+
+	while ( my_route != NULL ) {
+		my_entry.distance = my_entry.distance + getRouteLen ( my_route );
+		my_route = nextElement ( &route_iterator );
+	}
+
+	ListIterator track_iterator = createIterator ( my_doc->tracks );
+	Track *my_track = nextElement ( &track_iterator );
+
+	while ( my_track != NULL ) {
+		my_entry.distance = my_entry.distance + getTrackLen ( my_track );
+		my_track = nextElement ( &track_iterator );
+	}
+
+	deleteGPXdoc ( my_doc );
+
+	if ( stats->num_entries == stats->capacity ) {
+		stats->capacity = stats->capacity * 2;
+		stats->entries = realloc ( stats->entries, sizeof ( CorpusStatsEntry ) * stats->capacity );
+	}
+
+	stats->entries[stats->num_entries] = my_entry;
+	stats->num_entries = stats->num_entries + 1;
+
+	corpusStatsAdd_function ( &stats->totals, &my_entry, 1 );
+
+}
+
+int rebuildCorpusStats ( char* statsFile, char* fileNames, char* gpxSchemaFile ) {
+
+	if ( statsFile == NULL || fileNames == NULL || gpxSchemaFile == NULL ) {
+		return -1;
+	}
+
+	CorpusStats *stats = loadCorpusStats ( NULL );
+
+	char *names = malloc ( strlen ( fileNames ) + 1 );
+	strcpy ( names, fileNames );
+
+	char *save = NULL;
+	char *name = strtok_r ( names, "!", &save );
+
+	while ( name != NULL ) {
+		corpusStatsInclude_function ( stats, name, gpxSchemaFile );
+		name = strtok_r ( NULL, "!", &save );
+	}
+
+	free ( names );
+
+	bool written = saveCorpusStats ( stats, statsFile );
+	deleteCorpusStats ( stats );
+
+	return written ? 1 : -1;
+
+}
+
+/* 1 when fileName's contribution was brought up to date, 0 when there are no saved statistics yet (a full rebuild is needed), -1 on error */
+int updateCorpusStats ( char* statsFile, char* fileName, char* gpxSchemaFile ) {
+
+	if ( statsFile == NULL || fileName == NULL || gpxSchemaFile == NULL ) {
+		return -1;
+	}
+
+	FILE *fp = fopen ( statsFile, "rb" );
+
+	if ( fp == NULL ) {
+		return 0;
+	}
+
+	fclose ( fp );
+
+	CorpusStats *stats = loadCorpusStats ( statsFile );
+
+	corpusStatsInclude_function ( stats, fileName, gpxSchemaFile );
+
+	bool written = saveCorpusStats ( stats, statsFile );
+	deleteCorpusStats ( stats );
+
+	return written ? 1 : -1;
+
+}
+
+/* The corpus totals as JSON, read from the header of the stats file alone; NULL when there are none saved */
+char *getCorpusStats ( char* statsFile ) {
+
+	FILE *fp = statsFile == NULL ? NULL : fopen ( statsFile, "rb" );
+
+	if ( fp == NULL ) {
+		return NULL;
+	}
+
+	CorpusTotals totals;
+	bool read = readCorpusTotals_function ( fp, &totals );
+
+	fclose ( fp );
+
+	if ( !read ) {
+		return NULL;
+	}
+
+	char *JSON_return = malloc ( 160 );
+	sprintf ( JSON_return, "{\"files\":%d,\"waypoints\":%lld,\"routes\":%lld,\"tracks\":%lld,\"distance\":%.1f}", totals.files, (long long) totals.waypoints, (long long) totals.routes, (long long) totals.tracks, totals.distance );
+
+	return JSON_return;
+
+}
+
 int main() {
 
     return ( 0 );